@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Process-wide heap allocation accounting. The global operator new/delete are
+// replaced in alloc_tracker.cpp, stb_image and GLFW are routed through the
+// Tracked* functions below. Allocations are attributed to the subsystem of
+// the innermost AllocScope active on the allocating thread, deallocations to
+// the one of the freeing thread.
+enum class AllocSubsystem : std::uint8_t {
+  // Threads we do not own, e.g. device or driver workers
+  kOther,
+  // Application code outside of any other subsystem
+  kApp,
+  // Calls into the ANARI device
+  kAnari,
+  // Host-side frame conversion, composition and reconstruction
+  kDisplay,
+  kOverlay,
+  // stb_image decoding
+  kImages,
+  // GLFW internals
+  kWindow,
+  kCount,
+};
+
+constexpr std::size_t kAllocSubsystemCount =
+    static_cast<std::size_t>(AllocSubsystem::kCount);
+
+const char *AllocSubsystemName(AllocSubsystem subsystem);
+
+struct AllocCounters final {
+  std::uint64_t allocations{};
+  std::uint64_t deallocations{};
+  // Requested bytes, reallocations count their new size
+  std::uint64_t bytes{};
+
+  AllocCounters &operator+=(const AllocCounters &other) {
+    allocations += other.allocations;
+    deallocations += other.deallocations;
+    bytes += other.bytes;
+    return *this;
+  }
+};
+
+// Counters since process start, per subsystem. The difference of two
+// snapshots gives the activity in between, e.g. of one frame.
+struct AllocSnapshot final {
+  std::array<AllocCounters, kAllocSubsystemCount> subsystems{};
+
+  const AllocCounters &operator[](AllocSubsystem subsystem) const {
+    return subsystems[static_cast<std::size_t>(subsystem)];
+  }
+
+  AllocCounters Total() const {
+    AllocCounters total{};
+    for (const auto &counters : subsystems) {
+      total += counters;
+    }
+    return total;
+  }
+};
+
+AllocSnapshot TakeAllocSnapshot();
+
+AllocSnapshot operator-(const AllocSnapshot &end, const AllocSnapshot &begin);
+
+// Subsystem new allocations of the calling thread are attributed to.
+AllocSubsystem CurrentAllocSubsystem();
+
+// Attributes allocations of the calling thread to a subsystem for the
+// lifetime of the scope. Scopes nest.
+class AllocScope {
+public:
+  explicit AllocScope(AllocSubsystem subsystem);
+
+  ~AllocScope();
+
+  AllocScope(const AllocScope&) = delete;
+  AllocScope(AllocScope&&) = delete;
+  AllocScope& operator=(const AllocScope&) = delete;
+  AllocScope& operator=(AllocScope&&) = delete;
+
+private:
+  AllocSubsystem previous_;
+};
+
+// malloc/realloc/free counted against an explicit subsystem, for C libraries
+// with allocator hooks.
+void *TrackedMalloc(std::size_t size, AllocSubsystem subsystem);
+void *TrackedRealloc(void *pointer, std::size_t size, AllocSubsystem subsystem);
+void TrackedFree(void *pointer, AllocSubsystem subsystem);
+
+// Routes GLFW allocations through the tracker. Must be called before
+// glfwInit(), does nothing with GLFW versions before 3.4.
+void InstallGlfwAllocator();
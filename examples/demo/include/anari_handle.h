@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <anari/anari_cpp.hpp>
+
+#include "alloc_tracker.h"
+
+// Counts the ANARI objects owned through AnariHandle, per type, so objects
+// that pile up over a long session show up. Device internals and objects
+// managed by hand are not counted.
+void TrackAnariObject(ANARIDataType type, bool created);
+
+// e.g. "Geometry" for ANARI_GEOMETRY, "other" for types not counted apart.
+const char *AnariTypeName(ANARIDataType type);
+
+struct AnariObjectCount final {
+  const char *type{};
+  // Owned by a handle right now
+  std::int64_t live{};
+  std::uint64_t created{};
+  std::uint64_t released{};
+};
+
+// Types that had objects at some point.
+std::vector<AnariObjectCount> GetAnariObjectCounts();
+
+// Releases through handles so far, of all types.
+std::uint64_t AnariObjectReleases();
+
+// Prints the live objects per type labelled with an app phase. With
+// expect_none, e.g. at shutdown, they are reported as leaks. Returns whether
+// no object is live.
+bool PrintAnariObjectCounts(const char *phase, bool expect_none);
+
+// Move-only owner of one reference to an ANARI object, released when the
+// handle is destroyed or reset. Pass Get() to ANARI calls, objects that hold
+// the handle as a parameter keep their own reference.
+template <typename T> class AnariHandle {
+public:
+  AnariHandle() = default;
+
+  // Takes over the reference of a new or retained object.
+  AnariHandle(anari::Device device, T handle)
+      : device_{device}, handle_{handle} {
+    if (handle_ != nullptr) {
+      TrackAnariObject(anari::ANARITypeFor<T>::value, true);
+    }
+  }
+
+  ~AnariHandle() { Reset(); }
+
+  AnariHandle(AnariHandle &&other) noexcept
+      : device_{other.device_}, handle_{std::exchange(other.handle_, nullptr)} {
+  }
+  AnariHandle &operator=(AnariHandle &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      device_ = other.device_;
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  AnariHandle(const AnariHandle&) = delete;
+  AnariHandle& operator=(const AnariHandle&) = delete;
+
+  // Owns a reference given up with Detach(), counted as live already.
+  static AnariHandle Adopt(anari::Device device, T handle) {
+    AnariHandle adopted{};
+    adopted.device_ = device;
+    adopted.handle_ = handle;
+    return adopted;
+  }
+
+  T Get() const { return handle_; }
+  explicit operator bool() const { return handle_ != nullptr; }
+
+  // Gives up the reference without releasing it, the object stays counted
+  // as live until its new owner releases it.
+  T Detach() { return std::exchange(handle_, nullptr); }
+
+  void Reset() {
+    if (handle_ == nullptr) {
+      return;
+    }
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::release(device_, handle_);
+    TrackAnariObject(anari::ANARITypeFor<T>::value, false);
+    handle_ = nullptr;
+  }
+
+private:
+  anari::Device device_{};
+  T handle_{};
+};
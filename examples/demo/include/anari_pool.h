@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <anari/anari_cpp.hpp>
+
+#include "alloc_tracker.h"
+#include "anari_handle.h"
+#include "array_memory.h"
+
+// Recycles ANARI objects and arrays whose users are gone instead of
+// releasing them, so scenes rebuilt over and over, e.g. while streaming,
+// reuse objects rather than creating new ones on the device.
+//
+// - Objects are reused by type and subtype. Recycling unsets and commits
+//   their parameters, which also drops their references to other objects.
+// - Arrays are reused by element type and size, over memory of the
+//   ArrayAllocator. Acquired arrays hold stale data, write them with
+//   anari::map() before use.
+//
+// Recycle only what no other live object refers to any more, e.g. the
+// arrays of a geometry after the geometry. Idle objects still count as live
+// ANARI objects. Not thread safe, use it from the thread making the ANARI
+// calls.
+class AnariPool {
+public:
+  // Idle objects kept per type and size, more are released
+  static constexpr std::size_t kMaxIdle = 16;
+
+  // Arrays are shared with the device in memory of allocator.
+  explicit AnariPool(ArrayAllocator &allocator) : allocator_{allocator} {}
+
+  // Releases the idle objects, must run before the device is released.
+  ~AnariPool() { Clear(); }
+
+  AnariPool(const AnariPool&) = delete;
+  AnariPool(AnariPool&&) = delete;
+  AnariPool& operator=(const AnariPool&) = delete;
+  AnariPool& operator=(AnariPool&&) = delete;
+
+  // The device of objects created from now on. Set it before the first
+  // Acquire(), the pool starts without one.
+  void SetDevice(anari::Device device) { device_ = device; }
+
+  // An object of the subtype, without parameters.
+  template <typename T>
+  AnariHandle<T> Acquire(const char *subtype = nullptr) {
+    Bucket &bucket = Find({anari::ANARITypeFor<T>::value, subtype});
+    if (auto *object = Take(bucket)) {
+      return AnariHandle<T>::Adopt(device_, static_cast<T>(object));
+    }
+    AllocScope scope{AllocSubsystem::kAnari};
+    if (subtype == nullptr) {
+      return {device_, anari::newObject<T>(device_)};
+    }
+    return {device_, anari::newObject<T>(device_, subtype)};
+  }
+
+  AnariHandle<anari::Array1D> AcquireArray1D(ANARIDataType element_type,
+                                             std::size_t element_size,
+                                             std::uint64_t count);
+
+  AnariHandle<anari::Array2D> AcquireArray2D(ANARIDataType element_type,
+                                             std::size_t element_size,
+                                             std::uint64_t size_x,
+                                             std::uint64_t size_y);
+
+  // Takes the object back for later Acquire() calls with the same subtype.
+  template <typename T>
+  void Recycle(AnariHandle<T> &&handle, const char *subtype = nullptr) {
+    if (handle) {
+      const Key key{anari::ANARITypeFor<T>::value, subtype};
+      RecycleObject(handle.Detach(), key);
+    }
+  }
+
+  void RecycleArray(AnariHandle<anari::Array1D> &&array,
+                    ANARIDataType element_type, std::uint64_t count);
+
+  void RecycleArray(AnariHandle<anari::Array2D> &&array,
+                    ANARIDataType element_type, std::uint64_t size_x,
+                    std::uint64_t size_y);
+
+  // Releases all idle objects.
+  void Clear();
+
+  struct Stats final {
+    // e.g. "Geometry triangle" or "Array1D 4 of type 1023"
+    std::string kind{};
+    // Acquired from the pool and newly created
+    std::uint64_t hits{};
+    std::uint64_t misses{};
+    std::uint64_t recycled{};
+    // Released instead of kept, the pool was full
+    std::uint64_t dropped{};
+    std::size_t idle{};
+  };
+
+  // Per kind of object acquired so far.
+  std::vector<Stats> GetStats() const;
+
+  // Sums over all kinds, without a kind.
+  Stats Totals() const;
+
+  // Prints the overall hit rate and one line per kind.
+  void PrintStats(const char *phase) const;
+
+private:
+  struct Key final {
+    ANARIDataType type{};
+    // Null for objects without one and arrays
+    const char *subtype{};
+    // Of arrays, size_y is 1 for 1D ones
+    ANARIDataType element_type{};
+    std::uint64_t size_x{};
+    std::uint64_t size_y{};
+  };
+
+  struct Bucket final {
+    ANARIDataType type{};
+    std::string subtype{};
+    ANARIDataType element_type{};
+    std::uint64_t size_x{};
+    std::uint64_t size_y{};
+    std::vector<ANARIObject> idle{};
+    Stats stats{};
+  };
+
+  Bucket &Find(const Key &key);
+
+  // An idle object of the bucket, counting the hit or the miss.
+  ANARIObject Take(Bucket &bucket);
+
+  void RecycleObject(ANARIObject object, const Key &key);
+
+  void Keep(Bucket &bucket, ANARIObject object);
+
+  anari::Device device_{};
+  ArrayAllocator &allocator_;
+  // Few kinds of objects, a linear search needs no allocation per lookup
+  std::vector<Bucket> buckets_{};
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+// Memory of the arrays the app shares with ANARI devices instead of letting
+// them copy, handed out with Deleter() as the array deleter. CPU devices
+// read it directly while rendering, so where it lives matters:
+//
+// - Arrays of kHugePageSize and more are mapped with 2 MiB pages, from the
+//   hugetlb pool if it has pages, else as transparent huge pages. Fewer TLB
+//   entries cover them.
+// - Those are also placed on the NUMA node of SetNumaNode() before the
+//   first touch, not on the node of whichever thread copies the data in.
+// - Smaller arrays come from the heap, kAlignment aligned.
+//
+// Huge pages and NUMA placement are Linux only. Thread safe, devices may
+// release arrays on their own threads.
+class ArrayAllocator {
+public:
+  static constexpr std::size_t kHugePageSize = 2 * 1024 * 1024;
+  // Of heap arrays, a cache line and the widest SIMD loads
+  static constexpr std::size_t kAlignment = 64;
+
+  ArrayAllocator() = default;
+
+  // Arrays still shared with a device are leaked, release the device first.
+  ~ArrayAllocator() = default;
+
+  ArrayAllocator(const ArrayAllocator&) = delete;
+  ArrayAllocator(ArrayAllocator&&) = delete;
+  ArrayAllocator& operator=(const ArrayAllocator&) = delete;
+  ArrayAllocator& operator=(ArrayAllocator&&) = delete;
+
+  // Node large arrays are placed on, the first touch decides if unset.
+  void SetNumaNode(std::optional<unsigned> node) { numa_node_ = node; }
+
+  // Uninitialized memory for bytes, never null.
+  void *Allocate(std::size_t bytes);
+
+  void Free(const void *memory);
+
+  // ANARI array deleter for memory from Allocate(), with the allocator as
+  // the user pointer.
+  static void Deleter(const void *allocator, const void *memory);
+
+  struct Stats final {
+    std::uint64_t arrays{};
+    // Requested, live arrays only
+    std::uint64_t bytes{};
+    // Mapped, by kind of backing
+    std::uint64_t hugetlb_bytes{};
+    std::uint64_t transparent_bytes{};
+    std::uint64_t heap_bytes{};
+    // Large arrays the kernel did not place on the node
+    std::uint64_t numa_failures{};
+  };
+
+  Stats GetStats() const;
+
+  void PrintStats() const;
+
+private:
+  enum class Backing : std::uint8_t { kHeap, kHugeTlb, kTransparent };
+
+  struct Block final {
+    std::size_t bytes{};
+    std::size_t mapped{};
+    Backing backing{};
+  };
+
+  void *MapLarge(std::size_t bytes, Block &block);
+
+  std::optional<unsigned> numa_node_{};
+
+  mutable std::mutex mutex_{};
+  std::unordered_map<const void *, Block> blocks_{};
+  std::uint64_t numa_failures_{};
+};
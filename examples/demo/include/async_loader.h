@@ -0,0 +1,203 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_task.h"
+#include "io_ring.h"
+#include "job_system.h"
+
+// How AsyncLoader reads files.
+enum class IoBackend : std::uint8_t {
+  // io_uring if available, else threads
+  kAuto,
+  // Batched reads on an IoRing
+  kRing,
+  // Blocking reads on a few I/O threads
+  kThreads,
+};
+
+const char *IoBackendName(IoBackend backend);
+
+// Pixels decoded by stb_image, freed with stbi_image_free().
+struct DecodedImage final {
+  struct Free final {
+    void operator()(unsigned char *data) const;
+  };
+
+  std::int32_t size_x{};
+  std::int32_t size_y{};
+  std::int32_t components{};
+  std::unique_ptr<unsigned char, Free> data{};
+};
+
+// Runs the steps of loading tasks where they belong: file reads on I/O
+// threads of its own, decoding and other CPU work on the job system as
+// background jobs, and ANARI calls on the loading thread, the one blocked in
+// Wait(). Loading code awaits the steps and reads sequentially:
+//
+//   Task<anari::Sampler> LoadSampler(AsyncLoader &loader, std::string path) {
+//     auto image = co_await LoadImage(loader, path, nullptr);
+//     co_await loader.LoadingThread();
+//     ... create the ANARI sampler ...
+//   }
+//
+// Independent loads overlap through WhenAll(). File reads go through one
+// thread driving an IoRing, which keeps many in flight with few system calls,
+// or through kIoThreads blocking threads where io_uring is not available.
+// Either way the next step of a load starts as soon as its file is read.
+class AsyncLoader {
+public:
+  // I/O threads of the kThreads backend
+  static constexpr unsigned kIoThreads = 4;
+
+  explicit AsyncLoader(JobSystem &jobs, IoBackend backend = IoBackend::kAuto);
+
+  // All started tasks must be done.
+  ~AsyncLoader();
+
+  AsyncLoader(const AsyncLoader&) = delete;
+  AsyncLoader(AsyncLoader&&) = delete;
+  AsyncLoader& operator=(const AsyncLoader&) = delete;
+  AsyncLoader& operator=(AsyncLoader&&) = delete;
+
+  class ReadAwaiter {
+  public:
+    ReadAwaiter(AsyncLoader &loader, std::string path,
+                const CancelToken *cancel)
+        : loader_{loader}, path_{std::move(path)}, cancel_{cancel} {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    std::optional<FileData> await_resume() { return std::move(result_); }
+
+  private:
+    friend class AsyncLoader;
+
+    AsyncLoader &loader_;
+    std::string path_;
+    const CancelToken *cancel_;
+    std::coroutine_handle<> handle_{};
+    std::optional<FileData> result_{};
+  };
+
+  class JobAwaiter {
+  public:
+    JobAwaiter(JobSystem &jobs, JobPriority priority)
+        : jobs_{jobs}, priority_{priority} {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      jobs_.Submit(priority_, [handle] { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    JobSystem &jobs_;
+    JobPriority priority_;
+  };
+
+  class LoadingThreadAwaiter {
+  public:
+    explicit LoadingThreadAwaiter(AsyncLoader &loader) : loader_{loader} {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      loader_.PostToLoadingThread(handle);
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    AsyncLoader &loader_;
+  };
+
+  // kRing or kThreads, kRing only if io_uring could be set up.
+  IoBackend Backend() const { return backend_; }
+
+  // Reads a whole file on an I/O thread and continues on the job system.
+  // Empty if the file cannot be read or the load was cancelled.
+  ReadAwaiter ReadFile(std::string path, const CancelToken *cancel) {
+    return {*this, std::move(path), cancel};
+  }
+
+  // Continues as a background job.
+  JobAwaiter Background() { return {jobs_, JobPriority::kBackground}; }
+
+  // Continues on the thread in Wait(), for ANARI calls.
+  LoadingThreadAwaiter LoadingThread() { return LoadingThreadAwaiter{*this}; }
+
+  // Runs the task up to its first step, so it overlaps with what the caller
+  // does before Wait().
+  template <typename T> void Start(Task<T> &task) {
+    task.Start(&AsyncLoader::OnTaskDone, this);
+  }
+
+  // Starts the task if needed and runs loading thread steps until it is
+  // done. Returns its result.
+  template <typename T> T Wait(Task<T> &task) {
+    if (!task.Started()) {
+      Start(task);
+    }
+    RunUntil([&] { return task.Done(); });
+    return task.TakeResult();
+  }
+
+private:
+  struct IoRequest final {
+    ReadAwaiter *awaiter{};
+  };
+
+  template <typename Predicate> void RunUntil(Predicate &&done);
+  void PostToLoadingThread(std::coroutine_handle<> handle);
+  void IoLoop(unsigned index);
+  void RingLoop();
+  void Resume(ReadAwaiter &awaiter);
+  static void OnTaskDone(void *context, std::atomic<bool> &done);
+
+  JobSystem &jobs_;
+
+  std::mutex mutex_{};
+  // Signals loading thread steps and done tasks
+  std::condition_variable loading_cv_{};
+  std::vector<std::coroutine_handle<>> loading_steps_{};
+
+  std::condition_variable io_cv_{};
+  std::deque<IoRequest> io_requests_{};
+  bool stop_{};
+  IoBackend backend_{};
+  IoRing ring_{};
+  std::vector<std::thread> io_threads_{};
+};
+
+template <typename Predicate> void AsyncLoader::RunUntil(Predicate &&done) {
+  std::vector<std::coroutine_handle<>> steps{};
+  while (true) {
+    {
+      std::unique_lock lock{mutex_};
+      loading_cv_.wait(lock,
+                       [&] { return done() || !loading_steps_.empty(); });
+      if (loading_steps_.empty()) {
+        return;
+      }
+      steps.swap(loading_steps_);
+    }
+    for (const std::coroutine_handle<> step : steps) {
+      step.resume();
+    }
+    steps.clear();
+  }
+}
+
+// Reads and decodes an image file with stb_image. Empty on errors and
+// cancellation.
+Task<std::optional<DecodedImage>> LoadImage(AsyncLoader &loader,
+                                            std::string path,
+                                            const CancelToken *cancel);
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// Set by the owner of a load to make the remaining steps give up. Tasks see
+// it at their next step, work already running is not interrupted.
+class CancelToken {
+public:
+  void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+  bool Cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<bool> cancelled_{};
+};
+
+inline bool IsCancelled(const CancelToken *token) {
+  return token != nullptr && token->Cancelled();
+}
+
+// Publishes that a task is done by setting done, e.g. under a lock its
+// waiters use. The frame may be destroyed as soon as done is set.
+using TaskDoneFn = void (*)(void *context, std::atomic<bool> &done);
+
+class TaskPromiseBase {
+public:
+  struct FinalAwaiter final {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<>
+    await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      TaskPromiseBase &promise = handle.promise();
+      std::coroutine_handle<> next = promise.continuation_
+                                         ? promise.continuation_
+                                         : std::noop_coroutine();
+      std::atomic<int> *join = promise.join_;
+      // The owner may destroy the frame once done_ is set, promise must not
+      // be touched afterwards
+      if (promise.done_fn_ != nullptr) {
+        promise.done_fn_(promise.done_context_, promise.done_);
+      } else {
+        promise.done_.store(true, std::memory_order_release);
+      }
+      // Only the last task of a WhenAll() resumes the awaiting one, which
+      // may destroy the tasks right away
+      if (join != nullptr &&
+          join->fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        next = std::noop_coroutine();
+      }
+      return next;
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  // Loading code reports errors through its results, not exceptions
+  void unhandled_exception() noexcept { std::terminate(); }
+
+  std::coroutine_handle<> continuation_{};
+  std::atomic<int> *join_{};
+  TaskDoneFn done_fn_{};
+  void *done_context_{};
+  // By Task::Start(), not when awaited by another task
+  bool started_{};
+  std::atomic<bool> done_{};
+};
+
+template <typename T> class TaskPromise : public TaskPromiseBase {
+public:
+  void return_value(T value) { value_.emplace(std::move(value)); }
+
+  std::optional<T> value_{};
+};
+
+template <> class TaskPromise<void> : public TaskPromiseBase {
+public:
+  void return_void() {}
+};
+
+// Lazily started coroutine returning T. Awaiting a task from another one
+// runs it and resumes the awaiting task when it finishes, on whichever thread
+// that happens; awaiting AsyncLoader steps moves work between the I/O
+// thread, the job system and the loading thread. A task must be done or
+// never started when it is destroyed.
+template <typename T = void> class Task {
+public:
+  class promise_type : public TaskPromise<T> {
+  public:
+    Task get_return_object() {
+      return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+  };
+
+  Task() = default;
+
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  Task(Task &&other) noexcept
+      : handle_{std::exchange(other.handle_, nullptr)} {}
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  bool Started() const { return handle_ && handle_.promise().started_; }
+
+  bool Done() const {
+    return handle_ && handle_.promise().done_.load(std::memory_order_acquire);
+  }
+
+  // Runs the task on the calling thread up to its first suspension. fn, if
+  // given, is called with context to publish that the task is done, from the
+  // thread that finished it.
+  void Start(TaskDoneFn fn = nullptr, void *context = nullptr) {
+    handle_.promise().started_ = true;
+    handle_.promise().done_fn_ = fn;
+    handle_.promise().done_context_ = context;
+    handle_.resume();
+  }
+
+  // The value of a done task, moved out.
+  T TakeResult() {
+    if constexpr (!std::is_void_v<T>) {
+      return std::move(*handle_.promise().value_);
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<>
+  await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation_ = awaiting;
+    return handle_;
+  }
+
+  T await_resume() { return TakeResult(); }
+
+private:
+  template <typename... Ts> friend class WhenAllAwaiter;
+
+  explicit Task(std::coroutine_handle<promise_type> handle)
+      : handle_{handle} {}
+
+  std::coroutine_handle<promise_type> handle_{};
+};
+
+// Runs tasks concurrently and resumes the awaiting task once all of them are
+// done. Their results are taken with TakeResult() afterwards.
+template <typename... Ts> class WhenAllAwaiter {
+public:
+  explicit WhenAllAwaiter(Task<Ts> &...tasks)
+      : handles_{tasks.handle_...}, promises_{&tasks.handle_.promise()...} {}
+
+  bool await_ready() const noexcept { return sizeof...(Ts) == 0; }
+
+  bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    // One extra count keeps the tasks from resuming the awaiting task while
+    // they are still being started. This awaiter lives in the awaiting frame
+    // and must not be touched after the count drops.
+    pending_.store(static_cast<int>(sizeof...(Ts)) + 1,
+                   std::memory_order_relaxed);
+    for (TaskPromiseBase *promise : promises_) {
+      promise->continuation_ = awaiting;
+      promise->join_ = &pending_;
+    }
+    for (const std::coroutine_handle<> handle : handles_) {
+      handle.resume();
+    }
+    return pending_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+  }
+
+  void await_resume() const noexcept {}
+
+private:
+  std::array<std::coroutine_handle<>, sizeof...(Ts)> handles_;
+  std::array<TaskPromiseBase *, sizeof...(Ts)> promises_;
+  std::atomic<int> pending_{};
+};
+
+template <typename... Ts> WhenAllAwaiter<Ts...> WhenAll(Task<Ts> &...tasks) {
+  return WhenAllAwaiter<Ts...>{tasks...};
+}
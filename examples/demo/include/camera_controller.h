@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "math_types.h"
+
+enum class CameraMode : std::uint8_t {
+  // Rotates and zooms around a target point, pans move the target
+  kOrbit,
+  // Moves freely, looking around from the camera position
+  kFly,
+};
+
+// Keyboard and mouse camera. Input handlers only record events, any number
+// of them per frame; Update() integrates them once per frame at frame time,
+// so fast input results in at most one camera update and commit per frame
+// and held keys move the camera at the same speed at any frame rate.
+//
+// Both modes share one state, a target in front of the camera, so switching
+// modes keeps the view. Not thread safe, call it from the thread polling
+// the window events.
+class CameraController {
+public:
+  enum class Key : std::uint8_t {
+    kForward,
+    kBack,
+    kLeft,
+    kRight,
+    kDown,
+    kUp,
+    kCount,
+  };
+
+  // What moving the cursor does while a mouse button is held
+  enum class Drag : std::uint8_t {
+    kNone,
+    kRotate,
+    kPan,
+  };
+
+  struct Pose final {
+    vec3 position{};
+    vec3 direction{0.0F, 0.0F, 1.0F};
+    vec3 up{0.0F, 1.0F, 0.0F};
+  };
+
+  struct Stats final {
+    // Input events recorded and camera updates they resulted in
+    std::uint64_t events{};
+    std::uint64_t updates{};
+  };
+
+  // Starts in orbit mode, looking at target from position.
+  CameraController(vec3 position, vec3 target);
+
+  CameraController(const CameraController&) = delete;
+  CameraController(CameraController&&) = delete;
+  CameraController& operator=(const CameraController&) = delete;
+  CameraController& operator=(CameraController&&) = delete;
+
+  CameraMode Mode() const { return mode_; }
+  void SetMode(CameraMode mode);
+
+  void SetKey(Key key, bool held);
+  void SetDrag(Drag drag);
+  // Cursor position in window coordinates, origin at the top-left corner
+  void MoveCursor(double x, double y);
+  // Positive steps zoom in, or speed up flying
+  void Scroll(double steps);
+  // Back to the pose the controller started with on the next Update()
+  void Reset();
+
+  // Applies the input recorded since the last call, held keys over seconds
+  // of frame time. Returns true if the pose changed. Call once per frame.
+  bool Update(float seconds);
+
+  const Pose &GetPose() const { return pose_; }
+
+  const Stats &GetStats() const { return stats_; }
+
+private:
+  void LookAt(vec3 position, vec3 target);
+
+  vec3 Direction() const;
+
+  // Position follows target, distance and the view direction
+  void UpdatePose();
+
+  vec3 start_position_;
+  vec3 start_target_;
+
+  CameraMode mode_{CameraMode::kOrbit};
+  vec3 target_{};
+  float distance_{};
+  // Radians, zero looks down +z
+  float yaw_{};
+  float pitch_{};
+  // Units per second in fly mode
+  float fly_speed_{};
+  Pose pose_{};
+
+  // Input since the last Update()
+  std::array<bool, static_cast<std::size_t>(Key::kCount)> keys_{};
+  Drag drag_{Drag::kNone};
+  bool has_cursor_{};
+  double cursor_x_{};
+  double cursor_y_{};
+  // Cursor movement while dragging, in pixels
+  double rotate_x_{};
+  double rotate_y_{};
+  double pan_x_{};
+  double pan_y_{};
+  double scroll_{};
+  // The pose changed without input, e.g. by Reset()
+  bool dirty_{};
+
+  Stats stats_{};
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+#include "frame_view.h"
+
+// Writes packed RGBA8 pixels as a PNG file. Rows are in ANARI order (bottom
+// row first) and flipped for the file. Returns false on write errors.
+bool WriteCapturePng(const char *path, FrameView<const std::uint32_t> image);
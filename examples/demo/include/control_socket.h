@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// UNIX-domain socket accepting one command per line, e.g. from
+// `socat - UNIX-CONNECT:<path>`, and answering each with one line.
+//
+// Commands are read on a thread of their own but executed by the render loop
+// through Poll(), so handlers can call into ANARI and change render state
+// without locking. A client waits for the reply of its command before the
+// next one is read.
+class ControlSocket {
+public:
+  ControlSocket() = default;
+
+  ~ControlSocket();
+
+  ControlSocket(const ControlSocket&) = delete;
+  ControlSocket(ControlSocket&&) = delete;
+  ControlSocket& operator=(const ControlSocket&) = delete;
+  ControlSocket& operator=(ControlSocket&&) = delete;
+
+  // Binds the socket, replacing a stale one left at path. Returns false if
+  // that fails or UNIX sockets are not supported on the platform.
+  bool Start(const char *path);
+
+  // Whether a command waits for the next Poll().
+  bool Pending() const { return pending_.load(std::memory_order_relaxed); }
+
+  // Runs handler(line) -> std::string for a pending command, if any, and
+  // returns whether there was one. Does not allocate when idle.
+  template <typename Handler> bool Poll(Handler &&handler) {
+    if (!pending_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::string reply = handler(command_);
+    {
+      std::lock_guard lock{mutex_};
+      reply_ = std::move(reply);
+      pending_.store(false, std::memory_order_release);
+    }
+    reply_cv_.notify_one();
+    return true;
+  }
+
+private:
+  void Serve();
+  void HandleClient(int client);
+  std::string Execute(std::string line);
+
+  std::string path_{};
+  int listen_fd_{-1};
+  std::atomic<bool> stop_{};
+  std::thread thread_{};
+
+  // Single command slot between the socket thread and the render loop
+  std::mutex mutex_{};
+  std::condition_variable reply_cv_{};
+  std::atomic<bool> pending_{};
+  std::string command_{};
+  std::string reply_{};
+};
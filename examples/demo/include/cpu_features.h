@@ -0,0 +1,20 @@
+#pragma once
+
+// Instruction set levels the SIMD kernels are compiled for. On x86 the levels
+// are ordered, each one implies the ones before it.
+enum class SimdLevel {
+  kScalar,
+  kSse42,
+  kAvx2,
+  kAvx512,
+  kNeon,
+};
+
+const char *SimdLevelName(SimdLevel level);
+
+// Parses a level name as printed by SimdLevelName ("scalar", "sse4.2", "avx2",
+// "avx512", "neon"). Returns false for unknown names.
+bool ParseSimdLevel(const char *name, SimdLevel &level);
+
+// Best level supported by the CPU and the OS the process runs on.
+SimdLevel DetectSimdLevel();
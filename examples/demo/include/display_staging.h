@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <anari/anari_cpp.hpp>
+
+#include "frame_view.h"
+
+class RowWorkers;
+
+// Converts mapped frame channels into packed RGBA8 pixels ready for display,
+// using the SIMD kernels. Row order is kept as is unless flipping is asked
+// for: ANARI frames and glDrawPixels both start with the bottom row, while
+// image files start with the top one.
+class DisplayStaging {
+public:
+  explicit DisplayStaging(RowWorkers *workers = nullptr) : workers_{workers} {}
+
+  // Converts any of the supported channel formats: RGBA8 (sRGB or linear),
+  // float RGBA (encoded to sRGB), depth (gray levels over the finite depth
+  // range) and uint32 ids (color hash). Returns false for other formats.
+  bool Convert(const anari::MappedFrameData<void> &mapped, bool flip_rows);
+
+  std::uint32_t Width() const { return width_; }
+  std::uint32_t Height() const { return height_; }
+  const std::uint32_t *Pixels() const { return pixels_.data(); }
+
+  FrameView<std::uint32_t> View() {
+    return {pixels_.data(), width_, height_};
+  }
+
+private:
+  void Resize(std::uint32_t width, std::uint32_t height);
+
+  template <typename T, typename RowFn>
+  void ConvertRows(FrameView<const T> src, bool flip_rows, RowFn &&convert);
+
+  RowWorkers *workers_{};
+  std::uint32_t width_{};
+  std::uint32_t height_{};
+  std::vector<std::uint32_t> pixels_{};
+};
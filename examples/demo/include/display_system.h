@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+
+#include <GLFW/glfw3.h>
+
+#include "window_wrapper.h"
+
+class DisplaySystem {
+public:
+  DisplaySystem();
+
+  ~DisplaySystem() { glfwTerminate(); }
+
+  void CreateWindow();
+
+  GLFWwindow *Window() { return window_wrapper_->Window(); }
+
+  WindowWrapper &Wrapper() { return *window_wrapper_; }
+
+private:
+  std::unique_ptr<WindowWrapper> window_wrapper_{nullptr};
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "frame_telemetry.h"
+
+// Telemetry of one frame plus the view it was rendered with.
+struct FlightRecord final {
+  FrameTelemetry telemetry{};
+  std::array<float, 3> camera_position{};
+  std::array<float, 3> camera_direction{};
+  // Static string, e.g. the render mode name
+  const char *mode{""};
+};
+
+// Fixed-size ring buffer of the last frames, cheap enough to record every
+// frame. The buffer is written to a text file on request (SIGUSR1 where
+// available), on fatal ANARI errors and on crash signals, appending one
+// block per dump, so the frames leading up to a failure are kept.
+//
+// Dumping only uses async-signal-safe calls and does not allocate. A dump
+// from another thread than the recording one may see one torn record.
+class FlightRecorder {
+public:
+  static constexpr std::size_t kCapacity = 600;
+
+  // path must stay valid for the lifetime of the recorder.
+  explicit FlightRecorder(const char *path);
+
+  ~FlightRecorder();
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder(FlightRecorder&&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(FlightRecorder&&) = delete;
+
+  void Record(const FlightRecord &record) {
+    const std::uint64_t count = count_.load(std::memory_order_relaxed);
+    records_[count % kCapacity] = record;
+    count_.store(count + 1, std::memory_order_release);
+  }
+
+  // Appends the recorded frames, oldest first, to the file. Returns false if
+  // the file cannot be written.
+  bool Dump(const char *reason) const;
+
+  const char *Path() const { return path_; }
+
+  // Makes this the recorder dumped by DumpFlightRecorder() and by the signal
+  // handlers, and installs the handlers: SIGUSR1 requests a dump (see
+  // ConsumeDumpRequest), SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT dump
+  // right away and then terminate as they would have.
+  void Install();
+
+  // Whether a dump was requested by SIGUSR1 since the last call. Dumping
+  // from the render loop keeps the handler itself trivial.
+  static bool ConsumeDumpRequest();
+
+private:
+  const char *path_;
+  std::array<FlightRecord, kCapacity> records_{};
+  std::atomic<std::uint64_t> count_{};
+};
+
+// Dumps the installed recorder, if any. Safe to call from any thread and
+// from signal handlers.
+void DumpFlightRecorder(const char *reason);
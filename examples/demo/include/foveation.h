@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frame_view.h"
+#include "math_types.h"
+
+class RowWorkers;
+
+// Rectangle of a frame in pixels, rows counted from the bottom as in ANARI
+// frames.
+struct FocusRegion final {
+  std::uint32_t x{};
+  std::uint32_t y{};
+  std::uint32_t width{};
+  std::uint32_t height{};
+
+  bool operator==(const FocusRegion &) const = default;
+};
+
+// Region covering fraction of each frame dimension around center (pixels,
+// bottom-up), shifted to stay inside the frame.
+FocusRegion MakeFocusRegion(uvec2 frame_size, vec2 center, float fraction);
+
+// Camera imageRegion rendering region of a display_size image.
+box2 FocusImageRegion(const FocusRegion &region, uvec2 display_size);
+
+// Assembles the foveated image: the reduced resolution full view frame is
+// upscaled bilinearly to the display size and the full resolution focus frame
+// is blended into its region with a feathered border. Depth is assembled the
+// same way (nearest upscale, focus overwrite) for overlay compositing.
+class FoveatedCompositor {
+public:
+  explicit FoveatedCompositor(RowWorkers *workers = nullptr,
+                              std::uint32_t feather = 16)
+      : workers_{workers}, feather_{feather} {}
+
+  void Compose(FrameView<const std::uint32_t> low,
+               FrameView<const std::uint32_t> focus, const FocusRegion &region,
+               std::uint32_t width, std::uint32_t height);
+
+  // Optional, call after Compose with the depth channels of both frames.
+  void ComposeDepth(FrameView<const float> low, FrameView<const float> focus,
+                    const FocusRegion &region);
+
+  std::uint32_t Width() const { return width_; }
+  std::uint32_t Height() const { return height_; }
+  const std::uint32_t *Pixels() const { return color_.data(); }
+
+  FrameView<std::uint32_t> Color() { return {color_.data(), width_, height_}; }
+  FrameView<const float> Depth() const {
+    return {depth_.data(), width_, height_};
+  }
+
+private:
+  void Resize(std::uint32_t width, std::uint32_t height,
+              std::uint32_t low_width, std::uint32_t low_height);
+  void UpdateFeather(const FocusRegion &region);
+
+  RowWorkers *workers_{};
+  std::uint32_t feather_{};
+
+  std::uint32_t width_{};
+  std::uint32_t height_{};
+  std::uint32_t low_width_{};
+  std::uint32_t low_height_{};
+  std::vector<std::uint32_t> color_{};
+  std::vector<float> depth_{};
+
+  // Source columns and weights of the bilinear upscale
+  std::vector<std::uint32_t> x0_{};
+  std::vector<std::uint32_t> x1_{};
+  std::vector<std::uint32_t> wx_{};
+
+  // Feather weights of the focus region, columns and rows
+  FocusRegion feather_region_{};
+  std::vector<std::uint32_t> feather_columns_{};
+  std::vector<std::uint32_t> feather_rows_{};
+};
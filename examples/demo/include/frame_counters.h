@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include "alloc_tracker.h"
+#include "frame_telemetry.h"
+#include "render_system.h"
+
+// Counter snapshots taken when a frame starts, turned into the per-frame
+// values of FrameTelemetry when it ends.
+class FrameCounters {
+public:
+  void Begin(const RenderSystem &rs);
+  void End(const RenderSystem &rs, FrameTelemetry &telemetry) const;
+
+private:
+  AllocSnapshot allocs_{};
+  StatusCounts status_{};
+  std::uint64_t commits_{};
+  std::uint64_t releases_{};
+};
+
+// Heap allocations of the render loop, per frame. Once warmed up, frames
+// with unchanged settings are expected not to allocate at all outside of the
+// ANARI device and threads we do not own, so latency tails stay free of
+// allocator stalls in long sessions.
+class FrameAllocMonitor {
+public:
+  // Frames skipped after a start or a settings change, buffers are resized
+  // while they run
+  static constexpr int kWarmupFrames = 8;
+
+  FrameAllocMonitor() = default;
+
+  FrameAllocMonitor(const FrameAllocMonitor&) = delete;
+  FrameAllocMonitor(FrameAllocMonitor&&) = delete;
+  FrameAllocMonitor& operator=(const FrameAllocMonitor&) = delete;
+  FrameAllocMonitor& operator=(FrameAllocMonitor&&) = delete;
+
+  void BeginFrame() { frame_begin_ = TakeAllocSnapshot(); }
+  void EndFrame();
+
+  // Call when the render mode, the render scale or the display size
+  // changes, the frame buffers are resized for them. Frames with other
+  // changes, e.g. uploads or commands, are checked like any other.
+  void Rewarm() { warmup_ = kWarmupFrames; }
+
+  // Steady-state frames so far and how many of them allocated.
+  int Frames() const { return frames_; }
+  int AllocatingFrames() const { return allocating_frames_; }
+
+  void Report() const;
+
+private:
+  static constexpr int kMaxLoggedFrames = 8;
+
+  AllocSnapshot frame_begin_{};
+  AllocSnapshot totals_{};
+  int warmup_{kWarmupFrames};
+  int frames_{};
+  int allocating_frames_{};
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "display_staging.h"
+#include "foveation.h"
+#include "frame_view.h"
+#include "interleave.h"
+#include "math_types.h"
+#include "overlay.h"
+#include "render_system.h"
+#include "row_workers.h"
+
+// Foveated mode: resolution scale of the full view frame and the share of
+// each display dimension rendered at full resolution
+constexpr float kFoveatedScale = 0.5F;
+constexpr float kFocusFraction = 0.4F;
+// Lowest render scale accepted at runtime
+constexpr float kMinRenderScale = 0.1F;
+
+// How the displayed image is produced from ANARI frames.
+enum class RenderMode {
+  // One frame at display resolution
+  kFull,
+  // Reduced resolution full view plus a full resolution focus region
+  kFoveated,
+  // Half width frames alternating between even and odd columns
+  kInterleaved,
+};
+
+const char *RenderModeName(RenderMode mode);
+
+// Inverse of RenderModeName(), false for unknown names.
+bool ParseRenderMode(const char *name, RenderMode &mode);
+
+// Configures the frames of RenderSystem for a render mode and assembles the
+// displayed RGBA8 image from them on the host: channel conversion, foveated
+// composition or interleaved reconstruction, and overlays.
+class FramePipeline {
+public:
+  FramePipeline(RenderSystem &rs, RowWorkers &workers)
+      : rs_{rs}, staging_{&workers}, focus_staging_{&workers},
+        foveated_{&workers}, interleaved_{&workers} {}
+
+  FramePipeline(const FramePipeline&) = delete;
+  FramePipeline(FramePipeline&&) = delete;
+  FramePipeline& operator=(const FramePipeline&) = delete;
+  FramePipeline& operator=(FramePipeline&&) = delete;
+
+  RenderMode Mode() const { return mode_; }
+
+  // Resolution scale of full mode frames and of the peripheral frame in
+  // foveated mode, clamped to [kMinRenderScale, 1]. Interleaved mode always
+  // renders at display resolution, reconstruction relies on it.
+  float RenderScale() const { return render_scale_; }
+  void SetRenderScale(float scale) {
+    render_scale_ = std::clamp(scale, kMinRenderScale, 1.0F);
+  }
+
+  // Call before RenderSystem::RenderFrame(). focus_center is only used in
+  // foveated mode (display pixels, origin at the bottom-left corner).
+  void Prepare(RenderMode mode, uvec2 display_size, vec2 focus_center);
+
+  // Call after RenderSystem::RenderFrame(). Returns an empty view if the
+  // channel cannot be displayed.
+  FrameView<std::uint32_t> Assemble(const char *channel,
+                                    OverlayRenderer *overlay);
+
+private:
+  static uvec2 ScaledSize(uvec2 size, float scale) {
+    return {std::max(1U, static_cast<uint32_t>(size[0] * scale)),
+            std::max(1U, static_cast<uint32_t>(size[1] * scale))};
+  }
+
+  RenderSystem &rs_;
+  RenderMode mode_{RenderMode::kFull};
+  float render_scale_{1.0F};
+  uvec2 display_size_{};
+  FocusRegion focus_region_{};
+  std::uint32_t parity_{};
+
+  DisplayStaging staging_;
+  DisplayStaging focus_staging_;
+  FoveatedCompositor foveated_;
+  InterleavedReconstructor interleaved_;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <anari/anari_cpp.hpp>
+
+// Stages of one iteration of the render loop, in order.
+enum class FrameStage : std::uint8_t {
+  // Render mode, frame sizes and image regions
+  kPrepare,
+  kCamera,
+  // anari::render() and anari::wait()
+  kRender,
+  // Channel mapping, host-side conversion, composition and overlays
+  kAssemble,
+  // OpenGL upload and buffer swap
+  kPresent,
+  // Window events and key handling, including picks requested by keys
+  kEvents,
+  kCount,
+};
+
+constexpr std::size_t kFrameStageCount =
+    static_cast<std::size_t>(FrameStage::kCount);
+
+const char *FrameStageName(FrameStage stage);
+
+// Status messages of the ANARI device, counted process-wide. Safe to call
+// from any thread, statusFunc may run on device threads.
+struct StatusCounts final {
+  std::uint64_t warnings{};
+  std::uint64_t performance_warnings{};
+  std::uint64_t errors{};
+};
+
+void CountStatusMessage(ANARIStatusSeverity severity, const char *message);
+StatusCounts TakeStatusCounts();
+
+// Copies the latest warning or error message, truncated to size - 1
+// characters. Empty if there was none.
+void CopyLatestStatusMessage(char *buffer, std::size_t size);
+
+// What happened during one frame. Plain data without allocations so it can
+// be kept for many frames and copied around freely.
+struct FrameTelemetry final {
+  std::uint64_t frame{};
+  std::array<float, kFrameStageCount> stage_ms{};
+  float total_ms{};
+  std::uint32_t width{};
+  std::uint32_t height{};
+  // ANARI object commits and releases issued by the app
+  std::uint32_t commits{};
+  std::uint32_t releases{};
+  // Heap activity of the render loop thread and its helpers
+  std::uint32_t allocations{};
+  std::uint64_t allocated_bytes{};
+  std::uint32_t warnings{};
+  std::uint32_t errors{};
+};
+
+// Splits the wall time of a frame into stages. Each Mark() ends the stage
+// given and starts the next one.
+class FrameStageTimer {
+public:
+  void Begin() {
+    begin_ = std::chrono::steady_clock::now();
+    last_ = begin_;
+  }
+
+  void Mark(FrameStage stage, FrameTelemetry &telemetry) {
+    const auto now = std::chrono::steady_clock::now();
+    telemetry.stage_ms[static_cast<std::size_t>(stage)] +=
+        std::chrono::duration<float, std::milli>(now - last_).count();
+    telemetry.total_ms =
+        std::chrono::duration<float, std::milli>(now - begin_).count();
+    last_ = now;
+  }
+
+private:
+  std::chrono::steady_clock::time_point begin_{};
+  std::chrono::steady_clock::time_point last_{};
+};
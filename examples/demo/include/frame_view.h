@@ -0,0 +1,239 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include <anari/anari_cpp.hpp>
+
+// Bounds checking of FrameView accessors. Enabled by default in debug builds,
+// can be forced either way by defining the macro to 0 or 1.
+#ifndef ANARI_PROJECT_CHECKED_FRAME_VIEW
+#ifdef NDEBUG
+#define ANARI_PROJECT_CHECKED_FRAME_VIEW 0
+#else
+#define ANARI_PROJECT_CHECKED_FRAME_VIEW 1
+#endif
+#endif
+
+// Element types used for host-side processing of mapped frame channels.
+// RGBA8 pixels are kept packed in a single 32-bit word (R in the low byte),
+// float pixels are plain lanes, so rows can be fed to vector code directly.
+// Color and ID pixels are both 32-bit words but distinct types, so a view of
+// one cannot be made over a channel of the other.
+struct PixelRgba8 final {
+  std::uint32_t packed;
+};
+using PixelRgba32F = std::array<float, 4>;
+using PixelDepth = float;
+struct PixelId final {
+  std::uint32_t value;
+};
+
+// Rows are handed to the kernels as arrays of their words
+static_assert(sizeof(PixelRgba8) == sizeof(std::uint32_t) &&
+              std::is_standard_layout_v<PixelRgba8>);
+static_assert(sizeof(PixelId) == sizeof(std::uint32_t) &&
+              std::is_standard_layout_v<PixelId>);
+
+template <ANARIDataType PixelType> struct PixelTraits;
+
+template <> struct PixelTraits<ANARI_UFIXED8_RGBA_SRGB> {
+  using Element = PixelRgba8;
+};
+
+template <> struct PixelTraits<ANARI_UFIXED8_VEC4> {
+  using Element = PixelRgba8;
+};
+
+template <> struct PixelTraits<ANARI_FLOAT32_VEC4> {
+  using Element = PixelRgba32F;
+};
+
+template <> struct PixelTraits<ANARI_FLOAT32> {
+  using Element = PixelDepth;
+};
+
+template <> struct PixelTraits<ANARI_UINT32> {
+  using Element = PixelId;
+};
+
+// Calls fn(std::type_identity<Element>{}) for the element type matching a
+// runtime ANARI pixel type. Returns false if the pixel type is not supported.
+template <typename Fn> bool DispatchPixelType(ANARIDataType type, Fn &&fn) {
+  switch (type) {
+  case ANARI_UFIXED8_RGBA_SRGB:
+  case ANARI_UFIXED8_VEC4: {
+    fn(std::type_identity<PixelRgba8>{});
+    return true;
+  }
+  case ANARI_FLOAT32_VEC4: {
+    fn(std::type_identity<PixelRgba32F>{});
+    return true;
+  }
+  case ANARI_FLOAT32: {
+    fn(std::type_identity<PixelDepth>{});
+    return true;
+  }
+  case ANARI_UINT32: {
+    fn(std::type_identity<PixelId>{});
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+// Whether a runtime ANARI pixel type is stored as elements of type T.
+template <typename T> bool PixelTypeMatches(ANARIDataType type) {
+  bool matches{false};
+  DispatchPixelType(type, [&](auto element) {
+    matches = std::is_same_v<typename decltype(element)::type,
+                             std::remove_const_t<T>>;
+  });
+  return matches;
+}
+
+// Non-owning 2D view over a frame buffer. The stride is given in elements and
+// allows views of sub-regions (tiles) of a larger buffer. Row 0 is the first
+// row in memory, which for ANARI frames is the bottom row of the image.
+template <typename T> class FrameView {
+public:
+  FrameView() = default;
+
+  FrameView(T *data, std::uint32_t width, std::uint32_t height)
+      : FrameView(data, width, height, width) {}
+
+  FrameView(T *data, std::uint32_t width, std::uint32_t height,
+            std::size_t stride)
+      : data_{data}, width_{width}, height_{height}, stride_{stride} {}
+
+  // Views over mutable elements convert to views over const elements.
+  operator FrameView<const T>() const {
+    return FrameView<const T>(data_, width_, height_, stride_);
+  }
+
+  T *Data() const { return data_; }
+  std::uint32_t Width() const { return width_; }
+  std::uint32_t Height() const { return height_; }
+  std::size_t Stride() const { return stride_; }
+  bool Empty() const { return data_ == nullptr || width_ == 0 || height_ == 0; }
+  // Rows are contiguous and can be processed as one span.
+  bool Contiguous() const { return stride_ == width_; }
+
+  T &At(std::uint32_t x, std::uint32_t y) const {
+    Check(x < width_ && y < height_, x, y);
+    return data_[y * stride_ + x];
+  }
+
+  T &At(std::array<std::uint32_t, 2> coord) const {
+    return At(coord[0], coord[1]);
+  }
+
+  std::span<T> Row(std::uint32_t y) const {
+    Check(y < height_, 0, y);
+    return {data_ + y * stride_, width_};
+  }
+
+  // View over the region [x, x + width) x [y, y + height), clamped to the
+  // bounds of this view.
+  FrameView Sub(std::uint32_t x, std::uint32_t y, std::uint32_t width,
+                std::uint32_t height) const {
+    if (x >= width_ || y >= height_) {
+      return FrameView(data_, 0, 0, stride_);
+    }
+    width = width < width_ - x ? width : width_ - x;
+    height = height < height_ - y ? height : height_ - y;
+    return FrameView(data_ + y * stride_ + x, width, height, stride_);
+  }
+
+  // Calls fn(y, row) for rows [y_begin, y_end).
+  template <typename Fn>
+  void ForEachRow(std::uint32_t y_begin, std::uint32_t y_end, Fn &&fn) const {
+    y_end = y_end < height_ ? y_end : height_;
+    for (std::uint32_t y = y_begin; y < y_end; ++y) {
+      fn(y, std::span<T>{data_ + y * stride_, width_});
+    }
+  }
+
+  template <typename Fn> void ForEachRow(Fn &&fn) const {
+    ForEachRow(0, height_, std::forward<Fn>(fn));
+  }
+
+  // Calls fn(x, y, tile) for every tile of at most tile_width x tile_height
+  // elements, row of tiles by row of tiles.
+  template <typename Fn>
+  void ForEachTile(std::uint32_t tile_width, std::uint32_t tile_height,
+                   Fn &&fn) const {
+    if (tile_width == 0 || tile_height == 0) {
+      return;
+    }
+    for (std::uint32_t y = 0; y < height_; y += tile_height) {
+      for (std::uint32_t x = 0; x < width_; x += tile_width) {
+        fn(x, y, Sub(x, y, tile_width, tile_height));
+      }
+    }
+  }
+
+private:
+  void Check(bool in_bounds, std::uint32_t x, std::uint32_t y) const {
+#if ANARI_PROJECT_CHECKED_FRAME_VIEW
+    if (!in_bounds) {
+      std::fprintf(stderr,
+                   "[FATAL] FrameView access out of bounds: (%u, %u) in "
+                   "%ux%u\n",
+                   x, y, width_, height_);
+      std::abort();
+    }
+#else
+    (void)in_bounds;
+    (void)x;
+    (void)y;
+#endif
+  }
+
+  T *data_{};
+  std::uint32_t width_{};
+  std::uint32_t height_{};
+  std::size_t stride_{};
+};
+
+// Typed view over a mapped frame channel. Returns an empty view if the
+// channel's pixel type is not stored as elements of type T.
+template <typename T>
+FrameView<const T> MakeFrameView(const anari::MappedFrameData<T> &mapped) {
+  if (mapped.data == nullptr || !PixelTypeMatches<T>(mapped.pixelType)) {
+    return {};
+  }
+  return FrameView<const T>(mapped.data, mapped.width, mapped.height);
+}
+
+// Typed view over a channel mapped without a static element type. Returns an
+// empty view if the channel's pixel type is not stored as elements of type T.
+template <typename T>
+FrameView<const T> MakeFrameViewAs(const anari::MappedFrameData<void> &mapped) {
+  if (mapped.data == nullptr || !PixelTypeMatches<T>(mapped.pixelType)) {
+    return {};
+  }
+  return FrameView<const T>(static_cast<const T *>(mapped.data), mapped.width,
+                            mapped.height);
+}
+
+// Calls fn(view) with a view typed after the channel's runtime pixel type.
+// Returns false if the pixel type is not supported.
+template <typename Fn>
+bool VisitFrame(const anari::MappedFrameData<void> &mapped, Fn &&fn) {
+  if (mapped.data == nullptr) {
+    return false;
+  }
+  return DispatchPixelType(mapped.pixelType, [&](auto element) {
+    using Element = typename decltype(element)::type;
+    fn(FrameView<const Element>(static_cast<const Element *>(mapped.data),
+                                mapped.width, mapped.height));
+  });
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frame_view.h"
+
+// Pieces of demo_check, which renders reference scenes headlessly and fails
+// on image or performance regressions, see tools/check.cpp.
+
+// Differences of an RGBA8 image to its golden image. Alpha is ignored.
+struct ImageComparison final {
+  bool size_matches{};
+  // Mean absolute difference over RGB bytes, 0 to 255
+  double mae{};
+  // Infinite for identical images
+  double psnr_db{};
+  // Pixels with a channel off by more than the threshold, 0 to 1
+  double bad_pixel_fraction{};
+};
+
+// Default tolerances allow for rounding differences between CPUs and
+// compilers, not for visible changes.
+struct ImageTolerance final {
+  double max_mae{0.5};
+  double min_psnr_db{40.0};
+  double max_bad_pixel_fraction{0.001};
+  int bad_pixel_threshold{16};
+};
+
+ImageComparison CompareImages(FrameView<const std::uint32_t> image,
+                              FrameView<const std::uint32_t> golden,
+                              int bad_pixel_threshold);
+
+bool WithinTolerance(const ImageComparison &comparison,
+                     const ImageTolerance &tolerance);
+
+// PNG golden image converted to packed RGBA8 rows bottom to top, like the
+// images written by WriteCapturePng().
+class GoldenImage {
+public:
+  // Returns false if the file is missing or cannot be decoded.
+  bool Load(const char *path);
+
+  FrameView<const std::uint32_t> View() const {
+    return {pixels_.data(), width_, height_};
+  }
+
+private:
+  std::uint32_t width_{};
+  std::uint32_t height_{};
+  std::vector<std::uint32_t> pixels_{};
+};
+
+// Median of repeated timings with a distribution-free 95% confidence
+// interval from order statistics. Frame times are skewed and have outliers,
+// so neither the mean nor a normal approximation fits them.
+struct SampleSummary final {
+  std::size_t count{};
+  double median{};
+  double low{};
+  double high{};
+};
+
+SampleSummary Summarize(std::vector<double> samples);
+
+// Limits per scene and metric, read from and written to a text file with
+// one "<key> <value>" pair per line, e.g. "full.frame_ms 4.5". Lines
+// starting with '#' are comments.
+class PerfBudget {
+public:
+  bool Load(const char *path);
+  bool Save(const char *path) const;
+
+  // Negative if there is no limit for the key.
+  double Get(const std::string &key) const;
+  void Set(const std::string &key, double value);
+
+private:
+  // In file order, so recorded budgets diff nicely
+  std::vector<std::pair<std::string, double>> entries_{};
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <optional>
+
+#include "async_loader.h"
+#include "frame_pipeline.h"
+#include "job_system.h"
+#include "render_system.h"
+#include "row_workers.h"
+#include "thread_placement.h"
+
+// Options of the engine that the demo and every tool in tools/ accept: the
+// job system and where the threads of the app run.
+struct EngineOptions final {
+  // Job system worker threads, JobSystem::DefaultWorkers() if 0
+  unsigned job_workers{};
+  // CPUs, NUMA node and priority of the threads of each role
+  ThreadPlacements thread_placements{};
+
+  unsigned JobWorkers() const {
+    return job_workers != 0 ? job_workers : JobSystem::DefaultWorkers();
+  }
+};
+
+// Parses the option arg with its value if arg is --job-workers or one of
+// ParseThreadOption(). Returns false if it is none of them or the value is
+// missing or invalid, so the caller can try its own options.
+bool ParseEngineOption(const char *arg, const char *value,
+                       EngineOptions &options);
+
+// Usage lines of the options ParseEngineOption() accepts.
+void PrintEngineUsage();
+
+// Row helpers of host-side frame processing, leaving most cores to the
+// ANARI device.
+unsigned DefaultRowHelpers();
+
+// Loads the library and sets up the demo scene and the frames, printing the
+// memory after each phase. array_numa_node as in
+// RenderSystem::SetArrayNumaNode().
+void SetupRenderSystem(RenderSystem &rs, AsyncLoader &loader,
+                       const char *library,
+                       std::optional<unsigned> array_numa_node = {});
+
+// The engine as the headless modes run it, without a window: the thread
+// pools, the loader and a RenderSystem set up with SetupRenderSystem(). The
+// calling thread is placed as the main thread once the device is up, so the
+// threads of the device keep the default placement.
+struct HeadlessEngine final {
+  HeadlessEngine(const EngineOptions &options, const char *library,
+                 std::optional<unsigned> array_numa_node = {});
+
+  HeadlessEngine(const HeadlessEngine&) = delete;
+  HeadlessEngine(HeadlessEngine&&) = delete;
+  HeadlessEngine& operator=(const HeadlessEngine&) = delete;
+  HeadlessEngine& operator=(HeadlessEngine&&) = delete;
+
+  RowWorkers row_workers;
+  JobSystem jobs;
+  AsyncLoader loader;
+  RenderSystem rs{};
+  FramePipeline pipeline;
+
+private:
+  std::optional<ThreadPlacementScope> main_placement_{};
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "frame_telemetry.h"
+
+// Flags frames taking longer than a multiple of the rolling median frame
+// time and logs a one-line report for each: per-stage timings, the stage
+// that exceeded its own median the most, ANARI commits and releases, heap
+// allocations and status messages of that frame.
+class HitchDetector {
+public:
+  // Frames the medians are taken over
+  static constexpr std::size_t kWindow = 120;
+  // Frames seen before hitches are reported
+  static constexpr std::size_t kWarmupFrames = 30;
+
+  explicit HitchDetector(float factor = 3.0F) : factor_{factor} {}
+
+  // Returns true if the frame is a hitch. Call once per frame.
+  bool Check(const FrameTelemetry &telemetry);
+
+  std::uint64_t Hitches() const { return hitches_; }
+  float Factor() const { return factor_; }
+
+private:
+  float Median(const std::array<float, kWindow> &history) const;
+  void Report(const FrameTelemetry &telemetry, float median) const;
+
+  float factor_;
+  std::array<float, kWindow> total_history_{};
+  std::array<std::array<float, kWindow>, kFrameStageCount> stage_history_{};
+  std::size_t next_{};
+  std::size_t count_{};
+  std::uint64_t hitches_{};
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frame_view.h"
+#include "math_types.h"
+
+class RowWorkers;
+
+// Width of the half frame rendering the columns of the given parity.
+std::uint32_t InterleavedWidth(std::uint32_t width, std::uint32_t parity);
+
+// Camera imageRegion for the half frame of the given parity: the region is
+// shifted so that half frame pixel centers land on the full frame columns
+// of that parity.
+box2 InterleavedImageRegion(std::uint32_t width, std::uint32_t parity);
+
+// Interleaved rendering: every frame renders only the even or the odd
+// columns, alternating, and the full image is rebuilt from the previous
+// output with neighborhood clamping. Halves the rendered pixels per frame.
+class InterleavedReconstructor {
+public:
+  explicit InterleavedReconstructor(RowWorkers *workers = nullptr)
+      : workers_{workers} {}
+
+  // Drops the history, e.g. after a mode switch.
+  void Reset() { history_valid_ = false; }
+
+  void Reconstruct(FrameView<const std::uint32_t> half, std::uint32_t parity,
+                   std::uint32_t width);
+
+  // Optional, call after Reconstruct with the depth channel of the same half
+  // frame. Missing columns repeat a rendered neighbor.
+  void ReconstructDepth(FrameView<const float> half, std::uint32_t parity);
+
+  std::uint32_t Width() const { return width_; }
+  std::uint32_t Height() const { return height_; }
+  FrameView<std::uint32_t> Color() {
+    return {color_[current_].data(), width_, height_};
+  }
+  FrameView<const float> Depth() const {
+    return {depth_.data(), width_, height_};
+  }
+
+private:
+  RowWorkers *workers_{};
+  std::uint32_t width_{};
+  std::uint32_t height_{};
+  // Output and history swap roles every frame
+  std::vector<std::uint32_t> color_[2]{};
+  std::size_t current_{};
+  bool history_valid_{};
+  std::vector<float> depth_{};
+};
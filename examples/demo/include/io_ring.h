@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using FileData = std::vector<unsigned char>;
+
+// Batched whole-file reads on a Linux io_uring, driven through the raw system
+// calls. Opens and reads of up to kSlots files are in flight at once and one
+// io_uring_enter() submits all queued work and reaps what finished, instead
+// of a few blocking calls per file.
+//
+// Files that fit are read into buffers registered with the ring, which saves
+// the kernel mapping the pages for every read, and copied out once complete.
+// Bigger files are read straight into their FileData. Used by one thread.
+class IoRing {
+public:
+  // Reads in flight
+  static constexpr unsigned kSlots = 32;
+  // Registered buffer of each slot
+  static constexpr std::size_t kBufferSize = 128 * 1024;
+
+  IoRing() = default;
+
+  ~IoRing();
+
+  IoRing(const IoRing&) = delete;
+  IoRing(IoRing&&) = delete;
+  IoRing& operator=(const IoRing&) = delete;
+  IoRing& operator=(IoRing&&) = delete;
+
+  // Sets up the ring. Returns false if io_uring is not available, e.g. on
+  // other platforms, old kernels or in sandboxes that block it.
+  bool Init();
+
+  bool Full() const { return free_slots_.empty(); }
+  bool Idle() const { return free_slots_.size() == kSlots; }
+
+  // Queues reading the whole file at path into data. path and data must stay
+  // valid until the read comes back from Reap() with user. Not Full().
+  void Read(const char *path, FileData *data, void *user);
+
+  struct Completion final {
+    void *user{};
+    // data is cleared if not
+    bool ok{};
+  };
+
+  // Submits the queued work and, unless Idle(), waits until at least one
+  // read is done. Appends the done reads to done. Work the kernel does not
+  // take is submitted again by the next call. If io_uring_enter() fails for
+  // good, the reads not submitted yet and all later ones fail; those already
+  // in flight are still reaped.
+  void Reap(std::vector<Completion> &done);
+
+  bool Failed() const { return failed_; }
+
+private:
+  enum class Stage : std::uint8_t { kOpen, kRead };
+
+  // A file being opened or read
+  struct Slot final {
+    const char *path{};
+    FileData *data{};
+    void *user{};
+    int fd{-1};
+    std::size_t size{};
+    std::size_t offset{};
+    Stage stage{};
+  };
+
+  void QueueOpen(unsigned slot);
+  void QueueRead(unsigned slot);
+  void Finish(unsigned slot, bool ok, std::vector<Completion> &done);
+  void FailUnsubmitted(std::vector<Completion> &done);
+  void HandleCompletion(unsigned slot, int result,
+                        std::vector<Completion> &done);
+
+  int ring_fd_{-1};
+  void *ring_{};
+  std::size_t ring_bytes_{};
+  void *sqes_{};
+  std::size_t sqes_bytes_{};
+  // Into ring_
+  unsigned *sq_tail_{};
+  unsigned *sq_array_{};
+  unsigned sq_mask_{};
+  unsigned *cq_head_{};
+  unsigned *cq_tail_{};
+  unsigned cq_mask_{};
+  void *cqes_{};
+  // Submission entries written but not in the ring tail yet, and entries in
+  // the ring the kernel has not taken
+  unsigned queued_{};
+  unsigned unsubmitted_{};
+  bool failed_{};
+
+  Slot slots_[kSlots]{};
+  std::vector<unsigned> free_slots_{};
+  std::unique_ptr<unsigned char[]> buffers_{};
+};
+
+// Drops the clean cached pages of a file so the next read goes to the disk.
+// Returns false where that is not supported.
+bool EvictFromPageCache(const char *path);
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alloc_tracker.h"
+
+// Interactive jobs are taken before any background job, on every worker.
+enum class JobPriority : std::uint8_t {
+  // Work somebody waits for this frame, e.g. post-processing
+  kInteractive,
+  // Loading, decoding and scene preparation
+  kBackground,
+  kCount,
+};
+
+constexpr std::size_t kJobPriorityCount =
+    static_cast<std::size_t>(JobPriority::kCount);
+
+// Callable stored inline, so submitting a job never allocates. Jobs capture
+// pointers and plain values; anything bigger stays with the submitter.
+class Job {
+public:
+  static constexpr std::size_t kStorageSize = 48;
+
+  Job() = default;
+
+  template <typename Fn> explicit Job(Fn fn) {
+    static_assert(sizeof(Fn) <= kStorageSize,
+                  "Job captures too much, capture a pointer instead");
+    static_assert(alignof(Fn) <= alignof(std::max_align_t));
+    static_assert(std::is_trivially_copyable_v<Fn> &&
+                      std::is_trivially_destructible_v<Fn>,
+                  "Job captures must be pointers and plain values");
+    std::memcpy(storage_, static_cast<const void *>(&fn), sizeof(Fn));
+    invoke_ = [](void *storage) {
+      (*std::launder(reinterpret_cast<Fn *>(storage)))();
+    };
+  }
+
+  void operator()() { invoke_(storage_); }
+
+private:
+  alignas(std::max_align_t) unsigned char storage_[kStorageSize]{};
+  void (*invoke_)(void *storage){};
+};
+
+// Jobs of a group still to finish. Pass it to Submit() and to Wait().
+class JobCounter {
+public:
+  bool Done() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+  friend class JobSystem;
+  std::atomic<std::uint32_t> pending_{};
+};
+
+// Work-stealing job system shared by loaders, post-processing and scene
+// preparation, instead of ad-hoc threads that oversubscribe the cores and
+// compete with the threads of a CPU ANARI device.
+//
+// Each worker owns a bounded deque per priority. Workers push and pop their
+// own jobs at the back, most recent first while the data is still in cache,
+// and steal the oldest jobs from the front of other deques when theirs run
+// dry. Other threads share one more set of deques, which they use the same
+// way in Wait(). Workers attribute allocations to the subsystem of the
+// submitter, like RowWorkers.
+class JobSystem {
+public:
+  // Jobs per deque before Submit() runs them inline
+  static constexpr std::size_t kQueueCapacity = 256;
+
+  explicit JobSystem(unsigned workers = DefaultWorkers());
+
+  // Runs the jobs still queued, then joins the workers.
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem(JobSystem&&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+  JobSystem& operator=(JobSystem&&) = delete;
+
+  // Half of the hardware threads, the rest is left to the ANARI device.
+  static unsigned DefaultWorkers();
+
+  unsigned Workers() const { return workers_; }
+
+  // Queues fn() for a worker. counter, if given, counts the job until it has
+  // run. Runs fn() inline if there are no workers or the queue is full.
+  template <typename Fn>
+  void Submit(JobPriority priority, Fn &&fn, JobCounter *counter = nullptr) {
+    Push(Entry{Job{std::forward<Fn>(fn)}, counter, CurrentAllocSubsystem(),
+               priority});
+  }
+
+  // Runs queued jobs on the calling thread until counter is done, so waiting
+  // never idles a core.
+  void Wait(JobCounter &counter);
+
+  struct Stats final {
+    std::array<std::uint64_t, kJobPriorityCount> executed{};
+    // Jobs taken from the deques of another thread
+    std::uint64_t stolen{};
+    // Jobs run by Submit() because of a full queue or no workers
+    std::uint64_t inline_runs{};
+  };
+
+  Stats GetStats() const;
+
+private:
+  struct Entry final {
+    Job job{};
+    JobCounter *counter{};
+    AllocSubsystem subsystem{};
+    JobPriority priority{};
+  };
+
+  // Fixed ring buffer, the owner uses the back and thieves the front.
+  struct Deque final {
+    std::array<Entry, kQueueCapacity> entries{};
+    std::size_t head{};
+    std::size_t size{};
+  };
+
+  // Padded, workers touch their own deques all the time
+  struct alignas(64) WorkerQueues final {
+    std::mutex mutex{};
+    std::array<Deque, kJobPriorityCount> deques{};
+    std::array<std::atomic<std::uint64_t>, kJobPriorityCount> executed{};
+    std::atomic<std::uint64_t> stolen{};
+  };
+
+  void Push(Entry entry);
+  bool TryPop(JobPriority priority, unsigned queue, bool steal,
+              Entry &entry);
+  bool FindJob(Entry &entry);
+  unsigned OwnQueue() const;
+  void Run(Entry &entry);
+  void WorkerLoop(unsigned worker);
+
+  const unsigned workers_;
+  // One per worker and the shared one of other threads at index workers_
+  std::unique_ptr<WorkerQueues[]> queues_{};
+  std::vector<std::thread> threads_{};
+  std::atomic<std::uint64_t> queued_{};
+  std::atomic<std::uint64_t> inline_runs_{};
+
+  // Idle workers and Wait() sleep here
+  std::mutex sleep_mutex_{};
+  std::condition_variable work_cv_{};
+  std::condition_variable done_cv_{};
+  bool stop_{};
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu_features.h"
+
+// Table of host-side SIMD kernels compiled for one instruction set level.
+// Each kernel_<level>.cpp translation unit builds kernels_impl.inl with its
+// own compiler flags and exports one table.
+struct Kernels final {
+  SimdLevel level;
+
+  // Sum of |a[i] - b[i]| over n bytes.
+  std::uint64_t (*sum_abs_diff_u8)(const std::uint8_t *a, const std::uint8_t *b,
+                                   std::size_t n);
+  // Sum of (a[i] - b[i])^2 over n bytes.
+  std::uint64_t (*sum_sq_diff_u8)(const std::uint8_t *a, const std::uint8_t *b,
+                                  std::size_t n);
+
+  // Row conversions into packed RGBA8 display pixels (R in the low byte).
+  // RGBA8 pixels, copied as is.
+  void (*rgba8_to_rgba8)(const std::uint32_t *src, std::uint32_t *dst,
+                         std::size_t n);
+  // Linear float RGBA pixels (4 floats each), encoded to sRGB.
+  void (*rgba32f_to_rgba8)(const float *src, std::uint32_t *dst, std::size_t n);
+  // Depth values mapped to gray levels, near is white. Non-finite depth
+  // (background) is black.
+  void (*depth_to_rgba8)(const float *src, std::uint32_t *dst, std::size_t n,
+                         float depth_min, float depth_max);
+  // Ids visualized with a color hash. The background id ~0u is black.
+  void (*id_to_rgba8)(const std::uint32_t *src, std::uint32_t *dst,
+                      std::size_t n);
+
+  // Blends overlay pixels (RGBA8, straight alpha) over dst where the overlay
+  // is closer than the scene. Depths are distances along the camera ray.
+  void (*composite_overlay_rgba8)(const std::uint32_t *overlay,
+                                  const float *overlay_depth,
+                                  const float *scene_depth, std::uint32_t *dst,
+                                  std::size_t n);
+
+  // Bilinear resampling of one destination row from the two source rows
+  // around it. Column i blends source columns x0[i] and x1[i] with weight
+  // wx[i]; weights are in [0, 256] and give the share of the second sample.
+  void (*bilinear_row_rgba8)(const std::uint32_t *row0,
+                             const std::uint32_t *row1, std::uint32_t wy,
+                             const std::uint32_t *x0, const std::uint32_t *x1,
+                             const std::uint32_t *wx, std::uint32_t *dst,
+                             std::size_t n);
+  // dst = lerp(dst, src, weight[i] * row_weight / 256), weights in [0, 256].
+  void (*blend_rgba8)(const std::uint32_t *src, const std::uint32_t *weight,
+                      std::uint32_t row_weight, std::uint32_t *dst,
+                      std::size_t n);
+
+  // Rebuilds a full row of n pixels from a half row rendered at the column
+  // parity (0: even columns, 1: odd columns). Missing columns take the
+  // history pixel clamped per channel to the range of their two rendered
+  // neighbors, which rejects stale history after motion.
+  void (*reconstruct_interleaved_rgba8)(const std::uint32_t *half,
+                                        const std::uint32_t *history,
+                                        std::uint32_t *dst, std::size_t n,
+                                        std::uint32_t parity);
+
+  // Widens [*min, *max] to cover the finite values in src. Callers seed the
+  // range, e.g. with +inf/-inf.
+  void (*finite_min_max_f32)(const float *src, std::size_t n, float *min,
+                             float *max);
+};
+
+// Kernels for the best level the CPU supports, selected once on first use.
+// The ANARI_PROJECT_SIMD environment variable ("scalar", "sse4.2", "avx2",
+// "avx512", "neon") caps the level, e.g. for A/B benchmarking.
+const Kernels &GetKernels();
+
+// Kernels for a specific level, or nullptr if that level was not compiled in
+// or cannot run on this CPU.
+const Kernels *GetKernelsFor(SimdLevel level);
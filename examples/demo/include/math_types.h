@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+
+using uvec2 = std::array<unsigned int, 2>;
+using uvec3 = std::array<unsigned int, 3>;
+using vec2 = std::array<float, 2>;
+using vec3 = std::array<float, 3>;
+using vec4 = std::array<float, 4>;
+using box2 = std::array<vec2, 2>;
+using box3 = std::array<vec3, 2>;
+
+inline vec3 operator+(vec3 a, vec3 b) {
+  return {a[0] + b[0], a[1] + b[1], a[2] + b[2]};
+}
+
+inline vec3 operator-(vec3 a, vec3 b) {
+  return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+inline vec3 operator*(vec3 a, float s) { return {a[0] * s, a[1] * s, a[2] * s}; }
+
+inline float dot(vec3 a, vec3 b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline vec3 cross(vec3 a, vec3 b) {
+  return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+          a[0] * b[1] - a[1] * b[0]};
+}
+
+inline float length(vec3 a) { return std::sqrt(dot(a, a)); }
+
+inline vec3 normalize(vec3 a) {
+  const float len = length(a);
+  return len > 0.0F ? a * (1.0F / len) : a;
+}
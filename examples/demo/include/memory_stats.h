@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Resident set size of the process as reported by the OS. Zero where a value
+// is not available on the platform.
+struct ProcessMemory final {
+  std::uint64_t rss_bytes{};
+  std::uint64_t peak_rss_bytes{};
+};
+
+ProcessMemory ReadProcessMemory();
+
+// Our own record of the bytes handed to ANARI arrays, per object and
+// parameter. Devices may copy or convert the data, so this is a lower bound
+// of what they hold, but it does not depend on device internals.
+class ArrayAccounting {
+public:
+  struct Entry final {
+    std::string object;
+    std::string parameter;
+    std::uint64_t elements{};
+    std::uint64_t bytes{};
+  };
+
+  void Add(const char *object, const char *parameter, std::uint64_t elements,
+           std::uint64_t bytes);
+
+  const std::vector<Entry> &Entries() const { return entries_; }
+  std::uint64_t TotalBytes() const { return total_bytes_; }
+
+private:
+  std::vector<Entry> entries_{};
+  std::uint64_t total_bytes_{};
+};
+
+// Prints RSS, peak RSS and the ANARI array total labelled with an app phase,
+// and one line per array if per_array is set.
+void PrintMemorySnapshot(const char *phase, const ArrayAccounting &arrays,
+                         bool per_array);
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "frame_telemetry.h"
+
+class UploadScheduler;
+
+// Cumulative histogram of latencies in milliseconds with fixed buckets, in
+// the shape Prometheus expects.
+class LatencyHistogram {
+public:
+  static constexpr std::array<double, 12> kBucketsMs{
+      0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, 33.0, 50.0, 100.0, 250.0, 1000.0};
+
+  void Observe(double ms) {
+    for (std::size_t i = 0; i < kBucketsMs.size(); ++i) {
+      if (ms <= kBucketsMs[i]) {
+        ++counts_[i];
+        break;
+      }
+    }
+    ++count_;
+    sum_ms_ += ms;
+  }
+
+  // Appends the _bucket, _sum and _count series, in seconds.
+  void Render(std::string &out, const char *name, const char *labels) const;
+
+private:
+  std::array<std::uint64_t, kBucketsMs.size()> counts_{};
+  std::uint64_t count_{};
+  double sum_ms_{};
+};
+
+// Metrics of the render loop exported in the Prometheus text format. The
+// loop records every frame, scrapes read from another thread.
+class MetricsRegistry {
+public:
+  void RecordFrame(const FrameTelemetry &telemetry, bool hitch);
+
+  void SetAnariArrayBytes(std::uint64_t bytes);
+
+  // Totals of the ANARI object pool, see AnariPool::Totals().
+  void SetAnariPool(std::uint64_t hits, std::uint64_t misses,
+                    std::uint64_t idle);
+
+  // Uploads waiting in the scheduler and the time to apply them are read
+  // from it at scrape time, the drain estimate is too costly for every
+  // frame. Call before the server starts; uploads must outlive it.
+  void SetUploadScheduler(const UploadScheduler *uploads);
+
+  // Text exposition format, version 0.0.4. Process-wide values (memory,
+  // allocations, device status messages) are read at scrape time.
+  std::string Render() const;
+
+private:
+  mutable std::mutex mutex_{};
+  std::uint64_t frames_{};
+  std::uint64_t hitches_{};
+  std::uint64_t anari_commits_{};
+  std::uint64_t anari_releases_{};
+  std::uint64_t anari_array_bytes_{};
+  std::uint64_t anari_pool_hits_{};
+  std::uint64_t anari_pool_misses_{};
+  std::uint64_t anari_pool_idle_{};
+  const UploadScheduler *uploads_{};
+  double frame_rate_{};
+  std::uint64_t rate_frames_{};
+  std::chrono::steady_clock::time_point rate_start_{};
+  LatencyHistogram frame_histogram_{};
+  std::array<LatencyHistogram, kFrameStageCount> stage_histograms_{};
+};
+
+// Minimal HTTP/1.0 server answering GET /metrics with the registry on
+// 127.0.0.1 only. One connection at a time on its own thread, which is
+// plenty for a scraper every few seconds.
+class MetricsServer {
+public:
+  explicit MetricsServer(const MetricsRegistry &registry)
+      : registry_{registry} {}
+
+  ~MetricsServer();
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer(MetricsServer&&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+  MetricsServer& operator=(MetricsServer&&) = delete;
+
+  // Returns false if the port cannot be bound or sockets are not supported
+  // on the platform.
+  bool Start(std::uint16_t port);
+
+private:
+  void Serve();
+  void HandleConnection(int connection);
+
+  const MetricsRegistry &registry_;
+  int listen_fd_{-1};
+  std::atomic<bool> stop_{};
+  std::thread thread_{};
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frame_view.h"
+#include "math_types.h"
+
+// Parameters of an ANARI perspective camera, enough to project world
+// positions the same way the device generates its primary rays.
+struct CameraState final {
+  vec3 position{};
+  vec3 direction{0.0F, 0.0F, 1.0F};
+  vec3 up{0.0F, 1.0F, 0.0F};
+  float fovy{};
+  float aspect{1.0F};
+
+  bool operator==(const CameraState &) const = default;
+};
+
+// Grid, axes gizmo and point markers rasterized on the host into separate
+// color and depth buffers, then composited over the ANARI image with a depth
+// test against channel.depth. Overlays never add objects to the ANARI world,
+// so editing them only costs a re-rasterization and a composite.
+class OverlayRenderer {
+public:
+  struct Grid final {
+    vec3 center{};
+    float extent{5.0F};
+    float step{1.0F};
+    std::uint32_t color{0xC0A0A0A0U};
+  };
+
+  struct Marker final {
+    vec3 position{};
+    std::uint32_t color{0xFF00FFFFU};
+  };
+
+  void SetGrid(const Grid &grid);
+  void SetGridVisible(bool visible);
+  bool GridVisible() const { return grid_visible_; }
+
+  void SetGizmo(vec3 origin, float length);
+  void SetGizmoVisible(bool visible);
+  bool GizmoVisible() const { return gizmo_visible_; }
+
+  void AddMarker(const Marker &marker);
+  void ClearMarkers();
+  std::size_t MarkerCount() const { return markers_.size(); }
+
+  bool Empty() const {
+    return !grid_visible_ && !gizmo_visible_ && markers_.empty();
+  }
+
+  // Re-rasterizes the overlay if the frame size, the camera or the overlay
+  // contents changed since the last call.
+  void Update(std::uint32_t width, std::uint32_t height,
+              const CameraState &camera);
+
+  // Blends the overlay into color where it is closer than scene_depth (ray
+  // distances as in channel.depth, rows bottom to top). Without scene depth
+  // the overlay is drawn on top.
+  void Composite(FrameView<std::uint32_t> color,
+                 FrameView<const float> scene_depth);
+
+private:
+  void Rasterize();
+  vec3 ToCamera(vec3 world) const;
+  vec2 ToPixel(vec3 camera_space) const;
+  void DrawLine(vec3 a, vec3 b, std::uint32_t color);
+  void DrawMarker(vec3 position, std::uint32_t color);
+  void Plot(int x, int y, float depth, std::uint32_t color);
+
+  bool grid_visible_{};
+  Grid grid_{};
+  bool gizmo_visible_{};
+  vec3 gizmo_origin_{};
+  float gizmo_length_{1.0F};
+  std::vector<Marker> markers_{};
+
+  bool dirty_{true};
+  std::uint32_t width_{};
+  std::uint32_t height_{};
+  CameraState camera_{};
+  vec3 right_{};
+  vec3 true_up_{};
+  vec3 forward_{};
+  float tan_half_fovy_{};
+
+  std::vector<std::uint32_t> color_{};
+  std::vector<float> depth_{};
+  std::vector<float> no_scene_depth_{};
+};
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <anari/anari_cpp.hpp>
+#include <anari/anari_cpp/ext/std.h>
+
+#include "alloc_tracker.h"
+#include "anari_handle.h"
+#include "anari_pool.h"
+#include "array_memory.h"
+#include "async_loader.h"
+#include "async_task.h"
+#include "math_types.h"
+#include "memory_stats.h"
+#include "overlay.h"
+#include "upload_scheduler.h"
+
+// ANARI library of the viewer and the benchmark
+constexpr const char *kDefaultLibrary = "visgl";
+
+constexpr int kWidth = 640;
+constexpr int kHeight = 480;
+constexpr uvec2 kDefaultFrameSize{kWidth, kHeight};
+// ANARI default vertical field of view of perspective cameras
+constexpr float kCameraFovy = 1.04719755F;
+
+// Most verbose ANARI status message severity printed, ANARI_SEVERITY_DEBUG
+// by default. May be changed from any thread.
+void SetAnariLogThreshold(int severity);
+int AnariLogThreshold();
+
+// Frames rendered by RenderSystem. They share the renderer and the world and
+// each has its own camera, so they can cover different parts of the view.
+enum class FrameSlot : std::size_t {
+  // Full view, always enabled
+  kMain,
+  // Full resolution focus region in foveated mode
+  kFocus,
+  // Unjittered full resolution view for quality comparisons, only rendered
+  // on request
+  kReference,
+  kCount,
+};
+
+constexpr box2 kFullImageRegion{vec2{0.0F, 0.0F}, vec2{1.0F, 1.0F}};
+
+class RenderSystem {
+public:
+  RenderSystem() = default;
+
+  // Objects go before the device, the device before its library. Objects
+  // still owned by handles then are reported as leaks.
+  ~RenderSystem();
+
+  RenderSystem(const RenderSystem&) = delete;
+  RenderSystem(RenderSystem&&) = delete;
+  RenderSystem& operator=(const RenderSystem&) = delete;
+  RenderSystem& operator=(RenderSystem&&) = delete;
+
+  void Init(const char *library_name = kDefaultLibrary);
+
+  // NUMA node of the large arrays shared with the device, see
+  // ArrayAllocator. Set on its own, not taken from a thread role: the
+  // device reads the arrays on render threads it creates itself, which the
+  // app does not place. Pick the node those run on, e.g. by starting the
+  // process under numactl. Call before CreateScene().
+  void SetArrayNumaNode(std::optional<unsigned> node) {
+    array_memory_.SetNumaNode(node);
+  }
+
+  void CreateScene(AsyncLoader &loader);
+
+  // Starts replacing the objects in the world with new ones without
+  // blocking the render loop. The texture loads in the background and the
+  // ANARI objects are set up in the frames uploads gives them. Objects come
+  // from pool_, the scene before the current one is recycled into it.
+  void StartStream(AsyncLoader &loader, UploadScheduler &uploads);
+
+  // Forgets finished streams, call once per frame.
+  void PollStreams();
+
+  std::size_t Streams() const { return streams_.size(); }
+
+  // Cancels the streams in flight and waits until they are done. Call
+  // before the loader and uploads go away.
+  void FinishStreams(UploadScheduler &uploads);
+
+  void SetupFrame(ANARIDataType color_format = ANARI_UFIXED8_RGBA_SRGB);
+
+  // FLOAT32 and INT32 renderer parameters, e.g. "pixelSamples".
+  void SetRendererParameter(const char *name, float value);
+  void SetRendererParameter(const char *name, int value);
+
+  // ANARI object commits and releases issued so far.
+  std::uint64_t Commits() const { return commits_; }
+  std::uint64_t Releases() const { return AnariObjectReleases(); }
+
+  // Bytes handed to ANARI arrays so far, per object.
+  const ArrayAccounting &Arrays() const { return scene_.accounting; }
+
+  const AnariPool &Pool() const { return pool_; }
+
+  vec3 GetCameraPosition() { return camera_position_; }
+  vec3 GetCameraUp() { return camera_up_; }
+  vec3 GetCameraDirection() { return camera_direction_; }
+
+  CameraState GetCameraState() {
+    return {camera_position_, camera_direction_, camera_up_, camera_fovy_,
+            camera_aspect_};
+  }
+
+  void UpdateCamera(vec3 pos, vec3 up, vec3 dir);
+
+  // Scripted camera motion of the headless modes. The pose depends on time
+  // alone, so runs are repeatable.
+  void AnimateCamera(float time);
+
+  bool FrameEnabled(FrameSlot slot) { return Target(slot).enabled; }
+
+  // Enabled frames follow the camera; the focus frame is rendered by
+  // RenderFrame() next to the main one.
+  void SetFrameEnabled(FrameSlot slot, bool enabled);
+
+  uvec2 GetFrameSize(FrameSlot slot = FrameSlot::kMain) {
+    return Target(slot).size;
+  }
+
+  void UpdateFrameSize(uvec2 size, FrameSlot slot = FrameSlot::kMain);
+
+  // Width over height of the displayed image, shared by all cameras. It is
+  // not the aspect of the frames, which may be rendered at other shapes,
+  // e.g. half width for interleaving. Updates the overlay projection too,
+  // see GetCameraState().
+  void UpdateCameraAspect(float aspect);
+
+  // Part of the camera sensor rendered into the frame, in normalized screen
+  // coordinates.
+  void UpdateImageRegion(const box2 &region,
+                         FrameSlot slot = FrameSlot::kMain);
+
+  // Renders the main frame and, if enabled, the focus frame. Both are in
+  // flight at the same time.
+  void RenderFrame();
+
+  void RenderFrame(FrameSlot slot);
+
+  anari::MappedFrameData<void> MapChannel(const char *channel,
+                                          FrameSlot slot = FrameSlot::kMain);
+
+  void UnmapChannel(const char *channel, FrameSlot slot = FrameSlot::kMain);
+
+  struct PickResult final {
+    bool hit{};
+    std::uint32_t primitive_id{};
+    std::uint32_t object_id{};
+    std::uint32_t instance_id{};
+  };
+
+  // Reads the id channels at a pixel of the last rendered main frame. The
+  // pixel is given in display coordinates (origin at the bottom-left corner)
+  // and scaled to the frame, which is smaller in foveated mode.
+  PickResult Pick(uvec2 display_pixel, uvec2 display_size);
+
+private:
+  static constexpr const char *kMeshSubtype = "triangle";
+  static constexpr const char *kMaterialSubtype = "matte";
+  static constexpr const char *kSamplerSubtype = "image2D";
+
+  static constexpr const char *kTexturePath = "data/photo.jpg";
+
+  // The scene, a textured quad in front of the camera
+  static constexpr std::array<vec3, 4> kQuadVertices{{{-1.0F, -1.0F, 3.0F},
+                                                      {-1.0F, 1.0F, 3.0F},
+                                                      {1.0F, -1.0F, 3.0F},
+                                                      {1.0F, 1.0F, 3.0F}}};
+  static constexpr std::array<vec2, 4> kQuadUvs{
+      {{1.0F, 1.0F}, {1.0F, 0.0F}, {0.0F, 1.0F}, {0.0F, 0.0F}}};
+  static constexpr std::array<uvec3, 2> kQuadIndices{{{0, 1, 2}, {1, 2, 3}}};
+  static constexpr std::uint64_t kQuadBytes =
+      sizeof(kQuadVertices) + sizeof(kQuadUvs) + sizeof(kQuadIndices);
+  // Bounding sphere of the quad
+  static constexpr vec3 kQuadCenter{0.0F, 0.0F, 3.0F};
+  static constexpr float kQuadRadius = 1.415F;
+
+  template <typename Array> struct SceneArray final {
+    AnariHandle<Array> array{};
+    ANARIDataType type{};
+    std::uint64_t size_x{};
+    std::uint64_t size_y{};
+  };
+
+  // Objects in or for the world, recycled into pool_ when replaced
+  struct SceneObjects final {
+    AnariHandle<anari::Geometry> mesh{};
+    AnariHandle<anari::Sampler> sampler{};
+    AnariHandle<anari::Material> material{};
+    AnariHandle<anari::Surface> surface{};
+    std::vector<SceneArray<anari::Array1D>> arrays_1d{};
+    std::vector<SceneArray<anari::Array2D>> arrays_2d{};
+    ArrayAccounting accounting{};
+  };
+
+  // Sets up the sampler once the texture is loaded and the mesh in uploads
+  // of their own, both in flight at the same time, then the surface in a
+  // third upload in a later frame.
+  Task<> StreamScene(AsyncLoader &loader, UploadScheduler &uploads,
+                     UploadRequest importance);
+  Task<> StreamSampler(AsyncLoader &loader, UploadScheduler &uploads,
+                       UploadRequest importance, SceneObjects &scene);
+  Task<> StreamMesh(UploadScheduler &uploads, UploadRequest importance,
+                    SceneObjects &scene);
+
+  // Sampler of the image, without one if the image is empty. Its array is
+  // kept in scene.
+  AnariHandle<anari::Sampler> NewSampler(
+      const std::optional<DecodedImage> &image, SceneObjects &scene);
+
+  // Image sampler of a texture file, for scene. Reading and decoding run on
+  // the I/O thread and the job system, the ANARI calls on the loading
+  // thread. The sampler is left without an image if loading fails or is
+  // cancelled.
+  Task<AnariHandle<anari::Sampler>> LoadSampler(AsyncLoader &loader,
+                                                std::string path,
+                                                const CancelToken *cancel,
+                                                SceneObjects &scene);
+
+  // The scene, blocking the loading thread in AsyncLoader::Wait(). The
+  // texture is read and decoded in the background while the mesh is set
+  // up; the material and the surface wait for both.
+  Task<SceneObjects> LoadScene(AsyncLoader &loader);
+  Task<> LoadMesh(AsyncLoader &loader, SceneObjects &scene);
+
+  void BuildMesh(SceneObjects &scene);
+
+  // Material of the sampler and the surface of the mesh, both already in
+  // scene.
+  void BuildSurface(SceneObjects &scene);
+
+  // Puts the surface of scene directly onto the world in place of the
+  // current one, which is recycled.
+  void ShowScene(SceneObjects &&scene);
+
+  // Hands the objects of a scene no longer in the world back to pool_, each
+  // after the objects using it, which drop their references when recycled.
+  void RecycleScene(SceneObjects &scene);
+
+  // Importance of uploads to the quad as the main camera sees it: visible
+  // unless its bounding sphere is behind the camera, covering the projected
+  // area of the sphere. Rough, but enough to order uploads.
+  UploadRequest QuadImportance() const;
+
+  struct FrameTarget final {
+    AnariHandle<anari::Camera> camera{};
+    AnariHandle<anari::Frame> frame{};
+    uvec2 size{kDefaultFrameSize};
+    box2 image_region{kFullImageRegion};
+    bool enabled{};
+  };
+
+  FrameTarget &Target(FrameSlot slot) {
+    return targets_[static_cast<std::size_t>(slot)];
+  }
+
+  // Helpers making ANARI calls attribute their allocations to kAnari
+  // themselves. Everything else in RenderSystem is app code of the render
+  // loop and checked by FrameAllocMonitor, e.g. the arrays of SceneObjects.
+  template <typename Object> void Commit(Object object) {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::commitParameters(device_, object);
+    ++commits_;
+  }
+
+  template <typename T, typename... Subtype>
+  AnariHandle<T> New(Subtype... subtype) {
+    AllocScope scope{AllocSubsystem::kAnari};
+    return {device_, anari::newObject<T>(device_, subtype...)};
+  }
+
+  // Sets a copy of data as an array from pool_, shared with the device in
+  // memory of array_memory_, and keeps and records it in scene. Arrays of
+  // object handles are copied by the device, which manages their
+  // references.
+  template <typename Object, typename T>
+  void SetParameterArray1D(SceneObjects &scene, Object object,
+                           const char *object_name, const char *name,
+                           const T *data, std::size_t count) {
+    const std::size_t bytes = sizeof(T) * count;
+    if constexpr (std::is_pointer_v<T>) {
+      AllocScope scope{AllocSubsystem::kAnari};
+      anari::setParameterArray1D(device_, object, name, data, count);
+    } else {
+      constexpr ANARIDataType type = anari::ANARITypeFor<T>::value;
+      auto array = pool_.AcquireArray1D(type, sizeof(T), count);
+      {
+        AllocScope scope{AllocSubsystem::kAnari};
+        std::memcpy(anari::map<void>(device_, array.Get()), data, bytes);
+        anari::unmap(device_, array.Get());
+        anari::setParameter(device_, object, name, array.Get());
+      }
+      scene.arrays_1d.push_back({std::move(array), type, count, 1});
+    }
+    scene.accounting.Add(object_name, name, count, bytes);
+  }
+
+  // Like SetParameterArray1D() for a 2D array of element_size bytes per
+  // element.
+  template <typename Object>
+  void SetParameterArray2D(SceneObjects &scene, Object object,
+                           const char *object_name, const char *name,
+                           ANARIDataType type, std::size_t element_size,
+                           const void *data, std::uint64_t size_x,
+                           std::uint64_t size_y) {
+    const std::uint64_t count = size_x * size_y;
+    const std::size_t bytes = element_size * count;
+    auto array = pool_.AcquireArray2D(type, element_size, size_x, size_y);
+    {
+      AllocScope scope{AllocSubsystem::kAnari};
+      std::memcpy(anari::map<void>(device_, array.Get()), data, bytes);
+      anari::unmap(device_, array.Get());
+      anari::setParameter(device_, object, name, array.Get());
+    }
+    scene.arrays_2d.push_back({std::move(array), type, size_x, size_y});
+    scene.accounting.Add(object_name, name, count, bytes);
+  }
+
+  void CommitCameraPose(anari::Camera camera);
+
+  AnariHandle<anari::Camera> NewCamera();
+
+  AnariHandle<anari::Frame> NewFrame(anari::Camera camera,
+                                     ANARIDataType color_format);
+
+  anari::Library library_{};
+  anari::Device device_{};
+  AnariHandle<anari::Renderer> renderer_{};
+
+  AnariHandle<anari::World> world_{};
+
+  vec3 camera_position_{};
+  vec3 camera_direction_{};
+  vec3 camera_up_{};
+  float camera_fovy_{};
+  float camera_aspect_{};
+
+  std::array<FrameTarget, static_cast<std::size_t>(FrameSlot::kCount)>
+      targets_{};
+
+  // Released through the device when it drops the arrays, so it outlives
+  // device_ in ~RenderSystem()
+  ArrayAllocator array_memory_{};
+  AnariPool pool_{array_memory_};
+  // In the world
+  SceneObjects scene_{};
+  std::vector<Task<>> streams_{};
+  CancelToken stream_cancel_{};
+  std::uint64_t commits_{};
+};
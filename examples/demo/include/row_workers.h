@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "alloc_tracker.h"
+
+// Persistent helper threads for splitting host-side frame processing by rows.
+// The calling thread always takes a share of the rows, so a pool without
+// helper threads runs everything inline. Helpers attribute their allocations
+// to the subsystem of the caller.
+class RowWorkers {
+public:
+  explicit RowWorkers(unsigned helper_threads);
+
+  ~RowWorkers();
+
+  RowWorkers(const RowWorkers&) = delete;
+  RowWorkers(RowWorkers&&) = delete;
+  RowWorkers& operator=(const RowWorkers&) = delete;
+  RowWorkers& operator=(RowWorkers&&) = delete;
+
+  // Number of threads rows are split across, including the caller.
+  unsigned Concurrency() const {
+    return static_cast<unsigned>(threads_.size()) + 1;
+  }
+
+  // Calls fn(begin, end) for disjoint row ranges covering [0, rows) and
+  // returns once all of them are done.
+  template <typename Fn> void ForRows(std::uint32_t rows, Fn &&fn) {
+    Run(rows,
+        [](void *context, std::uint32_t begin, std::uint32_t end) {
+          (*static_cast<std::remove_reference_t<Fn> *>(context))(begin, end);
+        },
+        &fn);
+  }
+
+private:
+  using RangeFn = void (*)(void *context, std::uint32_t begin,
+                           std::uint32_t end);
+
+  void Run(std::uint32_t rows, RangeFn fn, void *context);
+  void WorkerLoop(unsigned index);
+
+  std::vector<std::thread> threads_{};
+
+  std::mutex mutex_{};
+  std::condition_variable start_cv_{};
+  std::condition_variable done_cv_{};
+  std::uint64_t generation_{};
+  unsigned pending_{};
+  bool stop_{};
+
+  RangeFn fn_{};
+  void *context_{};
+  std::uint32_t rows_{};
+  AllocSubsystem subsystem_{};
+};
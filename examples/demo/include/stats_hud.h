@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "frame_telemetry.h"
+#include "frame_view.h"
+
+// Values shown by the HUD that are not part of the frame telemetry.
+struct HudInfo final {
+  const char *mode{""};
+  float render_scale{1.0F};
+  std::uint32_t display_width{};
+  std::uint32_t display_height{};
+  std::uint64_t rss_bytes{};
+  std::uint64_t anari_array_bytes{};
+  // ANARI frames rendered per loop iteration
+  unsigned frames_in_flight{};
+  unsigned row_threads{};
+  // Control commands waiting for the render loop
+  unsigned pending_commands{};
+  std::uint64_t hitches{};
+};
+
+// Statistics panel drawn on the host into a small RGBA8 buffer of its own:
+// a stacked per-stage frame time graph of the last frames, stage averages
+// and a few lines of text in a built-in 5x7 font. The buffer is blended over
+// the displayed image by the caller, the ANARI scene is never touched.
+class StatsHud {
+public:
+  static constexpr std::uint32_t kWidth = 320;
+  static constexpr std::uint32_t kHeight = 128;
+  // Frames shown in the graph
+  static constexpr std::size_t kHistory = 150;
+  static constexpr std::chrono::milliseconds kRedrawPeriod{50};
+
+  StatsHud();
+
+  bool Visible() const { return visible_; }
+  void SetVisible(bool visible) { visible_ = visible; }
+
+  // Cheap enough to call every frame, also while hidden, so the graph is
+  // complete when the HUD is shown.
+  void Record(const FrameTelemetry &telemetry);
+
+  // Redraws the panel, at most every kRedrawPeriod: numbers changing every
+  // frame are unreadable anyway. Returns whether it redrew. Shows the time
+  // its last redraw took, to keep the HUD itself honest.
+  bool Draw(const HudInfo &info);
+
+  // Rows bottom to top, like ANARI frames and glDrawPixels.
+  FrameView<const std::uint32_t> View() const {
+    return {pixels_.data(), kWidth, kHeight};
+  }
+
+private:
+  void Fill(int x, int y, int width, int height, std::uint32_t color);
+  void Text(int x, int y, const char *text, std::uint32_t color);
+
+  bool visible_{};
+  std::chrono::steady_clock::time_point last_draw_{};
+  float draw_ms_{};
+  std::array<FrameTelemetry, kHistory> history_{};
+  std::size_t next_{};
+  std::size_t count_{};
+  std::vector<std::uint32_t> pixels_{};
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Threads of the app, by what they do.
+enum class ThreadRole : std::uint8_t {
+  // Window, input, ANARI calls and display, the render loop
+  kMain,
+  // RowWorkers helpers of host-side frame processing
+  kRows,
+  // JobSystem workers
+  kJobs,
+  // AsyncLoader file reads
+  kIo,
+  kCount,
+};
+
+constexpr std::size_t kThreadRoleCount =
+    static_cast<std::size_t>(ThreadRole::kCount);
+
+const char *ThreadRoleName(ThreadRole role);
+
+// Where the threads of a role run and how they are scheduled. Unset fields
+// leave the thread as the OS started it.
+struct ThreadPlacement final {
+  // CPUs the threads may run on, any if empty
+  std::vector<unsigned> cpus{};
+  // Runs the threads on the CPUs of this node only, intersected with cpus,
+  // and allocates their memory there
+  std::optional<unsigned> numa_node{};
+  // Nice value, -20 to 19. Lower than the default needs CAP_SYS_NICE.
+  std::optional<int> nice{};
+  // SCHED_FIFO priority, 1 to 99, instead of nice. Needs CAP_SYS_NICE.
+  std::optional<int> realtime_priority{};
+};
+
+using ThreadPlacements = std::array<ThreadPlacement, kThreadRoleCount>;
+
+// Option values of the form <role>=<setting>: --cpus jobs=4-7,12,
+// --numa-node io=1, --priority main=-10 or --priority main=rt20.
+bool ParseThreadCpus(const char *value, ThreadPlacements &placements);
+bool ParseThreadNumaNode(const char *value, ThreadPlacements &placements);
+bool ParseThreadPriority(const char *value, ThreadPlacements &placements);
+
+// A NUMA node number as accepted by --numa-node, without the role.
+bool ParseNumaNode(const char *value, std::optional<unsigned> &node);
+
+// Parses the option arg with its value if arg is --cpus, --numa-node or
+// --priority. Returns false if it is none of them or the value is missing or
+// invalid, so the caller can try its other options.
+bool ParseThreadOption(const char *arg, const char *value,
+                       ThreadPlacements &placements);
+
+// Usage lines of the options ParseThreadOption() accepts.
+void PrintThreadUsage();
+
+// Sets the placements threads apply in ThreadPlacementScope. Call before the
+// threads start, threads already running keep theirs.
+void SetThreadPlacements(const ThreadPlacements &placements);
+
+ThreadPlacement GetThreadPlacement(ThreadRole role);
+
+// Applies the placement of a role to the current thread and registers it for
+// ThreadPlacementReport() until the scope ends. Pool threads open one for
+// their whole loop. Only Linux supports placements, elsewhere threads are
+// registered as they are.
+class ThreadPlacementScope {
+public:
+  ThreadPlacementScope(ThreadRole role, unsigned index);
+
+  ~ThreadPlacementScope();
+
+  ThreadPlacementScope(const ThreadPlacementScope&) = delete;
+  ThreadPlacementScope(ThreadPlacementScope&&) = delete;
+  ThreadPlacementScope& operator=(const ThreadPlacementScope&) = delete;
+  ThreadPlacementScope& operator=(ThreadPlacementScope&&) = delete;
+
+private:
+  std::uint64_t id_{};
+};
+
+// Where a registered thread is now.
+struct ThreadReport final {
+  ThreadRole role{};
+  unsigned index{};
+  // OS thread id, 0 if unknown
+  std::int64_t tid{};
+  // CPUs the thread may run on, e.g. "0-3,8"
+  std::string allowed_cpus{};
+  // CPU it last ran on and its node, -1 if unknown
+  int cpu{-1};
+  int numa_node{-1};
+  // "other" with the nice value, or "fifo" with the realtime priority
+  const char *policy{"other"};
+  int priority{};
+  // Settings the OS refused, e.g. "nice: Permission denied"
+  std::string errors{};
+};
+
+std::vector<ThreadReport> ThreadPlacementReport();
+
+// Prints one "Info:" line per registered thread.
+void PrintThreadPlacement();
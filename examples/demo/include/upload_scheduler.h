@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// What an upload to the device costs and how much it matters on screen.
+struct UploadRequest final {
+  // Bytes copied into ANARI arrays and objects committed by the upload
+  std::uint64_t bytes{};
+  std::uint32_t commits{};
+  // Whether what the upload changes is in view, and the fraction of the
+  // view it covers, 0 to 1
+  bool visible{true};
+  float screen_coverage{};
+};
+
+// Spreads ANARI uploads of streamed resources over frames so a burst of
+// finished loads does not stall one frame. Loading coroutines await
+// Upload() where they would continue on the loading thread, and RunFrame()
+// in the render loop resumes the most important ones that fit the budget of
+// the frame: visible before hidden, then by screen coverage, then oldest
+// first. The rest wait for later frames. An upload larger than the whole
+// budget runs alone in a frame. Uploads may be queued from any thread.
+class UploadScheduler {
+public:
+  struct Budget final {
+    std::uint64_t bytes{8 * 1024 * 1024};
+    std::uint32_t commits{16};
+  };
+
+  UploadScheduler() = default;
+
+  explicit UploadScheduler(Budget budget) : budget_{budget} {}
+
+  // Queued uploads must have been resumed, see Flush().
+  ~UploadScheduler() = default;
+
+  UploadScheduler(const UploadScheduler&) = delete;
+  UploadScheduler(UploadScheduler&&) = delete;
+  UploadScheduler& operator=(const UploadScheduler&) = delete;
+  UploadScheduler& operator=(UploadScheduler&&) = delete;
+
+  class UploadAwaiter {
+  public:
+    UploadAwaiter(UploadScheduler &scheduler, UploadRequest request)
+        : scheduler_{scheduler}, request_{request} {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      scheduler_.Push(request_, handle);
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    UploadScheduler &scheduler_;
+    UploadRequest request_;
+  };
+
+  // Continues on the thread in RunFrame() in the first frame the upload
+  // fits in.
+  UploadAwaiter Upload(UploadRequest request) { return {*this, request}; }
+
+  // Resumes the uploads of this frame. Call once per frame from the render
+  // loop. Returns how many were resumed.
+  std::size_t RunFrame();
+
+  // Resumes all queued uploads regardless of the budget, until none are
+  // left, e.g. to finish cancelled loads at shutdown.
+  void Flush();
+
+  struct Stats final {
+    // Queue depth
+    std::size_t queued{};
+    std::uint64_t queued_bytes{};
+    std::uint64_t queued_commits{};
+    // Applied by the last RunFrame()
+    std::uint64_t frame_bytes{};
+    std::uint32_t frame_commits{};
+    std::uint64_t applied{};
+    // Uploads left for a later frame, once per frame they waited
+    std::uint64_t deferred{};
+  };
+
+  // Running totals, cheap enough for every frame.
+  Stats GetStats() const;
+
+  // Until the queue is empty at the current budget and frame rate, if
+  // nothing else is queued
+  struct DrainEstimate final {
+    std::uint64_t frames{};
+    double seconds{};
+  };
+
+  // Packs a copy of the queue into frames the way RunFrame() would. Copies
+  // and sorts the queue, so call it on request, e.g. for a metrics scrape,
+  // rather than every frame.
+  DrainEstimate EstimateDrain() const;
+
+private:
+  struct Pending final {
+    UploadRequest request{};
+    // Order of arrival
+    std::uint64_t sequence{};
+    std::coroutine_handle<> handle{};
+  };
+
+  void Push(const UploadRequest &request, std::coroutine_handle<> handle);
+
+  // Moves the uploads of one frame from pending in importance order to
+  // frame, at least one if any are pending. pending must be sorted.
+  static void TakeFrame(std::vector<Pending> &pending,
+                        std::vector<Pending> &frame, const Budget &budget);
+
+  Budget budget_{};
+
+  mutable std::mutex mutex_{};
+  std::vector<Pending> pending_{};
+  std::uint64_t sequence_{};
+  // Sums over pending_
+  std::uint64_t queued_bytes_{};
+  std::uint64_t queued_commits_{};
+  std::uint64_t frame_bytes_{};
+  std::uint32_t frame_commits_{};
+  std::uint64_t applied_{};
+  std::uint64_t deferred_{};
+  // Average time between RunFrame() calls
+  double frame_seconds_{};
+  std::chrono::steady_clock::time_point last_frame_{};
+
+  // Uploads being resumed, only touched by RunFrame() and Flush()
+  std::vector<Pending> resuming_{};
+};
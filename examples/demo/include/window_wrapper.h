@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <GLFW/glfw3.h>
+
+#include "camera_controller.h"
+#include "frame_pipeline.h"
+#include "math_types.h"
+#include "overlay.h"
+#include "stats_hud.h"
+
+class WindowWrapper {
+public:
+  WindowWrapper(GLFWwindow *window) : window_{window} {}
+
+  ~WindowWrapper();
+
+  WindowWrapper(const WindowWrapper&) = delete;
+  WindowWrapper(WindowWrapper&&) = delete;
+  WindowWrapper& operator=(const WindowWrapper&) = delete;
+  WindowWrapper& operator=(WindowWrapper&&) = delete;
+
+  GLFWwindow *Window() { return window_; }
+
+  void SetOverlay(OverlayRenderer *overlay) { overlay_ = overlay; }
+
+  void SetHud(StatsHud *hud) { hud_ = hud; }
+
+  // Gets the camera input: W, A, S, D, Q and E move, dragging with the left
+  // mouse button rotates, with the right or middle one pans, and scrolling
+  // zooms. O switches between orbit and fly mode, R resets the camera.
+  void SetCameraController(CameraController *camera) { camera_ = camera; }
+
+  bool ConsumePickRequest() { return std::exchange(pick_requested_, false); }
+
+  const char *DisplayChannel() const {
+    return kDisplayChannels[display_channel_];
+  }
+
+  // Accepts full channel names or the part after "channel.". Returns false
+  // for channels that cannot be displayed.
+  bool SetDisplayChannel(const char *channel);
+
+  RenderMode Mode() const { return render_mode_; }
+  void SetRenderMode(RenderMode mode) { render_mode_ = mode; }
+
+  // Center of the foveated focus region in framebuffer pixels (origin at the
+  // bottom-left corner): the cursor when following it, else the center.
+  vec2 FocusCenter(uvec2 framebuffer_size) const;
+
+  void HandleKey(int key, int scancode, int action, int mods);
+  void HandleMouseButton(int button, int action, int mods);
+  void HandleCursor(double x, double y);
+  void HandleScroll(double x_offset, double y_offset);
+
+private:
+  // Marks the corners of the demo quad
+  void ToggleCornerMarkers();
+
+  // Returns false if key does not move the camera.
+  bool HandleCameraKey(int key, int action);
+
+  static constexpr std::array<const char *, 5> kDisplayChannels{
+      "channel.color", "channel.depth", "channel.primitiveId",
+      "channel.objectId", "channel.instanceId"};
+
+  GLFWwindow *window_;
+  OverlayRenderer *overlay_{};
+  StatsHud *hud_{};
+  CameraController *camera_{};
+  // Mouse buttons held, bit n for GLFW button n
+  std::uint32_t mouse_buttons_{};
+  bool pick_requested_{};
+  std::size_t display_channel_{};
+  RenderMode render_mode_{RenderMode::kFull};
+  bool focus_follows_cursor_{};
+};
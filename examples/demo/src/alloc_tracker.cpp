@@ -0,0 +1,284 @@
+#include "alloc_tracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <GLFW/glfw3.h>
+
+constexpr std::size_t kDefaultAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+// One cache line per subsystem, device threads allocate concurrently with
+// the render loop.
+struct alignas(64) SubsystemCounters {
+  std::atomic<std::uint64_t> allocations{};
+  std::atomic<std::uint64_t> deallocations{};
+  std::atomic<std::uint64_t> bytes{};
+};
+
+// Zero-initialized before any dynamic initialization, so allocations made
+// while constructing other globals are counted too.
+static SubsystemCounters counters[kAllocSubsystemCount];
+
+static thread_local AllocSubsystem current_subsystem{AllocSubsystem::kOther};
+
+static void countAllocation(AllocSubsystem subsystem, std::size_t size) {
+  auto &c = counters[static_cast<std::size_t>(subsystem)];
+  c.allocations.fetch_add(1, std::memory_order_relaxed);
+  c.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void countDeallocation(AllocSubsystem subsystem) {
+  counters[static_cast<std::size_t>(subsystem)].deallocations.fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+static void *alignedMalloc(std::size_t size, std::size_t alignment) {
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  // aligned_alloc wants a multiple of the alignment
+  return std::aligned_alloc(alignment,
+                            (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void alignedFree(void *pointer) {
+#ifdef _WIN32
+  _aligned_free(pointer);
+#else
+  std::free(pointer);
+#endif
+}
+
+// Allocation loop of the replaceable operator new: retries through the new
+// handler and throws once there is none.
+static void *allocate(std::size_t size, std::size_t alignment) {
+  size = size == 0 ? 1 : size;
+  while (true) {
+    void *pointer = alignment > kDefaultAlignment
+                        ? alignedMalloc(size, alignment)
+                        : std::malloc(size);
+    if (pointer != nullptr) {
+      countAllocation(current_subsystem, size);
+      return pointer;
+    }
+    const std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+static void *allocateNoThrow(std::size_t size, std::size_t alignment) noexcept {
+  try {
+    return allocate(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+static void deallocate(void *pointer, std::size_t alignment) noexcept {
+  if (pointer == nullptr) {
+    return;
+  }
+  countDeallocation(current_subsystem);
+  if (alignment > kDefaultAlignment) {
+    alignedFree(pointer);
+  } else {
+    std::free(pointer);
+  }
+}
+
+const char *AllocSubsystemName(AllocSubsystem subsystem) {
+  switch (subsystem) {
+  case AllocSubsystem::kOther:
+    return "other";
+  case AllocSubsystem::kApp:
+    return "app";
+  case AllocSubsystem::kAnari:
+    return "anari";
+  case AllocSubsystem::kDisplay:
+    return "display";
+  case AllocSubsystem::kOverlay:
+    return "overlay";
+  case AllocSubsystem::kImages:
+    return "images";
+  case AllocSubsystem::kWindow:
+    return "window";
+  case AllocSubsystem::kCount:
+    break;
+  }
+  return "unknown";
+}
+
+AllocSnapshot TakeAllocSnapshot() {
+  AllocSnapshot snapshot{};
+  for (std::size_t i = 0; i < kAllocSubsystemCount; ++i) {
+    snapshot.subsystems[i] = {
+        counters[i].allocations.load(std::memory_order_relaxed),
+        counters[i].deallocations.load(std::memory_order_relaxed),
+        counters[i].bytes.load(std::memory_order_relaxed)};
+  }
+  return snapshot;
+}
+
+AllocSnapshot operator-(const AllocSnapshot &end, const AllocSnapshot &begin) {
+  AllocSnapshot delta{};
+  for (std::size_t i = 0; i < kAllocSubsystemCount; ++i) {
+    delta.subsystems[i] = {
+        end.subsystems[i].allocations - begin.subsystems[i].allocations,
+        end.subsystems[i].deallocations - begin.subsystems[i].deallocations,
+        end.subsystems[i].bytes - begin.subsystems[i].bytes};
+  }
+  return delta;
+}
+
+AllocSubsystem CurrentAllocSubsystem() { return current_subsystem; }
+
+AllocScope::AllocScope(AllocSubsystem subsystem)
+    : previous_{current_subsystem} {
+  current_subsystem = subsystem;
+}
+
+AllocScope::~AllocScope() { current_subsystem = previous_; }
+
+void *TrackedMalloc(std::size_t size, AllocSubsystem subsystem) {
+  void *pointer = std::malloc(size);
+  if (pointer != nullptr) {
+    countAllocation(subsystem, size);
+  }
+  return pointer;
+}
+
+void *TrackedRealloc(void *pointer, std::size_t size,
+                     AllocSubsystem subsystem) {
+  // realloc(pointer, 0) frees on some C libraries and allocates on others,
+  // do the free explicitly so it is counted either way
+  if (size == 0) {
+    TrackedFree(pointer, subsystem);
+    return nullptr;
+  }
+  void *result = std::realloc(pointer, size);
+  if (result != nullptr) {
+    countAllocation(subsystem, size);
+    if (pointer != nullptr) {
+      countDeallocation(subsystem);
+    }
+  }
+  return result;
+}
+
+void TrackedFree(void *pointer, AllocSubsystem subsystem) {
+  if (pointer != nullptr) {
+    countDeallocation(subsystem);
+    std::free(pointer);
+  }
+}
+
+void InstallGlfwAllocator() {
+#if GLFW_VERSION_MAJOR > 3 ||                                                  \
+    (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+  static const GLFWallocator allocator{
+      [](std::size_t size, void *) {
+        return TrackedMalloc(size, AllocSubsystem::kWindow);
+      },
+      [](void *pointer, std::size_t size, void *) {
+        return TrackedRealloc(pointer, size, AllocSubsystem::kWindow);
+      },
+      [](void *pointer, void *) {
+        TrackedFree(pointer, AllocSubsystem::kWindow);
+      },
+      nullptr};
+  glfwInitAllocator(&allocator);
+#endif
+}
+
+// Replacements of the global allocation functions
+
+void *operator new(std::size_t size) {
+  return allocate(size, kDefaultAlignment);
+}
+
+void *operator new[](std::size_t size) {
+  return allocate(size, kDefaultAlignment);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, kDefaultAlignment);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, kDefaultAlignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer) noexcept {
+  deallocate(pointer, kDefaultAlignment);
+}
+
+void operator delete[](void *pointer) noexcept {
+  deallocate(pointer, kDefaultAlignment);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  deallocate(pointer, kDefaultAlignment);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+  deallocate(pointer, kDefaultAlignment);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  deallocate(pointer, kDefaultAlignment);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  deallocate(pointer, kDefaultAlignment);
+}
+
+void operator delete(void *pointer, std::align_val_t alignment) noexcept {
+  deallocate(pointer, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *pointer, std::align_val_t alignment) noexcept {
+  deallocate(pointer, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer, std::size_t,
+                     std::align_val_t alignment) noexcept {
+  deallocate(pointer, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *pointer, std::size_t,
+                       std::align_val_t alignment) noexcept {
+  deallocate(pointer, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  deallocate(pointer, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *pointer, std::align_val_t alignment,
+                       const std::nothrow_t &) noexcept {
+  deallocate(pointer, static_cast<std::size_t>(alignment));
+}
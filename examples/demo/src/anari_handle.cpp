@@ -0,0 +1,107 @@
+#include "anari_handle.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+// Object types handles may own, with the names reported for them
+struct TrackedType final {
+  ANARIDataType type;
+  const char *name;
+};
+
+constexpr std::array<TrackedType, 16> kTrackedTypes{{
+    {ANARI_ARRAY1D, "Array1D"},
+    {ANARI_ARRAY2D, "Array2D"},
+    {ANARI_ARRAY3D, "Array3D"},
+    {ANARI_CAMERA, "Camera"},
+    {ANARI_FRAME, "Frame"},
+    {ANARI_GEOMETRY, "Geometry"},
+    {ANARI_GROUP, "Group"},
+    {ANARI_INSTANCE, "Instance"},
+    {ANARI_LIGHT, "Light"},
+    {ANARI_MATERIAL, "Material"},
+    {ANARI_RENDERER, "Renderer"},
+    {ANARI_SAMPLER, "Sampler"},
+    {ANARI_SPATIAL_FIELD, "SpatialField"},
+    {ANARI_SURFACE, "Surface"},
+    {ANARI_VOLUME, "Volume"},
+    {ANARI_WORLD, "World"},
+}};
+
+struct TypeCounters final {
+  std::atomic<std::uint64_t> created{};
+  std::atomic<std::uint64_t> released{};
+};
+
+// One more for types not in kTrackedTypes
+static std::array<TypeCounters, kTrackedTypes.size() + 1> type_counters{};
+
+static std::size_t typeIndex(ANARIDataType type) {
+  for (std::size_t i = 0; i < kTrackedTypes.size(); ++i) {
+    if (kTrackedTypes[i].type == type) {
+      return i;
+    }
+  }
+  return kTrackedTypes.size();
+}
+
+const char *AnariTypeName(ANARIDataType type) {
+  const std::size_t index = typeIndex(type);
+  return index < kTrackedTypes.size() ? kTrackedTypes[index].name : "other";
+}
+
+void TrackAnariObject(ANARIDataType type, bool created) {
+  TypeCounters &counters = type_counters[typeIndex(type)];
+  (created ? counters.created : counters.released)
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<AnariObjectCount> GetAnariObjectCounts() {
+  std::vector<AnariObjectCount> counts{};
+  for (std::size_t i = 0; i < type_counters.size(); ++i) {
+    const std::uint64_t created =
+        type_counters[i].created.load(std::memory_order_relaxed);
+    const std::uint64_t released =
+        type_counters[i].released.load(std::memory_order_relaxed);
+    if (created == 0) {
+      continue;
+    }
+    counts.push_back(
+        {i < kTrackedTypes.size() ? kTrackedTypes[i].name : "other",
+         static_cast<std::int64_t>(created - released), created, released});
+  }
+  return counts;
+}
+
+std::uint64_t AnariObjectReleases() {
+  std::uint64_t released{};
+  for (const TypeCounters &counters : type_counters) {
+    released += counters.released.load(std::memory_order_relaxed);
+  }
+  return released;
+}
+
+bool PrintAnariObjectCounts(const char *phase, bool expect_none) {
+  std::int64_t live{};
+  std::string types{};
+  for (const AnariObjectCount &count : GetAnariObjectCounts()) {
+    if (count.live == 0) {
+      continue;
+    }
+    live += count.live;
+    types += ' ';
+    types += count.type;
+    types += '=';
+    types += std::to_string(count.live);
+  }
+  if (expect_none && live > 0) {
+    std::printf("WARNING: %lld ANARI objects leaked at %s:%s\n",
+                static_cast<long long>(live), phase, types.c_str());
+  } else {
+    std::printf("Objects: %-12s live=%lld%s\n", phase,
+                static_cast<long long>(live), types.c_str());
+  }
+  return live == 0;
+}
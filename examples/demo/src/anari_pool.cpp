@@ -0,0 +1,176 @@
+#include "anari_pool.h"
+
+#include <cstdio>
+
+#include "alloc_tracker.h"
+
+AnariHandle<anari::Array1D> AnariPool::AcquireArray1D(
+    ANARIDataType element_type, std::size_t element_size,
+    std::uint64_t count) {
+  Bucket &bucket = Find({ANARI_ARRAY1D, nullptr, element_type, count, 1});
+  if (ANARIObject object = Take(bucket)) {
+    return AnariHandle<anari::Array1D>::Adopt(
+        device_, static_cast<anari::Array1D>(object));
+  }
+  void *memory = allocator_.Allocate(element_size * count);
+  AllocScope scope{AllocSubsystem::kAnari};
+  return {device_,
+          anari::newArray1D(device_, memory, &ArrayAllocator::Deleter,
+                            &allocator_, element_type, count)};
+}
+
+AnariHandle<anari::Array2D> AnariPool::AcquireArray2D(
+    ANARIDataType element_type, std::size_t element_size, std::uint64_t size_x,
+    std::uint64_t size_y) {
+  Bucket &bucket =
+      Find({ANARI_ARRAY2D, nullptr, element_type, size_x, size_y});
+  if (ANARIObject object = Take(bucket)) {
+    return AnariHandle<anari::Array2D>::Adopt(
+        device_, static_cast<anari::Array2D>(object));
+  }
+  void *memory = allocator_.Allocate(element_size * size_x * size_y);
+  AllocScope scope{AllocSubsystem::kAnari};
+  return {device_,
+          anari::newArray2D(device_, memory, &ArrayAllocator::Deleter,
+                            &allocator_, element_type, size_x, size_y)};
+}
+
+void AnariPool::RecycleArray(AnariHandle<anari::Array1D> &&array,
+                             ANARIDataType element_type, std::uint64_t count) {
+  if (array) {
+    Keep(Find({ANARI_ARRAY1D, nullptr, element_type, count, 1}),
+         array.Detach());
+  }
+}
+
+void AnariPool::RecycleArray(AnariHandle<anari::Array2D> &&array,
+                             ANARIDataType element_type, std::uint64_t size_x,
+                             std::uint64_t size_y) {
+  if (array) {
+    Keep(Find({ANARI_ARRAY2D, nullptr, element_type, size_x, size_y}),
+         array.Detach());
+  }
+}
+
+void AnariPool::Clear() {
+  AllocScope scope{AllocSubsystem::kAnari};
+  for (Bucket &bucket : buckets_) {
+    for (ANARIObject object : bucket.idle) {
+      anari::release(device_, object);
+      TrackAnariObject(bucket.type, false);
+    }
+    bucket.idle.clear();
+    bucket.stats.idle = 0;
+  }
+}
+
+std::vector<AnariPool::Stats> AnariPool::GetStats() const {
+  std::vector<Stats> stats{};
+  stats.reserve(buckets_.size());
+  for (const Bucket &bucket : buckets_) {
+    Stats &kind = stats.emplace_back(bucket.stats);
+    kind.kind = AnariTypeName(bucket.type);
+    char size[64];
+    if (bucket.type == ANARI_ARRAY1D) {
+      std::snprintf(size, sizeof(size), " %llu of type %d",
+                    static_cast<unsigned long long>(bucket.size_x),
+                    static_cast<int>(bucket.element_type));
+      kind.kind += size;
+    } else if (bucket.type == ANARI_ARRAY2D) {
+      std::snprintf(size, sizeof(size), " %llux%llu of type %d",
+                    static_cast<unsigned long long>(bucket.size_x),
+                    static_cast<unsigned long long>(bucket.size_y),
+                    static_cast<int>(bucket.element_type));
+      kind.kind += size;
+    } else if (!bucket.subtype.empty()) {
+      kind.kind += ' ';
+      kind.kind += bucket.subtype;
+    }
+  }
+  return stats;
+}
+
+AnariPool::Stats AnariPool::Totals() const {
+  Stats totals{};
+  for (const Bucket &bucket : buckets_) {
+    totals.hits += bucket.stats.hits;
+    totals.misses += bucket.stats.misses;
+    totals.recycled += bucket.stats.recycled;
+    totals.dropped += bucket.stats.dropped;
+    totals.idle += bucket.stats.idle;
+  }
+  return totals;
+}
+
+void AnariPool::PrintStats(const char *phase) const {
+  const Stats totals = Totals();
+  const std::uint64_t acquired = totals.hits + totals.misses;
+  std::printf("Objects: %-12s pool hits=%llu misses=%llu hit_rate=%.1f%% "
+              "idle=%zu\n",
+              phase, static_cast<unsigned long long>(totals.hits),
+              static_cast<unsigned long long>(totals.misses),
+              acquired > 0 ? 100.0 * static_cast<double>(totals.hits) /
+                                 static_cast<double>(acquired)
+                           : 0.0,
+              totals.idle);
+  for (const Stats &kind : GetStats()) {
+    std::printf("Objects:   %s: hits=%llu misses=%llu recycled=%llu "
+                "dropped=%llu idle=%zu\n",
+                kind.kind.c_str(), static_cast<unsigned long long>(kind.hits),
+                static_cast<unsigned long long>(kind.misses),
+                static_cast<unsigned long long>(kind.recycled),
+                static_cast<unsigned long long>(kind.dropped), kind.idle);
+  }
+}
+
+AnariPool::Bucket &AnariPool::Find(const Key &key) {
+  const char *subtype = key.subtype != nullptr ? key.subtype : "";
+  for (Bucket &bucket : buckets_) {
+    if (bucket.type == key.type && bucket.element_type == key.element_type &&
+        bucket.size_x == key.size_x && bucket.size_y == key.size_y &&
+        bucket.subtype == subtype) {
+      return bucket;
+    }
+  }
+  return buckets_.emplace_back(Bucket{.type = key.type,
+                                      .subtype = subtype,
+                                      .element_type = key.element_type,
+                                      .size_x = key.size_x,
+                                      .size_y = key.size_y});
+}
+
+ANARIObject AnariPool::Take(Bucket &bucket) {
+  if (bucket.idle.empty()) {
+    ++bucket.stats.misses;
+    return nullptr;
+  }
+  ANARIObject object = bucket.idle.back();
+  bucket.idle.pop_back();
+  ++bucket.stats.hits;
+  bucket.stats.idle = bucket.idle.size();
+  return object;
+}
+
+void AnariPool::RecycleObject(ANARIObject object, const Key &key) {
+  // Committing without parameters drops the references the device holds
+  // for them, e.g. to the arrays of a geometry
+  {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::unsetAllParameters(device_, object);
+    anari::commitParameters(device_, object);
+  }
+  Keep(Find(key), object);
+}
+
+void AnariPool::Keep(Bucket &bucket, ANARIObject object) {
+  ++bucket.stats.recycled;
+  if (bucket.idle.size() >= kMaxIdle) {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::release(device_, object);
+    TrackAnariObject(bucket.type, false);
+    ++bucket.stats.dropped;
+    return;
+  }
+  bucket.idle.push_back(object);
+  bucket.stats.idle = bucket.idle.size();
+}
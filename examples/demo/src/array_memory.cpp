@@ -0,0 +1,148 @@
+#include "array_memory.h"
+
+#include <cstdio>
+#include <new>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#endif
+
+static double mebibytes(std::uint64_t bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+void *ArrayAllocator::Allocate(std::size_t bytes) {
+  Block block{.bytes = bytes};
+  void *memory = bytes >= kHugePageSize ? MapLarge(bytes, block) : nullptr;
+  if (memory == nullptr) {
+    block.mapped = bytes;
+    block.backing = Backing::kHeap;
+    memory = ::operator new(bytes, std::align_val_t{kAlignment});
+  }
+  std::lock_guard lock{mutex_};
+  blocks_[memory] = block;
+  return memory;
+}
+
+void ArrayAllocator::Free(const void *memory) {
+  Block block{};
+  {
+    std::lock_guard lock{mutex_};
+    auto it = blocks_.find(memory);
+    if (it == blocks_.end()) {
+      std::printf("Error: Freeing unknown array memory %p\n", memory);
+      return;
+    }
+    block = it->second;
+    blocks_.erase(it);
+  }
+  void *mutable_memory = const_cast<void *>(memory);
+  if (block.backing == Backing::kHeap) {
+    ::operator delete(mutable_memory, std::align_val_t{kAlignment});
+    return;
+  }
+#ifdef __linux__
+  munmap(mutable_memory, block.mapped);
+#endif
+}
+
+void ArrayAllocator::Deleter(const void *allocator, const void *memory) {
+  const_cast<ArrayAllocator *>(static_cast<const ArrayAllocator *>(allocator))
+      ->Free(memory);
+}
+
+// Null where huge pages are not supported, the heap serves those arrays.
+void *ArrayAllocator::MapLarge(std::size_t bytes, Block &block) {
+#ifdef __linux__
+  block.mapped = (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  // The hugetlb pool is usually empty unless reserved by the admin, mapping
+  // fails right away then
+  void *memory = mmap(nullptr, block.mapped, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+                      -1, 0);
+  block.backing = Backing::kHugeTlb;
+  if (memory == MAP_FAILED) {
+    // Over-map so a huge page aligned range can be cut out, the kernel only
+    // backs aligned 2 MiB ranges with transparent huge pages
+    const std::size_t over = block.mapped + kHugePageSize;
+    void *raw = mmap(nullptr, over, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      return nullptr;
+    }
+    const auto start = reinterpret_cast<std::uintptr_t>(raw);
+    const std::uintptr_t aligned =
+        (start + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    if (aligned > start) {
+      munmap(raw, aligned - start);
+    }
+    const std::size_t tail = start + over - (aligned + block.mapped);
+    if (tail > 0) {
+      munmap(reinterpret_cast<void *>(aligned + block.mapped), tail);
+    }
+    memory = reinterpret_cast<void *>(aligned);
+    // Best effort, THP may be disabled system wide
+    madvise(memory, block.mapped, MADV_HUGEPAGE);
+    block.backing = Backing::kTransparent;
+  }
+  if (numa_node_) {
+    // Preferred rather than bound, the array still fits when the node is
+    // full. Nothing has touched the pages yet. The kernel wants one more
+    // than the bits of the mask.
+    const unsigned long mask = 1UL << *numa_node_;
+    if (syscall(SYS_mbind, memory, block.mapped, MPOL_PREFERRED, &mask,
+                sizeof(mask) * 8 + 1, 0) != 0) {
+      std::lock_guard lock{mutex_};
+      ++numa_failures_;
+    }
+  }
+  return memory;
+#else
+  (void)bytes;
+  (void)block;
+  return nullptr;
+#endif
+}
+
+ArrayAllocator::Stats ArrayAllocator::GetStats() const {
+  Stats stats{};
+  std::lock_guard lock{mutex_};
+  for (const auto &[memory, block] : blocks_) {
+    ++stats.arrays;
+    stats.bytes += block.bytes;
+    switch (block.backing) {
+    case Backing::kHeap:
+      stats.heap_bytes += block.mapped;
+      break;
+    case Backing::kHugeTlb:
+      stats.hugetlb_bytes += block.mapped;
+      break;
+    case Backing::kTransparent:
+      stats.transparent_bytes += block.mapped;
+      break;
+    }
+  }
+  stats.numa_failures = numa_failures_;
+  return stats;
+}
+
+void ArrayAllocator::PrintStats() const {
+  const Stats stats = GetStats();
+  char node[16] = "any";
+  if (numa_node_) {
+    std::snprintf(node, sizeof(node), "%u", *numa_node_);
+  }
+  std::printf("Info: Shared arrays: %llu using %.2f MiB, hugetlb %.2f MiB, "
+              "transparent huge pages %.2f MiB, heap %.2f MiB, numa node %s, "
+              "%llu not placed\n",
+              static_cast<unsigned long long>(stats.arrays),
+              mebibytes(stats.bytes), mebibytes(stats.hugetlb_bytes),
+              mebibytes(stats.transparent_bytes), mebibytes(stats.heap_bytes),
+              node, static_cast<unsigned long long>(stats.numa_failures));
+}
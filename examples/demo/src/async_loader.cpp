@@ -0,0 +1,197 @@
+#include "async_loader.h"
+
+#include <cstdio>
+
+// stb_image allocates through the tracker, see alloc_tracker.h
+#include "alloc_tracker.h"
+#define STBI_MALLOC(size) TrackedMalloc(size, AllocSubsystem::kImages)
+#define STBI_REALLOC(pointer, size)                                            \
+  TrackedRealloc(pointer, size, AllocSubsystem::kImages)
+#define STBI_FREE(pointer) TrackedFree(pointer, AllocSubsystem::kImages)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "thread_placement.h"
+
+void DecodedImage::Free::operator()(unsigned char *data) const {
+  stbi_image_free(data);
+}
+
+const char *IoBackendName(IoBackend backend) {
+  switch (backend) {
+  case IoBackend::kAuto:
+    return "auto";
+  case IoBackend::kRing:
+    return "io_uring";
+  case IoBackend::kThreads:
+    return "threads";
+  }
+  return "unknown";
+}
+
+AsyncLoader::AsyncLoader(JobSystem &jobs, IoBackend backend) : jobs_{jobs} {
+  if (backend != IoBackend::kThreads && ring_.Init()) {
+    backend_ = IoBackend::kRing;
+    io_threads_.emplace_back([this] { RingLoop(); });
+    return;
+  }
+  if (backend == IoBackend::kRing) {
+    std::printf("WARNING: io_uring is not available, reading files on "
+                "threads\n");
+  }
+  backend_ = IoBackend::kThreads;
+  for (unsigned i = 0; i < kIoThreads; ++i) {
+    io_threads_.emplace_back([this, i] { IoLoop(i); });
+  }
+}
+
+AsyncLoader::~AsyncLoader() {
+  {
+    std::lock_guard lock{mutex_};
+    stop_ = true;
+  }
+  io_cv_.notify_all();
+  for (auto &thread : io_threads_) {
+    thread.join();
+  }
+}
+
+void AsyncLoader::ReadAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  handle_ = handle;
+  // This awaiter is gone as soon as an I/O thread has the request
+  AsyncLoader &loader = loader_;
+  {
+    std::lock_guard lock{loader.mutex_};
+    loader.io_requests_.push_back({this});
+  }
+  loader.io_cv_.notify_one();
+}
+
+// Notifies under the lock, so the loading thread cannot finish the task and
+// destroy the loader before the notification is out.
+void AsyncLoader::PostToLoadingThread(std::coroutine_handle<> handle) {
+  std::lock_guard lock{mutex_};
+  loading_steps_.push_back(handle);
+  loading_cv_.notify_all();
+}
+
+// Likewise for the waiter seeing the task done.
+void AsyncLoader::OnTaskDone(void *context, std::atomic<bool> &done) {
+  auto *loader = static_cast<AsyncLoader *>(context);
+  std::lock_guard lock{loader->mutex_};
+  done.store(true, std::memory_order_release);
+  loader->loading_cv_.notify_all();
+}
+
+static std::optional<FileData> readWholeFile(const char *path) {
+  std::FILE *file = std::fopen(path, "rb");
+  if (file == nullptr) {
+    std::printf("Error: Cannot open %s\n", path);
+    return std::nullopt;
+  }
+  FileData data{};
+  if (std::fseek(file, 0, SEEK_END) == 0) {
+    const long size = std::ftell(file);
+    if (size > 0) {
+      data.resize(static_cast<std::size_t>(size));
+    }
+    std::fseek(file, 0, SEEK_SET);
+  }
+  const std::size_t read = std::fread(data.data(), 1, data.size(), file);
+  std::fclose(file);
+  if (read != data.size()) {
+    std::printf("Error: Cannot read %s\n", path);
+    return std::nullopt;
+  }
+  return data;
+}
+
+void AsyncLoader::IoLoop(unsigned index) {
+  ThreadPlacementScope placement{ThreadRole::kIo, index};
+  while (true) {
+    IoRequest request{};
+    {
+      std::unique_lock lock{mutex_};
+      io_cv_.wait(lock, [this] { return stop_ || !io_requests_.empty(); });
+      if (io_requests_.empty()) {
+        return;
+      }
+      request = io_requests_.front();
+      io_requests_.pop_front();
+    }
+    ReadAwaiter &awaiter = *request.awaiter;
+    if (!IsCancelled(awaiter.cancel_)) {
+      awaiter.result_ = readWholeFile(awaiter.path_.c_str());
+    }
+    Resume(awaiter);
+  }
+}
+
+// Keeps the ring full from the queue, then hands reads on as they finish,
+// not once per batch.
+void AsyncLoader::RingLoop() {
+  ThreadPlacementScope placement{ThreadRole::kIo, 0};
+  std::vector<IoRing::Completion> done{};
+  std::vector<ReadAwaiter *> cancelled{};
+  while (true) {
+    {
+      std::unique_lock lock{mutex_};
+      if (ring_.Idle()) {
+        io_cv_.wait(lock, [this] { return stop_ || !io_requests_.empty(); });
+        if (io_requests_.empty()) {
+          return;
+        }
+      }
+      while (!ring_.Full() && !io_requests_.empty()) {
+        ReadAwaiter &awaiter = *io_requests_.front().awaiter;
+        io_requests_.pop_front();
+        if (IsCancelled(awaiter.cancel_)) {
+          cancelled.push_back(&awaiter);
+          continue;
+        }
+        awaiter.result_.emplace();
+        ring_.Read(awaiter.path_.c_str(), &*awaiter.result_, &awaiter);
+      }
+    }
+    for (ReadAwaiter *awaiter : cancelled) {
+      Resume(*awaiter);
+    }
+    cancelled.clear();
+    ring_.Reap(done);
+    for (const IoRing::Completion &completion : done) {
+      auto &awaiter = *static_cast<ReadAwaiter *>(completion.user);
+      if (!completion.ok) {
+        awaiter.result_.reset();
+      }
+      Resume(awaiter);
+    }
+    done.clear();
+  }
+}
+
+// Whatever comes after a read is not I/O
+void AsyncLoader::Resume(ReadAwaiter &awaiter) {
+  const std::coroutine_handle<> handle = awaiter.handle_;
+  jobs_.Submit(JobPriority::kBackground, [handle] { handle.resume(); });
+}
+
+Task<std::optional<DecodedImage>> LoadImage(AsyncLoader &loader,
+                                            std::string path,
+                                            const CancelToken *cancel) {
+  std::optional<FileData> file = co_await loader.ReadFile(path, cancel);
+  if (!file || IsCancelled(cancel)) {
+    co_return std::nullopt;
+  }
+  DecodedImage image{};
+  image.data.reset(stbi_load_from_memory(
+      file->data(), static_cast<int>(file->size()), &image.size_x,
+      &image.size_y, &image.components, 0));
+  if (!image.data) {
+    std::printf("Error: Cannot decode %s: %s\n", path.c_str(),
+                stbi_failure_reason());
+    co_return std::nullopt;
+  }
+  std::printf("Image: x=%d, y=%d, c=%d, path=%s\n", image.size_x,
+              image.size_y, image.components, path.c_str());
+  co_return image;
+}
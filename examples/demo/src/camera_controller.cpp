@@ -0,0 +1,157 @@
+#include "camera_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Mouse rotation and panning, per pixel the cursor moved. Panning is scaled
+// by the distance to the target, so the target follows the cursor roughly.
+constexpr float kRotatePerPixel = 0.005F;
+constexpr float kPanPerPixel = 0.0015F;
+// Orbit mode: distance factor per scroll step and rates of held keys
+constexpr float kZoomPerStep = 0.9F;
+constexpr float kZoomRate = 1.0F;
+constexpr float kTurnRate = 1.5F;
+constexpr float kMinDistance = 0.1F;
+constexpr float kMaxDistance = 100.0F;
+// Fly mode: initial speed in units per second and its factor per scroll
+// step
+constexpr float kDefaultFlySpeed = 2.0F;
+constexpr float kFlySpeedPerStep = 1.2F;
+constexpr float kMinFlySpeed = 0.05F;
+constexpr float kMaxFlySpeed = 100.0F;
+// Keeps the view direction off the poles, where up is undefined
+constexpr float kMaxPitch = 1.55F;
+// Longest frame integrated, so a stall does not throw the camera away
+constexpr float kMaxStepSeconds = 0.1F;
+
+constexpr vec3 kWorldUp{0.0F, 1.0F, 0.0F};
+
+CameraController::CameraController(vec3 position, vec3 target)
+    : start_position_{position}, start_target_{target} {
+  LookAt(position, target);
+}
+
+void CameraController::SetMode(CameraMode mode) { mode_ = mode; }
+
+void CameraController::SetKey(Key key, bool held) {
+  ++stats_.events;
+  keys_[static_cast<std::size_t>(key)] = held;
+}
+
+void CameraController::SetDrag(Drag drag) {
+  ++stats_.events;
+  drag_ = drag;
+}
+
+void CameraController::MoveCursor(double x, double y) {
+  ++stats_.events;
+  if (has_cursor_) {
+    if (drag_ == Drag::kRotate) {
+      rotate_x_ += x - cursor_x_;
+      rotate_y_ += y - cursor_y_;
+    } else if (drag_ == Drag::kPan) {
+      pan_x_ += x - cursor_x_;
+      pan_y_ += y - cursor_y_;
+    }
+  }
+  has_cursor_ = true;
+  cursor_x_ = x;
+  cursor_y_ = y;
+}
+
+void CameraController::Scroll(double steps) {
+  ++stats_.events;
+  scroll_ += steps;
+}
+
+void CameraController::Reset() {
+  ++stats_.events;
+  LookAt(start_position_, start_target_);
+  dirty_ = true;
+}
+
+bool CameraController::Update(float seconds) {
+  seconds = std::clamp(seconds, 0.0F, kMaxStepSeconds);
+  auto axis = [this](Key positive, Key negative) {
+    return (keys_[static_cast<std::size_t>(positive)] ? 1.0F : 0.0F) -
+           (keys_[static_cast<std::size_t>(negative)] ? 1.0F : 0.0F);
+  };
+  const float forward = axis(Key::kForward, Key::kBack);
+  const float right = axis(Key::kRight, Key::kLeft);
+  const float rise = axis(Key::kUp, Key::kDown);
+  const bool changed = dirty_ || forward != 0.0F || right != 0.0F ||
+                       rise != 0.0F || rotate_x_ != 0.0 ||
+                       rotate_y_ != 0.0 || pan_x_ != 0.0 || pan_y_ != 0.0 ||
+                       scroll_ != 0.0;
+  if (!changed) {
+    return false;
+  }
+
+  // Dragging right turns the scene right in orbit mode and looks right in
+  // fly mode, both turn the camera the same way
+  const vec3 position = pose_.position;
+  yaw_ -= static_cast<float>(rotate_x_) * kRotatePerPixel;
+  pitch_ -= static_cast<float>(rotate_y_) * kRotatePerPixel;
+  if (mode_ == CameraMode::kOrbit) {
+    yaw_ += right * kTurnRate * seconds;
+    pitch_ -= rise * kTurnRate * seconds;
+  }
+  pitch_ = std::clamp(pitch_, -kMaxPitch, kMaxPitch);
+  const vec3 direction = Direction();
+  const vec3 side = normalize(cross(direction, kWorldUp));
+  const vec3 up = cross(side, direction);
+
+  // The scene follows the cursor when panning
+  const float pan = kPanPerPixel * distance_;
+  const vec3 pan_offset = side * (-static_cast<float>(pan_x_) * pan) +
+                          up * (static_cast<float>(pan_y_) * pan);
+
+  if (mode_ == CameraMode::kOrbit) {
+    distance_ *= std::exp(-forward * kZoomRate * seconds) *
+                 std::pow(kZoomPerStep, static_cast<float>(scroll_));
+    distance_ = std::clamp(distance_, kMinDistance, kMaxDistance);
+    target_ = target_ + pan_offset;
+  } else {
+    // Turns around the camera position rather than the target
+    fly_speed_ = std::clamp(
+        fly_speed_ * std::pow(kFlySpeedPerStep, static_cast<float>(scroll_)),
+        kMinFlySpeed, kMaxFlySpeed);
+    const vec3 move = direction * forward + side * right + kWorldUp * rise;
+    target_ = position + direction * distance_ + pan_offset +
+              move * (fly_speed_ * seconds);
+  }
+  UpdatePose();
+
+  dirty_ = false;
+  rotate_x_ = 0.0;
+  rotate_y_ = 0.0;
+  pan_x_ = 0.0;
+  pan_y_ = 0.0;
+  scroll_ = 0.0;
+  ++stats_.updates;
+  return true;
+}
+
+void CameraController::LookAt(vec3 position, vec3 target) {
+  target_ = target;
+  const vec3 offset = target - position;
+  distance_ = std::clamp(length(offset), kMinDistance, kMaxDistance);
+  const vec3 direction = normalize(offset);
+  yaw_ = std::atan2(direction[0], direction[2]);
+  pitch_ = std::clamp(std::asin(std::clamp(direction[1], -1.0F, 1.0F)),
+                      -kMaxPitch, kMaxPitch);
+  fly_speed_ = kDefaultFlySpeed;
+  UpdatePose();
+}
+
+vec3 CameraController::Direction() const {
+  return {std::cos(pitch_) * std::sin(yaw_), std::sin(pitch_),
+          std::cos(pitch_) * std::cos(yaw_)};
+}
+
+void CameraController::UpdatePose() {
+  pose_.direction = Direction();
+  pose_.position = target_ - pose_.direction * distance_;
+  const vec3 side = normalize(cross(pose_.direction, kWorldUp));
+  pose_.up = cross(side, pose_.direction);
+}
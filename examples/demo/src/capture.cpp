@@ -0,0 +1,20 @@
+#include "capture.h"
+
+#include "alloc_tracker.h"
+
+#define STBIW_MALLOC(size) TrackedMalloc(size, AllocSubsystem::kImages)
+#define STBIW_REALLOC(pointer, size)                                           \
+  TrackedRealloc(pointer, size, AllocSubsystem::kImages)
+#define STBIW_FREE(pointer) TrackedFree(pointer, AllocSubsystem::kImages)
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+bool WriteCapturePng(const char *path, FrameView<const std::uint32_t> image) {
+  if (image.Empty()) {
+    return false;
+  }
+  stbi_flip_vertically_on_write(1);
+  return stbi_write_png(path, static_cast<int>(image.Width()),
+                        static_cast<int>(image.Height()), 4, image.Data(),
+                        static_cast<int>(image.Stride() * 4)) != 0;
+}
@@ -0,0 +1,159 @@
+#include "control_socket.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define ANARI_PROJECT_HAS_UNIX_SOCKETS 1
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Longest accepted command line
+constexpr std::size_t kMaxLineLength = 1024;
+
+ControlSocket::~ControlSocket() {
+  {
+    std::lock_guard lock{mutex_};
+    stop_ = true;
+  }
+  reply_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+#ifdef ANARI_PROJECT_HAS_UNIX_SOCKETS
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(path_.c_str());
+  }
+#endif
+}
+
+bool ControlSocket::Start(const char *path) {
+#ifdef ANARI_PROJECT_HAS_UNIX_SOCKETS
+  sockaddr_un address{};
+  if (std::strlen(path) >= sizeof(address.sun_path)) {
+    std::printf("Error: Control socket path is too long: %s\n", path);
+    return false;
+  }
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    std::printf("Error: Cannot create the control socket: %s\n",
+                std::strerror(errno));
+    return false;
+  }
+  // A previous instance that crashed leaves its socket file behind. Only
+  // a socket is removed, never a file the path was mistyped into.
+  struct stat existing{};
+  if (lstat(path, &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      std::printf("Error: Control socket path %s exists and is not a "
+                  "socket\n",
+                  path);
+      close(listen_fd_);
+      listen_fd_ = -1;
+      return false;
+    }
+    unlink(path);
+  }
+  if (bind(listen_fd_, reinterpret_cast<const sockaddr *>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd_, 4) != 0) {
+    std::printf("Error: Cannot listen on control socket %s: %s\n", path,
+                std::strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+  path_ = path;
+  thread_ = std::thread{[this] { Serve(); }};
+  std::printf("Info: Listening for commands on %s\n", path);
+  return true;
+#else
+  (void)path;
+  std::printf("WARNING: The control socket is not supported on this "
+              "platform\n");
+  return false;
+#endif
+}
+
+void ControlSocket::Serve() {
+#ifdef ANARI_PROJECT_HAS_UNIX_SOCKETS
+  while (!stop_) {
+    // Wake up regularly to notice stop_
+    pollfd listen_poll{listen_fd_, POLLIN, 0};
+    if (poll(&listen_poll, 1, 200) <= 0) {
+      continue;
+    }
+    const int client = accept(listen_fd_, nullptr, nullptr);
+    if (client < 0) {
+      continue;
+    }
+    HandleClient(client);
+    close(client);
+  }
+#endif
+}
+
+void ControlSocket::HandleClient(int client) {
+#ifdef ANARI_PROJECT_HAS_UNIX_SOCKETS
+  std::string buffer{};
+  char chunk[256];
+  while (!stop_) {
+    pollfd client_poll{client, POLLIN, 0};
+    if (poll(&client_poll, 1, 200) <= 0) {
+      continue;
+    }
+    const ssize_t received = recv(client, chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+      return;
+    }
+    buffer.append(chunk, static_cast<std::size_t>(received));
+
+    std::size_t end{};
+    while ((end = buffer.find('\n')) != std::string::npos) {
+      std::string line = buffer.substr(0, end);
+      buffer.erase(0, end + 1);
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (line.empty()) {
+        continue;
+      }
+      const std::string reply = Execute(std::move(line)) + "\n";
+      send(client, reply.data(), reply.size(), MSG_NOSIGNAL);
+    }
+    if (buffer.size() > kMaxLineLength) {
+      const char *reply = "error line too long\n";
+      send(client, reply, std::strlen(reply), MSG_NOSIGNAL);
+      return;
+    }
+  }
+#else
+  (void)client;
+#endif
+}
+
+std::string ControlSocket::Execute(std::string line) {
+  std::unique_lock lock{mutex_};
+  command_ = std::move(line);
+  pending_.store(true, std::memory_order_release);
+  reply_cv_.wait(lock, [this] {
+    return stop_ || !pending_.load(std::memory_order_acquire);
+  });
+  if (pending_.load(std::memory_order_acquire)) {
+    return "error shutting down";
+  }
+  return std::move(reply_);
+}
@@ -0,0 +1,77 @@
+#include "cpu_features.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+const char *SimdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::kScalar:
+    return "scalar";
+  case SimdLevel::kSse42:
+    return "sse4.2";
+  case SimdLevel::kAvx2:
+    return "avx2";
+  case SimdLevel::kAvx512:
+    return "avx512";
+  case SimdLevel::kNeon:
+    return "neon";
+  }
+  return "unknown";
+}
+
+bool ParseSimdLevel(const char *name, SimdLevel &level) {
+  constexpr SimdLevel kLevels[] = {SimdLevel::kScalar, SimdLevel::kSse42,
+                                   SimdLevel::kAvx2, SimdLevel::kAvx512,
+                                   SimdLevel::kNeon};
+  for (const auto candidate : kLevels) {
+    if (std::strcmp(name, SimdLevelName(candidate)) == 0) {
+      level = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+SimdLevel DetectSimdLevel() {
+#if defined(__x86_64__) || defined(__i386__)
+  // libgcc/compiler-rt also check that the OS saves the wider registers
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    return SimdLevel::kAvx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SimdLevel::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse4.2")) {
+    return SimdLevel::kSse42;
+  }
+  return SimdLevel::kScalar;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int regs[4]{};
+  __cpuid(regs, 1);
+  const bool sse42 = (regs[2] & (1 << 20)) != 0;
+  const bool fma = (regs[2] & (1 << 12)) != 0;
+  const bool osxsave = (regs[2] & (1 << 27)) != 0;
+  const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+  __cpuidex(regs, 7, 0);
+  const bool avx2 = (regs[1] & (1 << 5)) != 0;
+  const bool avx512 =
+      (regs[1] & (1 << 16)) != 0 && (regs[1] & (1 << 30)) != 0;
+  if (avx512 && (xcr0 & 0xE6) == 0xE6) {
+    return SimdLevel::kAvx512;
+  }
+  if (avx2 && fma && (xcr0 & 0x6) == 0x6) {
+    return SimdLevel::kAvx2;
+  }
+  return sse42 ? SimdLevel::kSse42 : SimdLevel::kScalar;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  // Advanced SIMD is mandatory on AArch64
+  return SimdLevel::kNeon;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
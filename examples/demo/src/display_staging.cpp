@@ -0,0 +1,95 @@
+#include "display_staging.h"
+
+#include <cstdio>
+#include <limits>
+#include <span>
+
+#include "kernels.h"
+#include "row_workers.h"
+
+// Below this many pixels splitting rows across threads costs more than it
+// saves.
+constexpr std::size_t kParallelPixels = 1U << 20;
+
+bool DisplayStaging::Convert(const anari::MappedFrameData<void> &mapped,
+                             bool flip_rows) {
+  if (mapped.data == nullptr || mapped.width == 0 || mapped.height == 0) {
+    return false;
+  }
+  Resize(mapped.width, mapped.height);
+
+  const Kernels &kernels = GetKernels();
+  switch (mapped.pixelType) {
+  case ANARI_UFIXED8_RGBA_SRGB:
+  case ANARI_UFIXED8_VEC4: {
+    const FrameView<const PixelRgba8> src{
+        static_cast<const PixelRgba8 *>(mapped.data), width_, height_};
+    ConvertRows(src, flip_rows,
+                [&](const PixelRgba8 *row, std::uint32_t *dst, std::size_t n) {
+                  kernels.rgba8_to_rgba8(
+                      reinterpret_cast<const std::uint32_t *>(row), dst, n);
+                });
+    return true;
+  }
+  case ANARI_FLOAT32_VEC4: {
+    const FrameView<const PixelRgba32F> src{
+        static_cast<const PixelRgba32F *>(mapped.data), width_, height_};
+    ConvertRows(src, flip_rows,
+                [&](const PixelRgba32F *row, std::uint32_t *dst, std::size_t n) {
+                  kernels.rgba32f_to_rgba8(reinterpret_cast<const float *>(row),
+                                           dst, n);
+                });
+    return true;
+  }
+  case ANARI_FLOAT32: {
+    const FrameView<const PixelDepth> src{
+        static_cast<const PixelDepth *>(mapped.data), width_, height_};
+    float depth_min{std::numeric_limits<float>::infinity()};
+    float depth_max{-std::numeric_limits<float>::infinity()};
+    kernels.finite_min_max_f32(src.Data(), pixels_.size(), &depth_min,
+                               &depth_max);
+    ConvertRows(src, flip_rows,
+                [&](const PixelDepth *row, std::uint32_t *dst, std::size_t n) {
+                  kernels.depth_to_rgba8(row, dst, n, depth_min, depth_max);
+                });
+    return true;
+  }
+  case ANARI_UINT32: {
+    const FrameView<const PixelId> src{
+        static_cast<const PixelId *>(mapped.data), width_, height_};
+    ConvertRows(src, flip_rows,
+                [&](const PixelId *row, std::uint32_t *dst, std::size_t n) {
+                  kernels.id_to_rgba8(
+                      reinterpret_cast<const std::uint32_t *>(row), dst, n);
+                });
+    return true;
+  }
+  default: {
+    std::printf("Error: Cannot display pixel type %d\n", mapped.pixelType);
+    return false;
+  }
+  }
+}
+
+void DisplayStaging::Resize(std::uint32_t width, std::uint32_t height) {
+  width_ = width;
+  height_ = height;
+  pixels_.resize(static_cast<std::size_t>(width) * height);
+}
+
+template <typename T, typename RowFn>
+void DisplayStaging::ConvertRows(FrameView<const T> src, bool flip_rows,
+                                 RowFn &&convert) {
+  const FrameView<std::uint32_t> dst = View();
+  auto convert_range = [&](std::uint32_t begin, std::uint32_t end) {
+    src.ForEachRow(begin, end, [&](std::uint32_t y, std::span<const T> row) {
+      const std::uint32_t dst_y = flip_rows ? dst.Height() - 1 - y : y;
+      convert(row.data(), dst.Row(dst_y).data(), row.size());
+    });
+  };
+  if (workers_ != nullptr && pixels_.size() >= kParallelPixels) {
+    workers_->ForRows(src.Height(), convert_range);
+  } else {
+    convert_range(0, src.Height());
+  }
+}
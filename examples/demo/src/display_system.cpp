@@ -0,0 +1,49 @@
+#include "display_system.h"
+
+#include <cstdio>
+
+#include "alloc_tracker.h"
+#include "render_system.h"
+
+DisplaySystem::DisplaySystem() {
+  InstallGlfwAllocator();
+  glfwInit();
+}
+
+void DisplaySystem::CreateWindow() {
+  std::printf("Info: Creating a window\n");
+  auto window = glfwCreateWindow(kWidth, kHeight, "glfw3-window", NULL, NULL);
+  if (window == nullptr) {
+    const char *error_str{};
+    glfwGetError(&error_str);
+    std::printf("Error: Cannot create a window, err=%s\n", error_str);
+  }
+
+  glfwMakeContextCurrent(window);
+
+  window_wrapper_ = std::make_unique<WindowWrapper>(window);
+  glfwSetWindowUserPointer(window, window_wrapper_.get());
+  auto key_callback = [](GLFWwindow *w, int key, int scancode, int action,
+                         int mods) {
+    static_cast<WindowWrapper *>(glfwGetWindowUserPointer(w))
+        ->HandleKey(key, scancode, action, mods);
+  };
+  glfwSetKeyCallback(window, key_callback);
+  // Only recorded here, the camera moves once per frame
+  auto mouse_button_callback = [](GLFWwindow *w, int button, int action,
+                                  int mods) {
+    static_cast<WindowWrapper *>(glfwGetWindowUserPointer(w))
+        ->HandleMouseButton(button, action, mods);
+  };
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
+  auto cursor_callback = [](GLFWwindow *w, double x, double y) {
+    static_cast<WindowWrapper *>(glfwGetWindowUserPointer(w))
+        ->HandleCursor(x, y);
+  };
+  glfwSetCursorPosCallback(window, cursor_callback);
+  auto scroll_callback = [](GLFWwindow *w, double x_offset, double y_offset) {
+    static_cast<WindowWrapper *>(glfwGetWindowUserPointer(w))
+        ->HandleScroll(x_offset, y_offset);
+  };
+  glfwSetScrollCallback(window, scroll_callback);
+}
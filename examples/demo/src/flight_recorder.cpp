@@ -0,0 +1,243 @@
+#include "flight_recorder.h"
+
+#include <csignal>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<const FlightRecorder *> installed_recorder{};
+static std::atomic<bool> dump_requested{};
+
+#ifdef _WIN32
+static int openForAppend(const char *path) {
+  return _open(path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY,
+               _S_IREAD | _S_IWRITE);
+}
+static void writeAll(int fd, const char *data, std::size_t size) {
+  _write(fd, data, static_cast<unsigned>(size));
+}
+static void closeFile(int fd) { _close(fd); }
+#else
+static int openForAppend(const char *path) {
+  return open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+static void writeAll(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t written = write(fd, data, size);
+    if (written <= 0) {
+      return;
+    }
+    data += written;
+    size -= static_cast<std::size_t>(written);
+  }
+}
+static void closeFile(int fd) { close(fd); }
+#endif
+
+// Formats text into a fixed buffer and flushes it to a file descriptor when
+// full. printf-family functions are not async-signal-safe, so numbers are
+// formatted by hand.
+class SignalSafeWriter {
+public:
+  explicit SignalSafeWriter(int fd) : fd_{fd} {}
+
+  ~SignalSafeWriter() { Flush(); }
+
+  SignalSafeWriter(const SignalSafeWriter&) = delete;
+  SignalSafeWriter(SignalSafeWriter&&) = delete;
+  SignalSafeWriter& operator=(const SignalSafeWriter&) = delete;
+  SignalSafeWriter& operator=(SignalSafeWriter&&) = delete;
+
+  SignalSafeWriter &Text(const char *text) {
+    for (; *text != '\0'; ++text) {
+      Char(*text);
+    }
+    return *this;
+  }
+
+  SignalSafeWriter &Unsigned(std::uint64_t value) {
+    char digits[20];
+    int count{0};
+    do {
+      digits[count++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+    while (count > 0) {
+      Char(digits[--count]);
+    }
+    return *this;
+  }
+
+  // Fixed-point with three decimals, enough for milliseconds and scene units.
+  SignalSafeWriter &Float(float value) {
+    if (value != value) {
+      return Text("nan");
+    }
+    if (value < 0.0F) {
+      Char('-');
+      value = -value;
+    }
+    if (value >= 1.0e15F) {
+      return Text("inf");
+    }
+    const auto thousandths =
+        static_cast<std::uint64_t>(static_cast<double>(value) * 1000.0 + 0.5);
+    Unsigned(thousandths / 1000);
+    Char('.');
+    const auto fraction = thousandths % 1000;
+    Char(static_cast<char>('0' + fraction / 100));
+    Char(static_cast<char>('0' + fraction / 10 % 10));
+    Char(static_cast<char>('0' + fraction % 10));
+    return *this;
+  }
+
+  void Flush() {
+    writeAll(fd_, buffer_, size_);
+    size_ = 0;
+  }
+
+private:
+  void Char(char c) {
+    if (size_ == sizeof(buffer_)) {
+      Flush();
+    }
+    buffer_[size_++] = c;
+  }
+
+  int fd_;
+  char buffer_[4096];
+  std::size_t size_{};
+};
+
+FlightRecorder::FlightRecorder(const char *path) : path_{path} {}
+
+FlightRecorder::~FlightRecorder() {
+  const FlightRecorder *self = this;
+  installed_recorder.compare_exchange_strong(self, nullptr);
+}
+
+bool FlightRecorder::Dump(const char *reason) const {
+  const int fd = openForAppend(path_);
+  if (fd < 0) {
+    return false;
+  }
+  const std::uint64_t count = count_.load(std::memory_order_acquire);
+  const std::uint64_t first = count > kCapacity ? count - kCapacity : 0;
+  {
+    SignalSafeWriter out{fd};
+    out.Text("# flight recorder dump, reason: ")
+        .Text(reason)
+        .Text(", frames: ")
+        .Unsigned(count - first)
+        .Text("\nframe,mode,total_ms");
+    for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+      out.Text(",").Text(FrameStageName(static_cast<FrameStage>(stage))).Text(
+          "_ms");
+    }
+    out.Text(",width,height,commits,releases,allocs,alloc_bytes,warnings,"
+             "errors,camera_x,camera_y,camera_z,dir_x,dir_y,dir_z\n");
+    for (std::uint64_t i = first; i < count; ++i) {
+      const FlightRecord &record = records_[i % kCapacity];
+      const FrameTelemetry &t = record.telemetry;
+      out.Unsigned(t.frame).Text(",").Text(record.mode).Text(",").Float(
+          t.total_ms);
+      for (const float ms : t.stage_ms) {
+        out.Text(",").Float(ms);
+      }
+      out.Text(",").Unsigned(t.width).Text(",").Unsigned(t.height);
+      out.Text(",").Unsigned(t.commits).Text(",").Unsigned(t.releases);
+      out.Text(",").Unsigned(t.allocations).Text(",").Unsigned(
+          t.allocated_bytes);
+      out.Text(",").Unsigned(t.warnings).Text(",").Unsigned(t.errors);
+      for (const float v : record.camera_position) {
+        out.Text(",").Float(v);
+      }
+      for (const float v : record.camera_direction) {
+        out.Text(",").Float(v);
+      }
+      out.Text("\n");
+    }
+  }
+  closeFile(fd);
+  return true;
+}
+
+static const char *signalName(int signal) {
+  switch (signal) {
+  case SIGSEGV:
+    return "SIGSEGV";
+  case SIGFPE:
+    return "SIGFPE";
+  case SIGILL:
+    return "SIGILL";
+  case SIGABRT:
+    return "SIGABRT";
+#ifdef SIGBUS
+  case SIGBUS:
+    return "SIGBUS";
+#endif
+#ifdef SIGUSR1
+  case SIGUSR1:
+    return "SIGUSR1";
+#endif
+  }
+  return "signal";
+}
+
+static void onCrashSignal(int signal) {
+  DumpFlightRecorder(signalName(signal));
+  // The handler was reset to the default one, terminate as without it
+  std::signal(signal, SIG_DFL);
+  std::raise(signal);
+}
+
+#ifdef SIGUSR1
+static void onDumpSignal(int) {
+  dump_requested.store(true, std::memory_order_relaxed);
+}
+#endif
+
+void FlightRecorder::Install() {
+  installed_recorder.store(this);
+#if defined(__unix__) || defined(__APPLE__)
+  // Crashes from stack overflows need a stack of their own
+  static char alternate_stack[64 * 1024];
+  stack_t stack{};
+  stack.ss_sp = alternate_stack;
+  stack.ss_size = sizeof(alternate_stack);
+  sigaltstack(&stack, nullptr);
+
+  struct sigaction crash_action {};
+  crash_action.sa_handler = onCrashSignal;
+  crash_action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+  sigemptyset(&crash_action.sa_mask);
+  for (const int signal : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+    sigaction(signal, &crash_action, nullptr);
+  }
+
+  struct sigaction dump_action {};
+  dump_action.sa_handler = onDumpSignal;
+  dump_action.sa_flags = SA_RESTART;
+  sigemptyset(&dump_action.sa_mask);
+  sigaction(SIGUSR1, &dump_action, nullptr);
+#else
+  for (const int signal : {SIGSEGV, SIGFPE, SIGILL, SIGABRT}) {
+    std::signal(signal, onCrashSignal);
+  }
+#endif
+}
+
+bool FlightRecorder::ConsumeDumpRequest() {
+  return dump_requested.exchange(false, std::memory_order_relaxed);
+}
+
+void DumpFlightRecorder(const char *reason) {
+  if (const FlightRecorder *recorder = installed_recorder.load()) {
+    recorder->Dump(reason);
+  }
+}
@@ -0,0 +1,170 @@
+#include "foveation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "kernels.h"
+#include "row_workers.h"
+
+constexpr std::size_t kParallelPixels = 1U << 20;
+
+FocusRegion MakeFocusRegion(uvec2 frame_size, vec2 center, float fraction) {
+  FocusRegion region{};
+  region.width = std::clamp(
+      static_cast<std::uint32_t>(static_cast<float>(frame_size[0]) * fraction),
+      1U, std::max(frame_size[0], 1U));
+  region.height = std::clamp(
+      static_cast<std::uint32_t>(static_cast<float>(frame_size[1]) * fraction),
+      1U, std::max(frame_size[1], 1U));
+  const float x = center[0] - static_cast<float>(region.width) * 0.5F;
+  const float y = center[1] - static_cast<float>(region.height) * 0.5F;
+  region.x = static_cast<std::uint32_t>(std::clamp(
+      x, 0.0F, static_cast<float>(frame_size[0] - region.width)));
+  region.y = static_cast<std::uint32_t>(std::clamp(
+      y, 0.0F, static_cast<float>(frame_size[1] - region.height)));
+  return region;
+}
+
+box2 FocusImageRegion(const FocusRegion &region, uvec2 display_size) {
+  const float width = static_cast<float>(std::max(display_size[0], 1U));
+  const float height = static_cast<float>(std::max(display_size[1], 1U));
+  return {vec2{static_cast<float>(region.x) / width,
+               static_cast<float>(region.y) / height},
+          vec2{static_cast<float>(region.x + region.width) / width,
+               static_cast<float>(region.y + region.height) / height}};
+}
+
+// Source sample positions of a bilinear upscale from src to dst samples,
+// weights in [0, 256] for the second sample.
+static void bilinearTaps(std::uint32_t dst, std::uint32_t src, std::uint32_t i,
+                         std::uint32_t &s0, std::uint32_t &s1,
+                         std::uint32_t &w) {
+  const float pos = std::max(
+      (static_cast<float>(i) + 0.5F) * static_cast<float>(src) /
+              static_cast<float>(dst) -
+          0.5F,
+      0.0F);
+  s0 = std::min(static_cast<std::uint32_t>(pos), src - 1);
+  s1 = std::min(s0 + 1, src - 1);
+  w = static_cast<std::uint32_t>((pos - static_cast<float>(s0)) * 256.0F);
+}
+
+// Weight of the focus image at index i of size samples, ramping up over
+// feather samples at both ends.
+static std::uint32_t featherWeight(std::uint32_t i, std::uint32_t size,
+                                   std::uint32_t feather) {
+  const std::uint32_t edge = std::min(i, size - 1 - i);
+  if (feather == 0 || edge >= feather) {
+    return 256U;
+  }
+  return (edge * 256U + 128U) / feather;
+}
+
+void FoveatedCompositor::Compose(FrameView<const std::uint32_t> low,
+                                 FrameView<const std::uint32_t> focus,
+                                 const FocusRegion &region,
+                                 std::uint32_t width, std::uint32_t height) {
+  if (low.Empty() || width == 0 || height == 0) {
+    return;
+  }
+  Resize(width, height, low.Width(), low.Height());
+  const Kernels &kernels = GetKernels();
+
+  const FrameView<std::uint32_t> dst = Color();
+  auto upscale_rows = [&](std::uint32_t begin, std::uint32_t end) {
+    for (std::uint32_t y = begin; y < end; ++y) {
+      std::uint32_t y0{};
+      std::uint32_t y1{};
+      std::uint32_t wy{};
+      bilinearTaps(height_, low_height_, y, y0, y1, wy);
+      kernels.bilinear_row_rgba8(low.Row(y0).data(), low.Row(y1).data(), wy,
+                                 x0_.data(), x1_.data(), wx_.data(),
+                                 dst.Row(y).data(), width_);
+    }
+  };
+  if (workers_ != nullptr && color_.size() >= kParallelPixels) {
+    workers_->ForRows(height_, upscale_rows);
+  } else {
+    upscale_rows(0, height_);
+  }
+
+  const FrameView<std::uint32_t> focus_dst =
+      dst.Sub(region.x, region.y, region.width, region.height);
+  if (focus.Empty() || focus.Width() != focus_dst.Width() ||
+      focus.Height() != focus_dst.Height()) {
+    return;
+  }
+  UpdateFeather(region);
+  for (std::uint32_t y = 0; y < focus.Height(); ++y) {
+    kernels.blend_rgba8(focus.Row(y).data(), feather_columns_.data(),
+                        feather_rows_[y], focus_dst.Row(y).data(),
+                        focus.Width());
+  }
+}
+
+void FoveatedCompositor::ComposeDepth(FrameView<const float> low,
+                                      FrameView<const float> focus,
+                                      const FocusRegion &region) {
+  if (low.Width() != low_width_ || low.Height() != low_height_) {
+    return;
+  }
+  const FrameView<float> dst{depth_.data(), width_, height_};
+  for (std::uint32_t y = 0; y < height_; ++y) {
+    std::uint32_t y0{};
+    std::uint32_t y1{};
+    std::uint32_t wy{};
+    bilinearTaps(height_, low_height_, y, y0, y1, wy);
+    const auto src_row = low.Row(wy >= 128U ? y1 : y0);
+    const auto dst_row = dst.Row(y);
+    for (std::uint32_t x = 0; x < width_; ++x) {
+      dst_row[x] = src_row[wx_[x] >= 128U ? x1_[x] : x0_[x]];
+    }
+  }
+
+  const FrameView<float> focus_dst =
+      dst.Sub(region.x, region.y, region.width, region.height);
+  if (focus.Width() != focus_dst.Width() ||
+      focus.Height() != focus_dst.Height()) {
+    return;
+  }
+  for (std::uint32_t y = 0; y < focus.Height(); ++y) {
+    std::copy_n(focus.Row(y).data(), focus.Width(), focus_dst.Row(y).data());
+  }
+}
+
+void FoveatedCompositor::Resize(std::uint32_t width, std::uint32_t height,
+                                std::uint32_t low_width,
+                                std::uint32_t low_height) {
+  if (width == width_ && height == height_ && low_width == low_width_ &&
+      low_height == low_height_) {
+    return;
+  }
+  width_ = width;
+  height_ = height;
+  low_width_ = low_width;
+  low_height_ = low_height;
+  color_.resize(static_cast<std::size_t>(width) * height);
+  depth_.resize(color_.size());
+  x0_.resize(width);
+  x1_.resize(width);
+  wx_.resize(width);
+  for (std::uint32_t x = 0; x < width; ++x) {
+    bilinearTaps(width, low_width, x, x0_[x], x1_[x], wx_[x]);
+  }
+}
+
+void FoveatedCompositor::UpdateFeather(const FocusRegion &region) {
+  if (region.width == feather_region_.width &&
+      region.height == feather_region_.height) {
+    return;
+  }
+  feather_region_ = region;
+  feather_columns_.resize(region.width);
+  feather_rows_.resize(region.height);
+  for (std::uint32_t x = 0; x < region.width; ++x) {
+    feather_columns_[x] = featherWeight(x, region.width, feather_);
+  }
+  for (std::uint32_t y = 0; y < region.height; ++y) {
+    feather_rows_[y] = featherWeight(y, region.height, feather_);
+  }
+}
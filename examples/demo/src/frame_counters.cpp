@@ -0,0 +1,92 @@
+#include "frame_counters.h"
+
+#include <cstddef>
+#include <cstdio>
+
+// Allocations inside ANARI calls and on threads we do not own are outside
+// of our control and only reported. The app code around the ANARI calls is
+// checked like any other.
+static bool isLoopSubsystem(AllocSubsystem subsystem) {
+  return subsystem != AllocSubsystem::kOther &&
+         subsystem != AllocSubsystem::kAnari;
+}
+
+static void printCounters(const AllocSnapshot &snapshot) {
+  for (std::size_t i = 0; i < kAllocSubsystemCount; ++i) {
+    const auto &counters = snapshot.subsystems[i];
+    if (counters.allocations > 0 || counters.deallocations > 0) {
+      std::printf(" %s=%llu/%lluB/-%llu",
+                  AllocSubsystemName(static_cast<AllocSubsystem>(i)),
+                  static_cast<unsigned long long>(counters.allocations),
+                  static_cast<unsigned long long>(counters.bytes),
+                  static_cast<unsigned long long>(counters.deallocations));
+    }
+  }
+  std::printf("\n");
+}
+
+void FrameCounters::Begin(const RenderSystem &rs) {
+  allocs_ = TakeAllocSnapshot();
+  status_ = TakeStatusCounts();
+  commits_ = rs.Commits();
+  releases_ = rs.Releases();
+}
+
+void FrameCounters::End(const RenderSystem &rs,
+                        FrameTelemetry &telemetry) const {
+  const AllocSnapshot allocs = TakeAllocSnapshot() - allocs_;
+  const AllocCounters foreign = allocs[AllocSubsystem::kOther];
+  const AllocCounters total = allocs.Total();
+  telemetry.allocations =
+      static_cast<std::uint32_t>(total.allocations - foreign.allocations);
+  telemetry.allocated_bytes = total.bytes - foreign.bytes;
+
+  const StatusCounts status = TakeStatusCounts();
+  telemetry.warnings = static_cast<std::uint32_t>(
+      status.warnings + status.performance_warnings - status_.warnings -
+      status_.performance_warnings);
+  telemetry.errors = static_cast<std::uint32_t>(status.errors - status_.errors);
+  telemetry.commits = static_cast<std::uint32_t>(rs.Commits() - commits_);
+  telemetry.releases = static_cast<std::uint32_t>(rs.Releases() - releases_);
+}
+
+void FrameAllocMonitor::EndFrame() {
+  const AllocSnapshot frame = TakeAllocSnapshot() - frame_begin_;
+  if (warmup_ > 0) {
+    --warmup_;
+    return;
+  }
+  ++frames_;
+  std::uint64_t loop_allocations{};
+  for (std::size_t i = 0; i < kAllocSubsystemCount; ++i) {
+    totals_.subsystems[i] += frame.subsystems[i];
+    if (isLoopSubsystem(static_cast<AllocSubsystem>(i))) {
+      loop_allocations += frame.subsystems[i].allocations;
+    }
+  }
+  if (loop_allocations > 0) {
+    if (allocating_frames_ < kMaxLoggedFrames) {
+      std::printf("WARNING: Steady-state frame %d allocated:", frames_);
+      printCounters(frame);
+    }
+    ++allocating_frames_;
+  }
+}
+
+void FrameAllocMonitor::Report() const {
+  std::printf("Info: Allocations over %d steady-state frames, per frame:",
+              frames_);
+  if (frames_ == 0) {
+    std::printf(" none measured\n");
+    return;
+  }
+  AllocSnapshot average{};
+  for (std::size_t i = 0; i < kAllocSubsystemCount; ++i) {
+    average.subsystems[i] = {totals_.subsystems[i].allocations / frames_,
+                             totals_.subsystems[i].deallocations / frames_,
+                             totals_.subsystems[i].bytes / frames_};
+  }
+  printCounters(average);
+  std::printf("Info: %d of %d steady-state frames allocated in the loop\n",
+              allocating_frames_, frames_);
+}
@@ -0,0 +1,115 @@
+#include "frame_pipeline.h"
+
+#include <cstring>
+
+#include "alloc_tracker.h"
+
+const char *RenderModeName(RenderMode mode) {
+  switch (mode) {
+  case RenderMode::kFull:
+    return "full";
+  case RenderMode::kFoveated:
+    return "foveated";
+  case RenderMode::kInterleaved:
+    return "interleaved";
+  }
+  return "unknown";
+}
+
+bool ParseRenderMode(const char *name, RenderMode &mode) {
+  for (const auto candidate :
+       {RenderMode::kFull, RenderMode::kFoveated, RenderMode::kInterleaved}) {
+    if (std::strcmp(name, RenderModeName(candidate)) == 0) {
+      mode = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void FramePipeline::Prepare(RenderMode mode, uvec2 display_size,
+                            vec2 focus_center) {
+  if (mode != mode_) {
+    rs_.SetFrameEnabled(FrameSlot::kFocus, mode == RenderMode::kFoveated);
+    rs_.UpdateImageRegion(kFullImageRegion);
+    interleaved_.Reset();
+    mode_ = mode;
+  }
+  display_size_ = display_size;
+  rs_.UpdateCameraAspect(static_cast<float>(display_size[0]) /
+                         static_cast<float>(std::max(display_size[1], 1U)));
+
+  switch (mode_) {
+  case RenderMode::kFull: {
+    rs_.UpdateFrameSize(ScaledSize(display_size, render_scale_));
+    break;
+  }
+  case RenderMode::kFoveated: {
+    rs_.UpdateFrameSize(
+        ScaledSize(display_size, kFoveatedScale * render_scale_));
+    focus_region_ =
+        MakeFocusRegion(display_size, focus_center, kFocusFraction);
+    rs_.UpdateFrameSize({focus_region_.width, focus_region_.height},
+                        FrameSlot::kFocus);
+    rs_.UpdateImageRegion(FocusImageRegion(focus_region_, display_size),
+                          FrameSlot::kFocus);
+    break;
+  }
+  case RenderMode::kInterleaved: {
+    parity_ = 1 - parity_;
+    rs_.UpdateFrameSize(
+        {InterleavedWidth(display_size[0], parity_), display_size[1]});
+    rs_.UpdateImageRegion(InterleavedImageRegion(display_size[0], parity_));
+    break;
+  }
+  }
+}
+
+FrameView<std::uint32_t> FramePipeline::Assemble(const char *channel,
+                                                  OverlayRenderer *overlay) {
+  AllocScope scope{AllocSubsystem::kDisplay};
+  const bool converted = staging_.Convert(rs_.MapChannel(channel), false);
+  rs_.UnmapChannel(channel);
+  if (!converted) {
+    return {};
+  }
+
+  FrameView<std::uint32_t> image = staging_.View();
+  if (mode_ == RenderMode::kFoveated) {
+    const bool focus_converted = focus_staging_.Convert(
+        rs_.MapChannel(channel, FrameSlot::kFocus), false);
+    rs_.UnmapChannel(channel, FrameSlot::kFocus);
+    foveated_.Compose(staging_.View(),
+                      focus_converted ? focus_staging_.View()
+                                      : FrameView<std::uint32_t>{},
+                      focus_region_, display_size_[0], display_size_[1]);
+    image = foveated_.Color();
+  } else if (mode_ == RenderMode::kInterleaved) {
+    interleaved_.Reconstruct(staging_.View(), parity_, display_size_[0]);
+    image = interleaved_.Color();
+  }
+
+  // Composite host overlays, depth tested against the ANARI image
+  if (overlay != nullptr && !overlay->Empty()) {
+    AllocScope overlay_scope{AllocSubsystem::kOverlay};
+    overlay->Update(image.Width(), image.Height(), rs_.GetCameraState());
+    const auto depth = rs_.MapChannel("channel.depth");
+    const auto depth_view = MakeFrameViewAs<PixelDepth>(depth);
+    if (mode_ == RenderMode::kFoveated) {
+      const auto focus_depth =
+          rs_.MapChannel("channel.depth", FrameSlot::kFocus);
+      foveated_.ComposeDepth(depth_view,
+                             MakeFrameViewAs<PixelDepth>(focus_depth),
+                             focus_region_);
+      rs_.UnmapChannel("channel.depth", FrameSlot::kFocus);
+      overlay->Composite(image, foveated_.Depth());
+    } else if (mode_ == RenderMode::kInterleaved) {
+      interleaved_.ReconstructDepth(depth_view, parity_);
+      overlay->Composite(image, interleaved_.Depth());
+    } else {
+      overlay->Composite(image, depth_view);
+    }
+    rs_.UnmapChannel("channel.depth");
+  }
+  return image;
+}
@@ -0,0 +1,65 @@
+#include "frame_telemetry.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+static std::atomic<std::uint64_t> warning_count{};
+static std::atomic<std::uint64_t> performance_warning_count{};
+static std::atomic<std::uint64_t> error_count{};
+
+// Latest warning or error, copied into a fixed buffer so recording a message
+// never allocates.
+static std::mutex latest_message_mutex{};
+static char latest_message[256]{};
+
+const char *FrameStageName(FrameStage stage) {
+  switch (stage) {
+  case FrameStage::kPrepare:
+    return "prepare";
+  case FrameStage::kCamera:
+    return "camera";
+  case FrameStage::kRender:
+    return "render";
+  case FrameStage::kAssemble:
+    return "assemble";
+  case FrameStage::kPresent:
+    return "present";
+  case FrameStage::kEvents:
+    return "events";
+  case FrameStage::kCount:
+    break;
+  }
+  return "unknown";
+}
+
+void CountStatusMessage(ANARIStatusSeverity severity, const char *message) {
+  if (severity == ANARI_SEVERITY_FATAL_ERROR ||
+      severity == ANARI_SEVERITY_ERROR) {
+    error_count.fetch_add(1, std::memory_order_relaxed);
+  } else if (severity == ANARI_SEVERITY_WARNING) {
+    warning_count.fetch_add(1, std::memory_order_relaxed);
+  } else if (severity == ANARI_SEVERITY_PERFORMANCE_WARNING) {
+    performance_warning_count.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    return;
+  }
+  std::lock_guard lock{latest_message_mutex};
+  std::strncpy(latest_message, message != nullptr ? message : "",
+               sizeof(latest_message) - 1);
+}
+
+StatusCounts TakeStatusCounts() {
+  return {warning_count.load(std::memory_order_relaxed),
+          performance_warning_count.load(std::memory_order_relaxed),
+          error_count.load(std::memory_order_relaxed)};
+}
+
+void CopyLatestStatusMessage(char *buffer, std::size_t size) {
+  if (size == 0) {
+    return;
+  }
+  std::lock_guard lock{latest_message_mutex};
+  std::strncpy(buffer, latest_message, size - 1);
+  buffer[size - 1] = '\0';
+}
@@ -0,0 +1,147 @@
+#include "golden_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <stb_image.h>
+
+ImageComparison CompareImages(FrameView<const std::uint32_t> image,
+                              FrameView<const std::uint32_t> golden,
+                              int bad_pixel_threshold) {
+  ImageComparison result{};
+  result.size_matches = !image.Empty() && image.Width() == golden.Width() &&
+                        image.Height() == golden.Height();
+  if (!result.size_matches) {
+    return result;
+  }
+  std::uint64_t abs_diff{};
+  std::uint64_t sq_diff{};
+  std::uint64_t bad_pixels{};
+  for (std::uint32_t y = 0; y < image.Height(); ++y) {
+    const auto a = image.Row(y);
+    const auto b = golden.Row(y);
+    for (std::uint32_t x = 0; x < image.Width(); ++x) {
+      int worst{};
+      for (int shift = 0; shift < 24; shift += 8) {
+        const int diff = std::abs(static_cast<int>((a[x] >> shift) & 0xFFU) -
+                                  static_cast<int>((b[x] >> shift) & 0xFFU));
+        abs_diff += static_cast<std::uint64_t>(diff);
+        sq_diff += static_cast<std::uint64_t>(diff * diff);
+        worst = std::max(worst, diff);
+      }
+      bad_pixels += worst > bad_pixel_threshold ? 1 : 0;
+    }
+  }
+  const double pixels =
+      static_cast<double>(image.Width()) * static_cast<double>(image.Height());
+  result.mae = static_cast<double>(abs_diff) / (pixels * 3.0);
+  const double mse = static_cast<double>(sq_diff) / (pixels * 3.0);
+  result.psnr_db =
+      mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+  result.bad_pixel_fraction = static_cast<double>(bad_pixels) / pixels;
+  return result;
+}
+
+bool WithinTolerance(const ImageComparison &comparison,
+                     const ImageTolerance &tolerance) {
+  return comparison.size_matches && comparison.mae <= tolerance.max_mae &&
+         comparison.psnr_db >= tolerance.min_psnr_db &&
+         comparison.bad_pixel_fraction <= tolerance.max_bad_pixel_fraction;
+}
+
+bool GoldenImage::Load(const char *path) {
+  int width{};
+  int height{};
+  int components{};
+  stbi_uc *data = stbi_load(path, &width, &height, &components, 4);
+  if (data == nullptr) {
+    return false;
+  }
+  width_ = static_cast<std::uint32_t>(width);
+  height_ = static_cast<std::uint32_t>(height);
+  pixels_.resize(static_cast<std::size_t>(width_) * height_);
+  // Files start with the top row
+  for (std::uint32_t y = 0; y < height_; ++y) {
+    const stbi_uc *src =
+        data + static_cast<std::size_t>(height_ - 1 - y) * width_ * 4;
+    std::uint32_t *dst = pixels_.data() + static_cast<std::size_t>(y) * width_;
+    for (std::uint32_t x = 0; x < width_; ++x) {
+      dst[x] = static_cast<std::uint32_t>(src[x * 4]) |
+               static_cast<std::uint32_t>(src[x * 4 + 1]) << 8 |
+               static_cast<std::uint32_t>(src[x * 4 + 2]) << 16 |
+               static_cast<std::uint32_t>(src[x * 4 + 3]) << 24;
+    }
+  }
+  stbi_image_free(data);
+  return true;
+}
+
+SampleSummary Summarize(std::vector<double> samples) {
+  SampleSummary summary{.count = samples.size()};
+  if (samples.empty()) {
+    return summary;
+  }
+  std::sort(samples.begin(), samples.end());
+  const double n = static_cast<double>(samples.size());
+  summary.median = samples[samples.size() / 2];
+  // Ranks n/2 -+ 1.96 sqrt(n)/2 bound the median with 95% confidence
+  const double half_width = 1.96 * std::sqrt(n) * 0.5;
+  const auto rank = [&](double r) {
+    return samples[static_cast<std::size_t>(std::clamp(r, 0.0, n - 1.0))];
+  };
+  summary.low = rank(std::floor(n * 0.5 - half_width));
+  summary.high = rank(std::ceil(n * 0.5 + half_width));
+  return summary;
+}
+
+bool PerfBudget::Load(const char *path) {
+  std::FILE *file = std::fopen(path, "r");
+  if (file == nullptr) {
+    return false;
+  }
+  char line[256];
+  while (std::fgets(line, sizeof(line), file) != nullptr) {
+    char key[128];
+    double value{};
+    if (line[0] == '#' || std::sscanf(line, "%127s %lf", key, &value) != 2) {
+      continue;
+    }
+    Set(key, value);
+  }
+  std::fclose(file);
+  return true;
+}
+
+bool PerfBudget::Save(const char *path) const {
+  std::FILE *file = std::fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fprintf(file, "# Performance budget of demo_check, written by "
+                     "demo_check --record\n");
+  for (const auto &[key, value] : entries_) {
+    std::fprintf(file, "%s %.3f\n", key.c_str(), value);
+  }
+  return std::fclose(file) == 0;
+}
+
+double PerfBudget::Get(const std::string &key) const {
+  for (const auto &[name, value] : entries_) {
+    if (name == key) {
+      return value;
+    }
+  }
+  return -1.0;
+}
+
+void PerfBudget::Set(const std::string &key, double value) {
+  for (auto &[name, current] : entries_) {
+    if (name == key) {
+      current = value;
+      return;
+    }
+  }
+  entries_.emplace_back(key, value);
+}
@@ -0,0 +1,53 @@
+#include "headless_engine.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "memory_stats.h"
+
+bool ParseEngineOption(const char *arg, const char *value,
+                       EngineOptions &options) {
+  if (std::strcmp(arg, "--job-workers") == 0) {
+    if (value == nullptr || std::atoi(value) <= 0) {
+      return false;
+    }
+    options.job_workers = static_cast<unsigned>(std::atoi(value));
+    return true;
+  }
+  return ParseThreadOption(arg, value, options.thread_placements);
+}
+
+void PrintEngineUsage() {
+  std::printf(
+      "  --job-workers <n>     job system worker threads (default half of\n"
+      "                        the hardware threads)\n");
+  PrintThreadUsage();
+}
+
+unsigned DefaultRowHelpers() {
+  return std::thread::hardware_concurrency() / 4;
+}
+
+void SetupRenderSystem(RenderSystem &rs, AsyncLoader &loader,
+                       const char *library,
+                       std::optional<unsigned> array_numa_node) {
+  rs.Init(library);
+  rs.SetArrayNumaNode(array_numa_node);
+  PrintMemorySnapshot("init", rs.Arrays(), false);
+  rs.CreateScene(loader);
+  PrintMemorySnapshot("create-scene", rs.Arrays(), true);
+  rs.SetupFrame();
+  PrintMemorySnapshot("setup-frame", rs.Arrays(), false);
+}
+
+HeadlessEngine::HeadlessEngine(const EngineOptions &options,
+                               const char *library,
+                               std::optional<unsigned> array_numa_node)
+    : row_workers{DefaultRowHelpers()}, jobs{options.JobWorkers()},
+      loader{jobs}, pipeline{rs, row_workers} {
+  SetupRenderSystem(rs, loader, library, array_numa_node);
+  main_placement_.emplace(ThreadRole::kMain, 0);
+  PrintThreadPlacement();
+}
@@ -0,0 +1,69 @@
+#include "hitch_detector.h"
+
+#include <algorithm>
+#include <cstdio>
+
+bool HitchDetector::Check(const FrameTelemetry &telemetry) {
+  bool hitch{false};
+  if (count_ >= kWarmupFrames) {
+    const float median = Median(total_history_);
+    if (median > 0.0F && telemetry.total_ms > factor_ * median) {
+      hitch = true;
+      ++hitches_;
+      Report(telemetry, median);
+    }
+  }
+
+  // Hitches enter the history too, a lasting slowdown becomes the new normal
+  total_history_[next_] = telemetry.total_ms;
+  for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+    stage_history_[stage][next_] = telemetry.stage_ms[stage];
+  }
+  next_ = (next_ + 1) % kWindow;
+  count_ = std::min(count_ + 1, kWindow);
+  return hitch;
+}
+
+float HitchDetector::Median(const std::array<float, kWindow> &history) const {
+  std::array<float, kWindow> values = history;
+  const auto middle = values.begin() + count_ / 2;
+  std::nth_element(values.begin(), middle, values.begin() + count_);
+  return *middle;
+}
+
+void HitchDetector::Report(const FrameTelemetry &telemetry,
+                           float median) const {
+  // The stage with the largest excess over its own median is the likely cause
+  std::size_t cause{};
+  float cause_excess{};
+  for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+    const float excess =
+        telemetry.stage_ms[stage] - Median(stage_history_[stage]);
+    if (excess > cause_excess) {
+      cause = stage;
+      cause_excess = excess;
+    }
+  }
+
+  char message[96]{};
+  CopyLatestStatusMessage(message, sizeof(message));
+
+  std::printf("WARNING: Hitch in frame %llu: %.2f ms, %.1fx the median "
+              "%.2f ms, cause %s (+%.2f ms)\n",
+              static_cast<unsigned long long>(telemetry.frame),
+              telemetry.total_ms, telemetry.total_ms / median, median,
+              FrameStageName(static_cast<FrameStage>(cause)), cause_excess);
+  std::printf("WARNING:   stages ms:");
+  for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+    std::printf(" %s=%.2f", FrameStageName(static_cast<FrameStage>(stage)),
+                telemetry.stage_ms[stage]);
+  }
+  std::printf("\nWARNING:   size=%ux%u commits=%u releases=%u allocs=%u "
+              "(%llu bytes) warnings=%u errors=%u%s%s\n",
+              telemetry.width, telemetry.height, telemetry.commits,
+              telemetry.releases, telemetry.allocations,
+              static_cast<unsigned long long>(telemetry.allocated_bytes),
+              telemetry.warnings, telemetry.errors,
+              telemetry.warnings + telemetry.errors > 0 ? " last: " : "",
+              telemetry.warnings + telemetry.errors > 0 ? message : "");
+}
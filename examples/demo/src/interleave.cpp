@@ -0,0 +1,86 @@
+#include "interleave.h"
+
+#include "kernels.h"
+#include "row_workers.h"
+
+constexpr std::size_t kParallelPixels = 1U << 20;
+
+std::uint32_t InterleavedWidth(std::uint32_t width, std::uint32_t parity) {
+  return (width + 1 - parity) / 2;
+}
+
+box2 InterleavedImageRegion(std::uint32_t width, std::uint32_t parity) {
+  // Half frame pixel j is centered at (2j + 1) / width without a shift and
+  // should be centered at (2j + parity + 0.5) / width
+  const float w = static_cast<float>(width);
+  const float shift = (static_cast<float>(parity) - 0.5F) / w;
+  const float extent =
+      2.0F * static_cast<float>(InterleavedWidth(width, parity)) / w;
+  return {vec2{shift, 0.0F}, vec2{shift + extent, 1.0F}};
+}
+
+void InterleavedReconstructor::Reconstruct(FrameView<const std::uint32_t> half,
+                                           std::uint32_t parity,
+                                           std::uint32_t width) {
+  if (half.Empty() || half.Width() != InterleavedWidth(width, parity)) {
+    return;
+  }
+  if (width != width_ || half.Height() != height_) {
+    width_ = width;
+    height_ = half.Height();
+    const std::size_t size = static_cast<std::size_t>(width_) * height_;
+    color_[0].resize(size);
+    color_[1].resize(size);
+    depth_.resize(size);
+    history_valid_ = false;
+  }
+
+  const std::size_t history = current_;
+  current_ = 1 - current_;
+  const std::uint32_t *history_pixels = color_[history].data();
+  std::uint32_t *dst_pixels = color_[current_].data();
+  const bool history_valid = history_valid_;
+  const Kernels &kernels = GetKernels();
+
+  auto reconstruct_rows = [&](std::uint32_t begin, std::uint32_t end) {
+    for (std::uint32_t y = begin; y < end; ++y) {
+      const std::size_t offset = static_cast<std::size_t>(y) * width_;
+      // Without history the clamp picks the closest rendered neighbor
+      // value, i.e. columns are repeated
+      const std::uint32_t *history_row =
+          history_valid ? history_pixels + offset : dst_pixels + offset;
+      if (!history_valid) {
+        const auto half_row = half.Row(y);
+        for (std::uint32_t x = 0; x < width_; ++x) {
+          dst_pixels[offset + x] = half_row[(x >= parity ? x - parity : 0) / 2];
+        }
+      }
+      kernels.reconstruct_interleaved_rgba8(half.Row(y).data(), history_row,
+                                            dst_pixels + offset, width_,
+                                            parity);
+    }
+  };
+  if (workers_ != nullptr && color_[0].size() >= kParallelPixels) {
+    workers_->ForRows(height_, reconstruct_rows);
+  } else {
+    reconstruct_rows(0, height_);
+  }
+  history_valid_ = true;
+}
+
+void InterleavedReconstructor::ReconstructDepth(FrameView<const float> half,
+                                                std::uint32_t parity) {
+  if (half.Width() != InterleavedWidth(width_, parity) ||
+      half.Height() != height_) {
+    return;
+  }
+  const std::uint32_t half_width = half.Width();
+  for (std::uint32_t y = 0; y < height_; ++y) {
+    const auto src = half.Row(y);
+    float *dst = depth_.data() + static_cast<std::size_t>(y) * width_;
+    for (std::uint32_t x = 0; x < width_; ++x) {
+      const std::uint32_t j = (x >= parity ? x - parity : 0) / 2;
+      dst[x] = src[j < half_width ? j : half_width - 1];
+    }
+  }
+}
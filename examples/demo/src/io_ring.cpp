@@ -0,0 +1,358 @@
+#include "io_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// The operations are enumerators, this feature flag came with them in 5.6
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_CUR_PERSONALITY)
+#define ANARI_PROJECT_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+bool EvictFromPageCache(const char *path) {
+#ifdef __linux__
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  const bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  close(fd);
+  return evicted;
+#else
+  return false;
+#endif
+}
+
+#ifdef ANARI_PROJECT_HAS_IO_URING
+
+// The kernel reads and writes the ring indices concurrently
+static unsigned loadAcquire(unsigned *index) {
+  return std::atomic_ref<unsigned>{*index}.load(std::memory_order_acquire);
+}
+
+static void storeRelease(unsigned *index, unsigned value) {
+  std::atomic_ref<unsigned>{*index}.store(value, std::memory_order_release);
+}
+
+static int ioUringSetup(unsigned entries, io_uring_params &params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+static int ioUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                        unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, const void *arg,
+                           unsigned count) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+// Whether the kernel knows the operations we use, OPENAT and READ came with
+// Linux 5.6
+static bool supportsOperations(int ring_fd) {
+  constexpr unsigned kProbeOps = 64;
+  const std::size_t bytes =
+      sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op);
+  std::vector<unsigned char> storage(bytes);
+  auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+  if (ioUringRegister(ring_fd, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+    return false;
+  }
+  for (const unsigned op : {IORING_OP_OPENAT, IORING_OP_READ,
+                            IORING_OP_READ_FIXED}) {
+    if (op > probe->last_op ||
+        (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif
+
+IoRing::~IoRing() {
+#ifdef ANARI_PROJECT_HAS_IO_URING
+  for (const Slot &slot : slots_) {
+    if (slot.fd >= 0) {
+      close(slot.fd);
+    }
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_bytes_);
+  }
+  if (ring_ != nullptr) {
+    munmap(ring_, ring_bytes_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+#endif
+}
+
+bool IoRing::Init() {
+#ifdef ANARI_PROJECT_HAS_IO_URING
+  io_uring_params params{};
+  ring_fd_ = ioUringSetup(kSlots, params);
+  if (ring_fd_ < 0) {
+    return false;
+  }
+  // Both came with Linux 5.4 and keep the bookkeeping simple
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0 ||
+      (params.features & IORING_FEAT_NODROP) == 0 ||
+      !supportsOperations(ring_fd_)) {
+    return false;
+  }
+
+  ring_bytes_ = std::max<std::size_t>(
+      params.sq_off.array + params.sq_entries * sizeof(unsigned),
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  ring_ = mmap(nullptr, ring_bytes_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ring_ == MAP_FAILED) {
+    ring_ = nullptr;
+    return false;
+  }
+  sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    sqes_ = nullptr;
+    return false;
+  }
+  auto *ring = static_cast<unsigned char *>(ring_);
+  sq_tail_ = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+  sq_array_ = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+  sq_mask_ = *reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+  cq_head_ = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+  cqes_ = ring + params.cq_off.cqes;
+
+  buffers_ = std::make_unique<unsigned char[]>(kSlots * kBufferSize);
+  iovec iovecs[kSlots]{};
+  for (unsigned i = 0; i < kSlots; ++i) {
+    iovecs[i].iov_base = buffers_.get() + i * kBufferSize;
+    iovecs[i].iov_len = kBufferSize;
+  }
+  // Locked memory counts against RLIMIT_MEMLOCK, plain reads still work
+  if (ioUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, iovecs, kSlots) <
+      0) {
+    std::printf("WARNING: Cannot register io_uring buffers: %s\n",
+                std::strerror(errno));
+    buffers_.reset();
+  }
+
+  free_slots_.reserve(kSlots);
+  for (unsigned i = kSlots; i > 0; --i) {
+    free_slots_.push_back(i - 1);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void IoRing::Read(const char *path, FileData *data, void *user) {
+  const unsigned slot = free_slots_.back();
+  free_slots_.pop_back();
+  slots_[slot] = Slot{.path = path, .data = data, .user = user};
+  QueueOpen(slot);
+}
+
+#ifdef ANARI_PROJECT_HAS_IO_URING
+
+// Each slot has at most one entry in flight, so there is always room
+static io_uring_sqe &nextSqe(void *sqes, unsigned *sq_tail,
+                             unsigned *sq_array, unsigned sq_mask,
+                             unsigned &queued) {
+  // Only this thread writes the tail
+  const unsigned tail = *sq_tail + queued;
+  const unsigned index = tail & sq_mask;
+  sq_array[index] = index;
+  ++queued;
+  io_uring_sqe &sqe = static_cast<io_uring_sqe *>(sqes)[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  return sqe;
+}
+
+void IoRing::QueueOpen(unsigned slot) {
+  io_uring_sqe &sqe =
+      nextSqe(sqes_, sq_tail_, sq_array_, sq_mask_, queued_);
+  sqe.opcode = IORING_OP_OPENAT;
+  sqe.fd = AT_FDCWD;
+  sqe.addr = reinterpret_cast<std::uintptr_t>(slots_[slot].path);
+  sqe.open_flags = O_RDONLY | O_CLOEXEC;
+  sqe.user_data = slot;
+}
+
+void IoRing::QueueRead(unsigned slot) {
+  Slot &s = slots_[slot];
+  io_uring_sqe &sqe =
+      nextSqe(sqes_, sq_tail_, sq_array_, sq_mask_, queued_);
+  const bool fixed = buffers_ && s.size <= kBufferSize;
+  unsigned char *target = fixed ? buffers_.get() + slot * kBufferSize
+                                : s.data->data();
+  sqe.opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+  sqe.fd = s.fd;
+  sqe.off = s.offset;
+  sqe.addr = reinterpret_cast<std::uintptr_t>(target + s.offset);
+  sqe.len = static_cast<unsigned>(
+      std::min<std::size_t>(s.size - s.offset, 1U << 30));
+  sqe.buf_index = fixed ? static_cast<std::uint16_t>(slot) : 0;
+  sqe.user_data = slot;
+}
+
+void IoRing::Finish(unsigned slot, bool ok, std::vector<Completion> &done) {
+  Slot &s = slots_[slot];
+  if (ok && buffers_ && s.size <= kBufferSize) {
+    const unsigned char *buffer = buffers_.get() + slot * kBufferSize;
+    s.data->assign(buffer, buffer + s.offset);
+  }
+  if (!ok) {
+    s.data->clear();
+  }
+  if (s.fd >= 0) {
+    close(s.fd);
+  }
+  done.push_back({s.user, ok});
+  s = Slot{};
+  free_slots_.push_back(slot);
+}
+
+void IoRing::HandleCompletion(unsigned slot, int result,
+                              std::vector<Completion> &done) {
+  Slot &s = slots_[slot];
+  if (result == -EINTR || result == -EAGAIN) {
+    if (s.stage == Stage::kOpen) {
+      QueueOpen(slot);
+    } else {
+      QueueRead(slot);
+    }
+    return;
+  }
+  if (s.stage == Stage::kOpen) {
+    s.fd = result;
+    struct stat info{};
+    if (s.fd < 0 || fstat(s.fd, &info) != 0) {
+      std::printf("Error: Cannot open %s\n", s.path);
+      Finish(slot, false, done);
+      return;
+    }
+    s.size = static_cast<std::size_t>(info.st_size);
+    s.stage = Stage::kRead;
+    if (s.size == 0) {
+      Finish(slot, true, done);
+      return;
+    }
+    if (!buffers_ || s.size > kBufferSize) {
+      s.data->resize(s.size);
+    }
+    QueueRead(slot);
+    return;
+  }
+  if (result < 0) {
+    std::printf("Error: Cannot read %s: %s\n", s.path, std::strerror(-result));
+    Finish(slot, false, done);
+    return;
+  }
+  s.offset += static_cast<std::size_t>(result);
+  if (result == 0 || s.offset == s.size) {
+    // Shrunk since fstat() if short
+    if (!buffers_ || s.size > kBufferSize) {
+      s.data->resize(s.offset);
+    }
+    Finish(slot, true, done);
+    return;
+  }
+  QueueRead(slot);
+}
+
+// Without SQPOLL the kernel reads the submission ring only in
+// io_uring_enter(), so entries it has not taken can be taken back.
+void IoRing::FailUnsubmitted(std::vector<Completion> &done) {
+  const unsigned tail = *sq_tail_ - unsubmitted_;
+  const unsigned count = unsubmitted_ + queued_;
+  for (unsigned i = 0; i < count; ++i) {
+    const unsigned index = sq_array_[(tail + i) & sq_mask_];
+    const io_uring_sqe &sqe = static_cast<const io_uring_sqe *>(sqes_)[index];
+    Finish(static_cast<unsigned>(sqe.user_data), false, done);
+  }
+  storeRelease(sq_tail_, tail);
+  unsubmitted_ = 0;
+  queued_ = 0;
+}
+
+void IoRing::Reap(std::vector<Completion> &done) {
+  const std::size_t reaped = done.size();
+  while (true) {
+    if (failed_) {
+      FailUnsubmitted(done);
+    }
+    storeRelease(sq_tail_, *sq_tail_ + queued_);
+    unsubmitted_ += queued_;
+    queued_ = 0;
+    // Done reads that queue nothing new end the loop. A failed ring is only
+    // polled for the reads it took before.
+    const bool wait = !failed_ && !Idle() && done.size() == reaped;
+    if (unsubmitted_ > 0 || wait) {
+      const int entered =
+          ioUringEnter(ring_fd_, unsubmitted_, wait ? 1 : 0,
+                       wait ? IORING_ENTER_GETEVENTS : 0);
+      if (entered >= 0) {
+        // Possibly fewer than asked for, the rest go with the next call
+        unsubmitted_ -= std::min(static_cast<unsigned>(entered), unsubmitted_);
+      } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        std::printf("Error: io_uring_enter failed, failing queued reads: %s\n",
+                    std::strerror(errno));
+        failed_ = true;
+        FailUnsubmitted(done);
+      }
+    }
+    unsigned head = *cq_head_;
+    const unsigned tail = loadAcquire(cq_tail_);
+    if (head == tail && !wait) {
+      // Reads in flight on a failed ring complete without notice
+      if (failed_ && !Idle() && done.size() == reaped) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+      return;
+    }
+    for (; head != tail; ++head) {
+      const io_uring_cqe &cqe =
+          static_cast<const io_uring_cqe *>(cqes_)[head & cq_mask_];
+      HandleCompletion(static_cast<unsigned>(cqe.user_data), cqe.res, done);
+    }
+    storeRelease(cq_head_, head);
+    if (queued_ == 0 && done.size() > reaped) {
+      return;
+    }
+  }
+}
+
+#else
+
+void IoRing::QueueOpen(unsigned) {}
+void IoRing::QueueRead(unsigned) {}
+void IoRing::Finish(unsigned, bool, std::vector<Completion> &) {}
+void IoRing::HandleCompletion(unsigned, int, std::vector<Completion> &) {}
+void IoRing::Reap(std::vector<Completion> &) {}
+
+#endif
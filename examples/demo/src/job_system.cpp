@@ -0,0 +1,167 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "thread_placement.h"
+
+// Worker the current thread belongs to, if any
+static thread_local const JobSystem *current_system{};
+static thread_local unsigned current_worker{};
+
+JobSystem::JobSystem(unsigned workers)
+    : workers_{workers},
+      queues_{std::make_unique<WorkerQueues[]>(workers + 1)} {
+  threads_.reserve(workers);
+  for (unsigned i = 0; i < workers; ++i) {
+    threads_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard lock{sleep_mutex_};
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+unsigned JobSystem::DefaultWorkers() {
+  return std::max(std::thread::hardware_concurrency() / 2, 1U);
+}
+
+void JobSystem::Push(Entry entry) {
+  if (entry.counter != nullptr) {
+    entry.counter->pending_.fetch_add(1, std::memory_order_relaxed);
+  }
+  bool queued{};
+  if (workers_ > 0) {
+    WorkerQueues &queues = queues_[OwnQueue()];
+    std::lock_guard lock{queues.mutex};
+    Deque &deque = queues.deques[static_cast<std::size_t>(entry.priority)];
+    if (deque.size < kQueueCapacity) {
+      deque.entries[(deque.head + deque.size) % kQueueCapacity] = entry;
+      ++deque.size;
+      queued_.fetch_add(1, std::memory_order_release);
+      queued = true;
+    }
+  }
+  if (!queued) {
+    // No workers, or back pressure on the submitter
+    inline_runs_.fetch_add(1, std::memory_order_relaxed);
+    Run(entry);
+    return;
+  }
+  // Taking the lock orders this with the predicate check of a worker about
+  // to sleep, so the notification cannot get lost
+  { std::lock_guard lock{sleep_mutex_}; }
+  work_cv_.notify_one();
+}
+
+bool JobSystem::TryPop(JobPriority priority, unsigned queue, bool steal,
+                       Entry &entry) {
+  WorkerQueues &queues = queues_[queue];
+  std::lock_guard lock{queues.mutex};
+  Deque &deque = queues.deques[static_cast<std::size_t>(priority)];
+  if (deque.size == 0) {
+    return false;
+  }
+  if (steal) {
+    entry = deque.entries[deque.head];
+    deque.head = (deque.head + 1) % kQueueCapacity;
+  } else {
+    entry = deque.entries[(deque.head + deque.size - 1) % kQueueCapacity];
+  }
+  --deque.size;
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+unsigned JobSystem::OwnQueue() const {
+  return current_system == this ? current_worker : workers_;
+}
+
+// Own jobs first, then stolen ones, for each priority in turn.
+bool JobSystem::FindJob(Entry &entry) {
+  const unsigned queues = workers_ + 1;
+  const unsigned own = OwnQueue();
+  for (std::size_t p = 0; p < kJobPriorityCount; ++p) {
+    const auto priority = static_cast<JobPriority>(p);
+    if (TryPop(priority, own, false, entry)) {
+      return true;
+    }
+    for (unsigned i = 1; i < queues; ++i) {
+      if (TryPop(priority, (own + i) % queues, true, entry)) {
+        queues_[own].stolen.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void JobSystem::Run(Entry &entry) {
+  {
+    AllocScope scope{entry.subsystem};
+    entry.job();
+  }
+  queues_[OwnQueue()]
+      .executed[static_cast<std::size_t>(entry.priority)]
+      .fetch_add(1, std::memory_order_relaxed);
+  if (entry.counter != nullptr &&
+      entry.counter->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    { std::lock_guard lock{sleep_mutex_}; }
+    done_cv_.notify_all();
+  }
+}
+
+void JobSystem::Wait(JobCounter &counter) {
+  while (!counter.Done()) {
+    Entry entry{};
+    if (FindJob(entry)) {
+      Run(entry);
+      continue;
+    }
+    // The remaining jobs run elsewhere. The timeout covers jobs they submit,
+    // which this thread could help with.
+    std::unique_lock lock{sleep_mutex_};
+    done_cv_.wait_for(lock, std::chrono::milliseconds{1},
+                      [&] { return counter.Done(); });
+  }
+}
+
+void JobSystem::WorkerLoop(unsigned worker) {
+  ThreadPlacementScope placement{ThreadRole::kJobs, worker};
+  current_system = this;
+  current_worker = worker;
+  while (true) {
+    Entry entry{};
+    if (FindJob(entry)) {
+      Run(entry);
+      continue;
+    }
+    std::unique_lock lock{sleep_mutex_};
+    work_cv_.wait(lock, [this] {
+      return stop_ || queued_.load(std::memory_order_acquire) > 0;
+    });
+    if (stop_ && queued_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+JobSystem::Stats JobSystem::GetStats() const {
+  Stats stats{};
+  for (unsigned i = 0; i <= workers_; ++i) {
+    for (std::size_t p = 0; p < kJobPriorityCount; ++p) {
+      stats.executed[p] +=
+          queues_[i].executed[p].load(std::memory_order_relaxed);
+    }
+    stats.stolen += queues_[i].stolen.load(std::memory_order_relaxed);
+  }
+  stats.inline_runs = inline_runs_.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,103 @@
+#include "kernels.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace kernels_scalar {
+const Kernels &Table();
+} // namespace kernels_scalar
+
+#if ANARI_PROJECT_KERNELS_SSE42
+namespace kernels_sse42 {
+const Kernels &Table();
+} // namespace kernels_sse42
+#endif
+
+#if ANARI_PROJECT_KERNELS_X86
+namespace kernels_avx2 {
+const Kernels &Table();
+} // namespace kernels_avx2
+namespace kernels_avx512 {
+const Kernels &Table();
+} // namespace kernels_avx512
+#endif
+
+#if ANARI_PROJECT_KERNELS_NEON
+namespace kernels_neon {
+const Kernels &Table();
+} // namespace kernels_neon
+#endif
+
+static bool canRun(SimdLevel level, SimdLevel detected) {
+  if (level == SimdLevel::kScalar) {
+    return true;
+  }
+  if (level == SimdLevel::kNeon || detected == SimdLevel::kNeon) {
+    return level == detected;
+  }
+  return static_cast<int>(level) <= static_cast<int>(detected);
+}
+
+const Kernels *GetKernelsFor(SimdLevel level) {
+  static const SimdLevel detected = DetectSimdLevel();
+  if (!canRun(level, detected)) {
+    return nullptr;
+  }
+  switch (level) {
+  case SimdLevel::kScalar:
+    return &kernels_scalar::Table();
+#if ANARI_PROJECT_KERNELS_SSE42
+  case SimdLevel::kSse42:
+    return &kernels_sse42::Table();
+#endif
+#if ANARI_PROJECT_KERNELS_X86
+  case SimdLevel::kAvx2:
+    return &kernels_avx2::Table();
+  case SimdLevel::kAvx512:
+    return &kernels_avx512::Table();
+#endif
+#if ANARI_PROJECT_KERNELS_NEON
+  case SimdLevel::kNeon:
+    return &kernels_neon::Table();
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+static const Kernels &selectKernels() {
+  const SimdLevel detected = DetectSimdLevel();
+  SimdLevel requested = detected;
+  if (const char *env = std::getenv("ANARI_PROJECT_SIMD")) {
+    if (!ParseSimdLevel(env, requested)) {
+      std::printf("WARNING: unknown ANARI_PROJECT_SIMD=%s, using %s\n", env,
+                  SimdLevelName(detected));
+      requested = detected;
+    }
+  }
+
+  // Walk down from the requested level to the best one that is available
+  constexpr SimdLevel kOrder[] = {SimdLevel::kAvx512, SimdLevel::kAvx2,
+                                  SimdLevel::kSse42, SimdLevel::kNeon,
+                                  SimdLevel::kScalar};
+  bool reached{false};
+  for (const auto level : kOrder) {
+    reached = reached || level == requested;
+    if (!reached) {
+      continue;
+    }
+    if (const Kernels *kernels = GetKernelsFor(level)) {
+      if (level != requested) {
+        std::printf("WARNING: %s kernels are not available, using %s\n",
+                    SimdLevelName(requested), SimdLevelName(level));
+      }
+      return *kernels;
+    }
+  }
+  return kernels_scalar::Table();
+}
+
+const Kernels &GetKernels() {
+  static const Kernels &kernels = selectKernels();
+  return kernels;
+}
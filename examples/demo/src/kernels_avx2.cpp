@@ -0,0 +1,3 @@
+#define KERNELS_NAMESPACE kernels_avx2
+#define KERNELS_LEVEL SimdLevel::kAvx2
+#include "kernels_impl.inl"
@@ -0,0 +1,3 @@
+#define KERNELS_NAMESPACE kernels_avx512
+#define KERNELS_LEVEL SimdLevel::kAvx512
+#include "kernels_impl.inl"
@@ -0,0 +1,460 @@
+// Kernel implementations shared by the kernels_<level>.cpp translation units.
+// The including file defines KERNELS_NAMESPACE and KERNELS_LEVEL, and
+// KERNELS_SCALAR for the portable build. Explicit vector paths are picked by
+// the target macros the per-file compiler flags define. Only sumAbsDiffU8
+// and rgba32fToRgba8 have them; every other kernel relies on the compiler
+// auto-vectorizing it for each target, which is why those loops are kept
+// branch-free, without gathers or calls.
+//
+// Do not call inline functions from other headers here (std::min, std::span,
+// ...): every translation unit would emit its own copy of them, compiled for
+// a different instruction set, and the linker is free to keep any of them.
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <math.h>
+#endif
+
+#include "kernels.h"
+
+#if !defined(KERNELS_SCALAR)
+#if defined(__AVX2__) || defined(__SSE4_2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace KERNELS_NAMESPACE {
+namespace {
+
+std::uint64_t sumAbsDiffU8(const std::uint8_t *a, const std::uint8_t *b,
+                           std::size_t n) {
+  std::size_t i{0};
+  std::uint64_t sum{0};
+#if defined(KERNELS_SCALAR)
+#elif defined(__AVX512BW__)
+  __m512i acc = _mm512_setzero_si512();
+  for (; i + 64 <= n; i += 64) {
+    const __m512i va = _mm512_loadu_si512(a + i);
+    const __m512i vb = _mm512_loadu_si512(b + i);
+    acc = _mm512_add_epi64(acc, _mm512_sad_epu8(va, vb));
+  }
+  alignas(64) std::uint64_t lanes[8];
+  _mm512_store_si512(lanes, acc);
+  for (const auto lane : lanes) {
+    sum += lane;
+  }
+#elif defined(__AVX2__)
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 32 <= n; i += 32) {
+    const __m256i va =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    const __m256i vb =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+  }
+  const __m128i acc128 = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                                       _mm256_extracti128_si256(acc, 1));
+  sum += static_cast<std::uint64_t>(_mm_extract_epi64(acc128, 0)) +
+         static_cast<std::uint64_t>(_mm_extract_epi64(acc128, 1));
+#elif defined(__SSE4_2__)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    const __m128i va =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    const __m128i vb =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+  }
+  sum += static_cast<std::uint64_t>(_mm_extract_epi64(acc, 0)) +
+         static_cast<std::uint64_t>(_mm_extract_epi64(acc, 1));
+#elif defined(__ARM_NEON)
+  uint64x2_t acc = vdupq_n_u64(0);
+  for (; i + 16 <= n; i += 16) {
+    const uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+    acc = vpadalq_u32(acc, vpaddlq_u16(vpaddlq_u8(diff)));
+  }
+  sum += vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+#endif
+  for (; i < n; ++i) {
+    sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+  }
+  return sum;
+}
+
+std::uint64_t sumSqDiffU8(const std::uint8_t *a, const std::uint8_t *b,
+                          std::size_t n) {
+  // 32-bit partial sums vectorize well, flush them before they can overflow
+  constexpr std::size_t kBlock = 1U << 15;
+  std::uint64_t sum{0};
+  for (std::size_t begin = 0; begin < n; begin += kBlock) {
+    const std::size_t end = n - begin < kBlock ? n : begin + kBlock;
+    std::uint32_t block_sum{0};
+    for (std::size_t i = begin; i < end; ++i) {
+      const std::int32_t d = static_cast<std::int32_t>(a[i]) - b[i];
+      block_sum += static_cast<std::uint32_t>(d * d);
+    }
+    sum += block_sum;
+  }
+  return sum;
+}
+
+constexpr std::uint32_t kOpaque{0xFF000000U};
+
+float clamp01(float v) { return v > 0.0F ? (v < 1.0F ? v : 1.0F) : 0.0F; }
+
+void rgba8ToRgba8(const std::uint32_t *src, std::uint32_t *dst,
+                  std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    dst[i] = src[i];
+  }
+}
+
+// sRGB encoding without a table, so no per-channel gather: Ian Taylor's fit
+// of the curve from three nested square roots. It is within one 8-bit step
+// of the exact curve, rounds like a 4096 entry table would and is evaluated
+// the same way by every vector path.
+constexpr float kSrgbS1 = 0.662002687F;
+constexpr float kSrgbS2 = 0.684122060F;
+constexpr float kSrgbS3 = -0.323583601F;
+constexpr float kSrgbX = -0.0225411470F;
+// Below this the curve is linear
+constexpr float kSrgbLinearLimit = 0.0031308F;
+constexpr float kSrgbLinearScale = 12.92F;
+
+// Not std::sqrt, see above
+float sqrtF32(float v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return ::sqrtf(v);
+#else
+  return __builtin_sqrtf(v);
+#endif
+}
+
+// linear in [0, 1]
+float encodeSrgb(float linear) {
+  const float s1 = sqrtF32(linear);
+  const float s2 = sqrtF32(s1);
+  const float s3 = sqrtF32(s2);
+  const float curve =
+      kSrgbS1 * s1 + kSrgbS2 * s2 + kSrgbS3 * s3 + kSrgbX * linear;
+  return linear <= kSrgbLinearLimit ? linear * kSrgbLinearScale : curve;
+}
+
+std::uint32_t toUnorm8(float v) {
+  return static_cast<std::uint32_t>(v * 255.0F + 0.5F);
+}
+
+std::uint32_t rgba32fPixel(const float *pixel) {
+  const std::uint32_t r = toUnorm8(encodeSrgb(clamp01(pixel[0])));
+  const std::uint32_t g = toUnorm8(encodeSrgb(clamp01(pixel[1])));
+  const std::uint32_t b = toUnorm8(encodeSrgb(clamp01(pixel[2])));
+  const std::uint32_t a = toUnorm8(clamp01(pixel[3]));
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// One pixel per 128 bits of a vector, lanes R, G, B, A. The clamps map NaN
+// to 0 like clamp01(); the alpha lane is not encoded.
+#if defined(KERNELS_SCALAR)
+#elif defined(__AVX512F__)
+__m512 encodeSrgbPs(__m512 x) {
+  const __m512 s1 = _mm512_sqrt_ps(x);
+  const __m512 s2 = _mm512_sqrt_ps(s1);
+  const __m512 s3 = _mm512_sqrt_ps(s2);
+  __m512 curve = _mm512_mul_ps(_mm512_set1_ps(kSrgbS1), s1);
+  curve = _mm512_add_ps(curve, _mm512_mul_ps(_mm512_set1_ps(kSrgbS2), s2));
+  curve = _mm512_add_ps(curve, _mm512_mul_ps(_mm512_set1_ps(kSrgbS3), s3));
+  curve = _mm512_add_ps(curve, _mm512_mul_ps(_mm512_set1_ps(kSrgbX), x));
+  const __m512 linear = _mm512_mul_ps(x, _mm512_set1_ps(kSrgbLinearScale));
+  const __mmask16 below = _mm512_cmp_ps_mask(
+      x, _mm512_set1_ps(kSrgbLinearLimit), _CMP_LE_OQ);
+  return _mm512_mask_blend_ps(below, curve, linear);
+}
+
+// Four pixels
+__m128i rgba32fToRgba8Ps(const float *src) {
+  constexpr __mmask16 kAlpha = 0x8888;
+  __m512 v = _mm512_max_ps(_mm512_loadu_ps(src), _mm512_setzero_ps());
+  v = _mm512_min_ps(v, _mm512_set1_ps(1.0F));
+  const __m512 encoded = _mm512_mask_blend_ps(kAlpha, encodeSrgbPs(v), v);
+  const __m512 scaled = _mm512_add_ps(
+      _mm512_mul_ps(encoded, _mm512_set1_ps(255.0F)), _mm512_set1_ps(0.5F));
+  return _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(scaled));
+}
+#elif defined(__AVX2__)
+__m256 encodeSrgbPs(__m256 x) {
+  const __m256 s1 = _mm256_sqrt_ps(x);
+  const __m256 s2 = _mm256_sqrt_ps(s1);
+  const __m256 s3 = _mm256_sqrt_ps(s2);
+  __m256 curve = _mm256_mul_ps(_mm256_set1_ps(kSrgbS1), s1);
+  curve = _mm256_add_ps(curve, _mm256_mul_ps(_mm256_set1_ps(kSrgbS2), s2));
+  curve = _mm256_add_ps(curve, _mm256_mul_ps(_mm256_set1_ps(kSrgbS3), s3));
+  curve = _mm256_add_ps(curve, _mm256_mul_ps(_mm256_set1_ps(kSrgbX), x));
+  const __m256 linear = _mm256_mul_ps(x, _mm256_set1_ps(kSrgbLinearScale));
+  const __m256 below =
+      _mm256_cmp_ps(x, _mm256_set1_ps(kSrgbLinearLimit), _CMP_LE_OQ);
+  return _mm256_blendv_ps(curve, linear, below);
+}
+
+// Two pixels as 32-bit channel values
+__m256i rgba32fToChannels(const float *src) {
+  __m256 v = _mm256_max_ps(_mm256_loadu_ps(src), _mm256_setzero_ps());
+  v = _mm256_min_ps(v, _mm256_set1_ps(1.0F));
+  const __m256 encoded = _mm256_blend_ps(encodeSrgbPs(v), v, 0x88);
+  return _mm256_cvttps_epi32(_mm256_add_ps(
+      _mm256_mul_ps(encoded, _mm256_set1_ps(255.0F)), _mm256_set1_ps(0.5F)));
+}
+#elif defined(__SSE4_2__)
+__m128 encodeSrgbPs(__m128 x) {
+  const __m128 s1 = _mm_sqrt_ps(x);
+  const __m128 s2 = _mm_sqrt_ps(s1);
+  const __m128 s3 = _mm_sqrt_ps(s2);
+  __m128 curve = _mm_mul_ps(_mm_set1_ps(kSrgbS1), s1);
+  curve = _mm_add_ps(curve, _mm_mul_ps(_mm_set1_ps(kSrgbS2), s2));
+  curve = _mm_add_ps(curve, _mm_mul_ps(_mm_set1_ps(kSrgbS3), s3));
+  curve = _mm_add_ps(curve, _mm_mul_ps(_mm_set1_ps(kSrgbX), x));
+  const __m128 linear = _mm_mul_ps(x, _mm_set1_ps(kSrgbLinearScale));
+  return _mm_blendv_ps(curve, linear,
+                       _mm_cmple_ps(x, _mm_set1_ps(kSrgbLinearLimit)));
+}
+
+// One pixel as 32-bit channel values
+__m128i rgba32fToChannels(const float *src) {
+  __m128 v = _mm_max_ps(_mm_loadu_ps(src), _mm_setzero_ps());
+  v = _mm_min_ps(v, _mm_set1_ps(1.0F));
+  const __m128 encoded = _mm_blend_ps(encodeSrgbPs(v), v, 0x8);
+  return _mm_cvttps_epi32(
+      _mm_add_ps(_mm_mul_ps(encoded, _mm_set1_ps(255.0F)), _mm_set1_ps(0.5F)));
+}
+#elif defined(__ARM_NEON)
+float32x4_t encodeSrgbPs(float32x4_t x) {
+  const float32x4_t s1 = vsqrtq_f32(x);
+  const float32x4_t s2 = vsqrtq_f32(s1);
+  const float32x4_t s3 = vsqrtq_f32(s2);
+  float32x4_t curve = vmulq_n_f32(s1, kSrgbS1);
+  curve = vaddq_f32(curve, vmulq_n_f32(s2, kSrgbS2));
+  curve = vaddq_f32(curve, vmulq_n_f32(s3, kSrgbS3));
+  curve = vaddq_f32(curve, vmulq_n_f32(x, kSrgbX));
+  const float32x4_t linear = vmulq_n_f32(x, kSrgbLinearScale);
+  return vbslq_f32(vcleq_f32(x, vdupq_n_f32(kSrgbLinearLimit)), linear,
+                   curve);
+}
+
+// One pixel as 32-bit channel values
+uint32x4_t rgba32fToChannels(const float *src) {
+  const uint32x4_t alpha = vsetq_lane_u32(~0U, vdupq_n_u32(0), 3);
+  float32x4_t v = vmaxnmq_f32(vld1q_f32(src), vdupq_n_f32(0.0F));
+  v = vminq_f32(v, vdupq_n_f32(1.0F));
+  const float32x4_t encoded = vbslq_f32(alpha, v, encodeSrgbPs(v));
+  return vcvtq_u32_f32(
+      vaddq_f32(vmulq_n_f32(encoded, 255.0F), vdupq_n_f32(0.5F)));
+}
+#endif
+
+void rgba32fToRgba8(const float *src, std::uint32_t *dst, std::size_t n) {
+  std::size_t i{0};
+#if defined(KERNELS_SCALAR)
+#elif defined(__AVX512F__)
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     rgba32fToRgba8Ps(src + 4 * i));
+  }
+#elif defined(__AVX2__)
+  // Packing works within 128-bit lanes and leaves the pixels in the order
+  // 0, 2, 4, 6, 1, 3, 5, 7
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  for (; i + 8 <= n; i += 8) {
+    const float *pixels = src + 4 * i;
+    const __m256i words =
+        _mm256_packus_epi32(rgba32fToChannels(pixels),
+                            rgba32fToChannels(pixels + 8));
+    const __m256i words_high =
+        _mm256_packus_epi32(rgba32fToChannels(pixels + 16),
+                            rgba32fToChannels(pixels + 24));
+    const __m256i bytes = _mm256_packus_epi16(words, words_high);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                        _mm256_permutevar8x32_epi32(bytes, order));
+  }
+#elif defined(__SSE4_2__)
+  for (; i + 4 <= n; i += 4) {
+    const float *pixels = src + 4 * i;
+    const __m128i words = _mm_packus_epi32(rgba32fToChannels(pixels),
+                                           rgba32fToChannels(pixels + 4));
+    const __m128i words_high = _mm_packus_epi32(
+        rgba32fToChannels(pixels + 8), rgba32fToChannels(pixels + 12));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     _mm_packus_epi16(words, words_high));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 4 <= n; i += 4) {
+    const float *pixels = src + 4 * i;
+    const uint16x8_t words =
+        vcombine_u16(vqmovn_u32(rgba32fToChannels(pixels)),
+                     vqmovn_u32(rgba32fToChannels(pixels + 4)));
+    const uint16x8_t words_high =
+        vcombine_u16(vqmovn_u32(rgba32fToChannels(pixels + 8)),
+                     vqmovn_u32(rgba32fToChannels(pixels + 12)));
+    vst1q_u8(reinterpret_cast<std::uint8_t *>(dst + i),
+             vcombine_u8(vqmovn_u16(words), vqmovn_u16(words_high)));
+  }
+#endif
+  for (; i < n; ++i) {
+    dst[i] = rgba32fPixel(src + 4 * i);
+  }
+}
+
+void depthToRgba8(const float *src, std::uint32_t *dst, std::size_t n,
+                  float depth_min, float depth_max) {
+  const float range = depth_max - depth_min;
+  const float scale = range > 0.0F ? 255.0F / range : 0.0F;
+  for (std::size_t i = 0; i < n; ++i) {
+    const float depth = src[i];
+    const bool finite = depth <= FLT_MAX && depth >= -FLT_MAX;
+    float t = (depth - depth_min) * scale;
+    t = t > 0.0F ? (t < 255.0F ? t : 255.0F) : 0.0F;
+    const std::uint32_t gray =
+        finite ? 255U - static_cast<std::uint32_t>(t + 0.5F) : 0U;
+    dst[i] = gray * 0x010101U | kOpaque;
+  }
+}
+
+void idToRgba8(const std::uint32_t *src, std::uint32_t *dst, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t id = src[i];
+    std::uint32_t hash = id * 0x9E3779B1U;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    dst[i] = id == ~0U ? kOpaque : hash | kOpaque;
+  }
+}
+
+// x / 255 rounded, exact for x in [0, 255 * 255]
+std::uint32_t div255(std::uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+void compositeOverlayRgba8(const std::uint32_t *overlay,
+                           const float *overlay_depth, const float *scene_depth,
+                           std::uint32_t *dst, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t src = overlay[i];
+    const std::uint32_t base = dst[i];
+    const std::uint32_t alpha =
+        overlay_depth[i] < scene_depth[i] ? src >> 24 : 0U;
+    const std::uint32_t inv_alpha = 255U - alpha;
+    const std::uint32_t r =
+        div255((src & 0xFFU) * alpha + (base & 0xFFU) * inv_alpha);
+    const std::uint32_t g = div255(((src >> 8) & 0xFFU) * alpha +
+                                   ((base >> 8) & 0xFFU) * inv_alpha);
+    const std::uint32_t b = div255(((src >> 16) & 0xFFU) * alpha +
+                                   ((base >> 16) & 0xFFU) * inv_alpha);
+    dst[i] = r | (g << 8) | (b << 16) | (base & 0xFF000000U);
+  }
+}
+
+// Per-channel lerp of packed RGBA8 pixels, weight of b in [0, 256]
+std::uint32_t lerpRgba8(std::uint32_t a, std::uint32_t b, std::uint32_t w) {
+  const std::uint32_t inv_w = 256U - w;
+  const std::uint32_t rb =
+      (((a & 0x00FF00FFU) * inv_w + (b & 0x00FF00FFU) * w) >> 8) & 0x00FF00FFU;
+  const std::uint32_t ga =
+      (((a >> 8) & 0x00FF00FFU) * inv_w + ((b >> 8) & 0x00FF00FFU) * w) &
+      0xFF00FF00U;
+  return rb | ga;
+}
+
+void bilinearRowRgba8(const std::uint32_t *row0, const std::uint32_t *row1,
+                      std::uint32_t wy, const std::uint32_t *x0,
+                      const std::uint32_t *x1, const std::uint32_t *wx,
+                      std::uint32_t *dst, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t top = lerpRgba8(row0[x0[i]], row0[x1[i]], wx[i]);
+    const std::uint32_t bottom = lerpRgba8(row1[x0[i]], row1[x1[i]], wx[i]);
+    dst[i] = lerpRgba8(top, bottom, wy);
+  }
+}
+
+void blendRgba8(const std::uint32_t *src, const std::uint32_t *weight,
+                std::uint32_t row_weight, std::uint32_t *dst, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    dst[i] = lerpRgba8(dst[i], src[i], (weight[i] * row_weight) >> 8);
+  }
+}
+
+// Clamps each channel of v to the range spanned by the channels of a and b
+std::uint32_t clampRgba8(std::uint32_t v, std::uint32_t a, std::uint32_t b) {
+  std::uint32_t result{0};
+  for (std::uint32_t shift = 0; shift < 32; shift += 8) {
+    const std::uint32_t cv = (v >> shift) & 0xFFU;
+    const std::uint32_t ca = (a >> shift) & 0xFFU;
+    const std::uint32_t cb = (b >> shift) & 0xFFU;
+    const std::uint32_t lo = ca < cb ? ca : cb;
+    const std::uint32_t hi = ca < cb ? cb : ca;
+    const std::uint32_t c = cv < lo ? lo : (cv > hi ? hi : cv);
+    result |= c << shift;
+  }
+  return result;
+}
+
+void reconstructInterleavedRgba8(const std::uint32_t *half,
+                                 const std::uint32_t *history,
+                                 std::uint32_t *dst, std::size_t n,
+                                 std::uint32_t parity) {
+  const std::size_t half_n = (n + 1 - parity) / 2;
+  if (half_n == 0) {
+    return;
+  }
+  for (std::size_t j = 0; j < half_n; ++j) {
+    dst[2 * j + parity] = half[j];
+  }
+  // Missing column x sits between rendered columns x - 1 and x + 1, which
+  // are half[(x - 1 - parity) / 2] and the next one; clamp at the edges.
+  const std::size_t missing = 1 - parity;
+  for (std::size_t x = missing; x < n; x += 2) {
+    const std::size_t right = (x + 1 - parity) / 2;
+    const std::size_t left = x > parity ? (x - 1 - parity) / 2 : right;
+    const std::uint32_t a = half[left < half_n ? left : half_n - 1];
+    const std::uint32_t b = half[right < half_n ? right : half_n - 1];
+    dst[x] = clampRgba8(history[x], a, b);
+  }
+}
+
+void finiteMinMaxF32(const float *src, std::size_t n, float *min, float *max) {
+  float lo = *min;
+  float hi = *max;
+  for (std::size_t i = 0; i < n; ++i) {
+    const float value = src[i];
+    const bool finite = value <= FLT_MAX && value >= -FLT_MAX;
+    lo = finite && value < lo ? value : lo;
+    hi = finite && value > hi ? value : hi;
+  }
+  *min = lo;
+  *max = hi;
+}
+
+} // namespace
+
+const Kernels &Table() {
+  static const Kernels kernels{
+      .level = KERNELS_LEVEL,
+      .sum_abs_diff_u8 = sumAbsDiffU8,
+      .sum_sq_diff_u8 = sumSqDiffU8,
+      .rgba8_to_rgba8 = rgba8ToRgba8,
+      .rgba32f_to_rgba8 = rgba32fToRgba8,
+      .depth_to_rgba8 = depthToRgba8,
+      .id_to_rgba8 = idToRgba8,
+      .composite_overlay_rgba8 = compositeOverlayRgba8,
+      .bilinear_row_rgba8 = bilinearRowRgba8,
+      .blend_rgba8 = blendRgba8,
+      .reconstruct_interleaved_rgba8 = reconstructInterleavedRgba8,
+      .finite_min_max_f32 = finiteMinMaxF32,
+  };
+  return kernels;
+}
+
+} // namespace KERNELS_NAMESPACE
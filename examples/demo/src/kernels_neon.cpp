@@ -0,0 +1,3 @@
+#define KERNELS_NAMESPACE kernels_neon
+#define KERNELS_LEVEL SimdLevel::kNeon
+#include "kernels_impl.inl"
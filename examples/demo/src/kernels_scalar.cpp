@@ -0,0 +1,4 @@
+#define KERNELS_SCALAR 1
+#define KERNELS_NAMESPACE kernels_scalar
+#define KERNELS_LEVEL SimdLevel::kScalar
+#include "kernels_impl.inl"
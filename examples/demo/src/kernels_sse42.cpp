@@ -0,0 +1,3 @@
+#define KERNELS_NAMESPACE kernels_sse42
+#define KERNELS_LEVEL SimdLevel::kSse42
+#include "kernels_impl.inl"
@@ -1,440 +1,781 @@
-#include <array>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <climits>
 #include <cmath>
 #include <cstdio>
-#include <filesystem>
+#include <cstdlib>
+#include <cstring>
+#include <numbers>
+#include <optional>
 #include <string>
-#include <thread>
+#include <string_view>
+#include <type_traits>
 #include <utility>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <vector>
 
 #include <GLFW/glfw3.h>
 
-#define ANARI_EXTENSION_UTILITY_IMPL
 #include <anari/anari_cpp.hpp>
 #include <anari/anari_cpp/ext/std.h>
 
-constexpr int kWidth = 640;
-constexpr int kHeight = 480;
-
-using uvec2 = std::array<unsigned int, 2>;
-using uvec3 = std::array<unsigned int, 3>;
-using vec2 = std::array<float, 2>;
-using vec3 = std::array<float, 3>;
-using vec4 = std::array<float, 4>;
-using box3 = std::array<vec3, 2>;
-
-static void statusFunc(const void *userData, ANARIDevice device,
-                       ANARIObject source, ANARIDataType sourceType,
-                       ANARIStatusSeverity severity, ANARIStatusCode code,
-                       const char *message) {
-  (void)userData;
-  (void)device;
-  (void)source;
-  (void)sourceType;
-  (void)code;
-  if (severity == ANARI_SEVERITY_FATAL_ERROR) {
-    std::fprintf(stderr, "[FATAL] %s\n", message);
-  } else if (severity == ANARI_SEVERITY_ERROR) {
-    std::fprintf(stderr, "[ERROR] %s\n", message);
-  } else if (severity == ANARI_SEVERITY_WARNING) {
-    std::fprintf(stderr, "[WARN ] %s\n", message);
-  } else if (severity == ANARI_SEVERITY_PERFORMANCE_WARNING) {
-    std::fprintf(stderr, "[PERF ] %s\n", message);
-  } else if (severity == ANARI_SEVERITY_INFO) {
-    std::fprintf(stderr, "[INFO ] %s\n", message);
-  } else if (severity == ANARI_SEVERITY_DEBUG) {
-    std::fprintf(stderr, "[DEBUG] %s\n", message);
-  }
+#include "alloc_tracker.h"
+#include "anari_handle.h"
+#include "anari_pool.h"
+#include "array_memory.h"
+#include "async_loader.h"
+#include "camera_controller.h"
+#include "capture.h"
+#include "control_socket.h"
+#include "display_staging.h"
+#include "display_system.h"
+#include "flight_recorder.h"
+#include "foveation.h"
+#include "frame_counters.h"
+#include "frame_pipeline.h"
+#include "frame_telemetry.h"
+#include "frame_view.h"
+#include "headless_engine.h"
+#include "hitch_detector.h"
+#include "interleave.h"
+#include "job_system.h"
+#include "kernels.h"
+#include "math_types.h"
+#include "memory_stats.h"
+#include "metrics.h"
+#include "overlay.h"
+#include "render_system.h"
+#include "row_workers.h"
+#include "stats_hud.h"
+#include "thread_placement.h"
+#include "upload_scheduler.h"
+#include "window_wrapper.h"
+
+// Interval of memory snapshots while the viewer runs
+constexpr std::chrono::seconds kMemorySnapshotPeriod{10};
+// Resident memory shown by the HUD is refreshed this often
+constexpr std::chrono::milliseconds kHudMemoryPeriod{500};
+// The viewer camera orbits the center of the demo quad
+constexpr vec3 kOrbitTarget{0.0F, 0.0F, 3.0F};
+
+static FlightRecord makeFlightRecord(const FrameTelemetry &telemetry,
+                                     RenderSystem &rs, RenderMode mode) {
+  return {telemetry, rs.GetCameraPosition(), rs.GetCameraDirection(),
+          RenderModeName(mode)};
 }
 
-static void onFrameCompletion(const void *, anari::Device d, anari::Frame f) {
-  //std::printf("anari::Device(%p) finished rendering anari::Frame(%p)!\n", d, f);
+// Serves dumps requested by SIGUSR1 from the render loop.
+static void serveFlightRecorderRequest(const FlightRecorder &recorder) {
+  if (FlightRecorder::ConsumeDumpRequest()) {
+    if (recorder.Dump("SIGUSR1")) {
+      std::printf("Info: Flight recorder dumped to %s\n", recorder.Path());
+    } else {
+      std::printf("Error: Cannot write the flight recorder to %s\n",
+                  recorder.Path());
+    }
+  }
 }
 
-template <typename T>
-static T getPixelValue(uvec2 coord, int width, const T *buf) {
-  return buf[coord[1] * width + coord[0]];
+static const char *logLevelName(int severity) {
+  switch (severity) {
+  case ANARI_SEVERITY_FATAL_ERROR:
+    return "fatal";
+  case ANARI_SEVERITY_ERROR:
+    return "error";
+  case ANARI_SEVERITY_WARNING:
+    return "warning";
+  case ANARI_SEVERITY_PERFORMANCE_WARNING:
+    return "performance";
+  case ANARI_SEVERITY_INFO:
+    return "info";
+  case ANARI_SEVERITY_DEBUG:
+    return "debug";
+  }
+  return "unknown";
 }
 
-class ImageLoader {
-public:
-  struct Image final {
-    std::int32_t size_x{};
-    std::int32_t size_y{};
-    std::int32_t components{};
-    unsigned char* data{};
-  };
-
-  ImageLoader() = default;
-
-  ~ImageLoader() {
-    for (auto& image: images_) {
-      stbi_image_free(image.data);
+static bool parseLogLevel(const char *name, int &severity) {
+  for (const int candidate :
+       {ANARI_SEVERITY_FATAL_ERROR, ANARI_SEVERITY_ERROR,
+        ANARI_SEVERITY_WARNING, ANARI_SEVERITY_PERFORMANCE_WARNING,
+        ANARI_SEVERITY_INFO, ANARI_SEVERITY_DEBUG}) {
+    if (std::strcmp(name, logLevelName(candidate)) == 0) {
+      severity = candidate;
+      return true;
     }
   }
+  return false;
+}
 
-  ImageLoader(const ImageLoader&) = delete;
-  ImageLoader(ImageLoader&&) = delete;
-  ImageLoader& operator=(const ImageLoader&) = delete;
-  ImageLoader& operator=(ImageLoader&&) = delete;
-
-  Image Load(const std::filesystem::path path) {
-    Image image{};
-    image.data =
-        stbi_load(path.c_str(), &image.size_x, &image.size_y, &image.components, 0);
-    std::printf("Image: x=%d, y=%d, c=%d, ptr=%p\n", image.size_x, image.size_y, image.components, image.data);
-    images_.push_back(image);
-    return image;
-  }
-
-private:
-  std::vector<Image> images_{};
+// State of the viewer the control socket can change. Commands run on the
+// render loop thread between frames.
+struct ControlContext final {
+  RenderSystem &rs;
+  AsyncLoader &loader;
+  UploadScheduler &uploads;
+  FramePipeline &pipeline;
+  WindowWrapper &window;
+  bool vsync{true};
+  // Set by the capture command, served after the next frame is assembled
+  std::string capture_path{};
 };
 
-class RenderSystem {
-public:
-  RenderSystem() = default;
-
-  ~RenderSystem() {
-    if (device_ && frame_) {
-      anari::release(device_, frame_);
-    }
-    if (device_) {
-      anari::release(device_, device_);
-    }
-    if (library_) {
-      anari::unloadLibrary(library_);
-    }
+// Scene rebuilds one "rebuild" command may start
+constexpr int kMaxStreams = 64;
+
+// Numbers of control commands, the whole text must be one, so "scale abc"
+// or "4x" are rejected rather than read as 0 or 4.
+static bool parseFloat(const char *text, float &value) {
+  char *end{};
+  errno = 0;
+  const float parsed = std::strtof(text, &end);
+  if (end == text || *end != '\0' || errno != 0 || !std::isfinite(parsed)) {
+    return false;
   }
+  value = parsed;
+  return true;
+}
 
-  RenderSystem(const RenderSystem&) = delete;
-  RenderSystem(RenderSystem&&) = delete;
-  RenderSystem& operator=(const RenderSystem&) = delete;
-  RenderSystem& operator=(RenderSystem&&) = delete;
-
-  void Init() {
-    std::printf("Initializing ANARI\n");
-    std::printf("Loading a library\n");
-    library_ = anari::loadLibrary("visgl", statusFunc);
-
-    std::printf("Creating a device\n");
-    anari::Extensions extensions =
-        anari::extension::getDeviceExtensionStruct(library_, "default");
-    if (!extensions.ANARI_KHR_GEOMETRY_TRIANGLE)
-      std::printf(
-          "WARNING: device doesn't support ANARI_KHR_GEOMETRY_TRIANGLE\n");
-    if (!extensions.ANARI_KHR_CAMERA_PERSPECTIVE)
-      std::printf(
-          "WARNING: device doesn't support ANARI_KHR_CAMERA_PERSPECTIVE\n");
-    if (!extensions.ANARI_KHR_MATERIAL_MATTE)
-      std::printf("WARNING: device doesn't support ANARI_KHR_MATERIAL_MATTE\n");
-    if (!extensions.ANARI_KHR_FRAME_COMPLETION_CALLBACK) {
-      std::printf(
-          "INFO: device doesn't support ANARI_KHR_FRAME_COMPLETION_CALLBACK\n");
-    }
-    device_ = anari::newDevice(library_, "default");
+static bool parseInt(const char *text, int &value) {
+  char *end{};
+  errno = 0;
+  const long parsed = std::strtol(text, &end, 10);
+  if (end == text || *end != '\0' || errno != 0 || parsed < INT_MIN ||
+      parsed > INT_MAX) {
+    return false;
+  }
+  value = static_cast<int>(parsed);
+  return true;
+}
 
-    std::printf("Creating a renderer\n");
-    renderer_ = anari::newObject<anari::Renderer>(device_, "default");
-    anari::setParameter(device_, renderer_, "name", "MainRenderer");
-    anari::setParameter(device_, renderer_, "ambientRadiance", 1.0F);
-    anari::commitParameters(device_, renderer_);
+static constexpr const char *kControlCommands =
+    "commands: status | mode <full|foveated|interleaved> | scale <0.1-1> "
+    "| param <renderer parameter> [int|float] <value> | channel <color|depth|"
+    "primitiveId|objectId|instanceId> | pacing <vsync|free> | log <fatal|"
+    "error|warning|performance|info|debug> | capture [file.png] | threads "
+    "| objects | rebuild [count] | uploads";
+
+// Runs one line of the control protocol: a command and its arguments
+// separated by spaces. Replies start with "ok" or "error".
+static std::string runControlCommand(const std::string &line,
+                                     ControlContext &context) {
+  char command[32]{};
+  char argument[256]{};
+  char value[64]{};
+  char extra[64]{};
+  const int fields = std::sscanf(line.c_str(), "%31s %255s %63s %63s",
+                                 command, argument, value, extra);
+  if (fields < 1) {
+    return "error empty command";
   }
+  const std::string_view name{command};
+  char reply[512];
 
-  void CreateScene() {
-    std::printf("Creating a scene\n");
-
-    // image size
-    uvec2 imgSize = {kWidth, kHeight};
-
-    // camera
-    camera_position_ = {0.0F, 0.0F, 0.0F};
-    camera_up_ = {0.0F, 1.0F, 0.0F};
-    camera_direction_ = {0.0F, 0.0F, 1.0F};
-
-    // create and setup camera
-    camera_ = anari::newObject<anari::Camera>(device_, "perspective");
-    anari::setParameter(device_, camera_, "aspect",
-                        (float)imgSize[0] / (float)imgSize[1]);
-    anari::setParameter(device_, camera_, "position", camera_position_);
-    anari::setParameter(device_, camera_, "up", camera_up_);
-    anari::setParameter(device_, camera_, "direction", camera_direction_);
-    anari::commitParameters(device_, camera_);
-
-    // triangle mesh array
-    vec3 vertex[4] = {{-1.0F, -1.0F, 3.0F},
-                     {-1.0F, 1.0F, 3.0F},
-                     {1.0F, -1.0F, 3.0F},
-                     {1.0F, 1.0F, 3.0F}};
-    vec2 uv[4] = {{1.0F, 1.0F}, {1.0F, 0.0F}, {0.0F, 1.0F}, {0.0F, 0.0F}};
-    uvec3 index[2] = {{0, 1, 2}, {1, 2, 3}};
-
-    // The world to be populated with renderable objects
-    world_ = anari::newObject<anari::World>(device_);
-
-    // create and setup surface and mesh
-    auto mesh = anari::newObject<anari::Geometry>(device_, "triangle");
-    anari::setParameterArray1D(device_, mesh, "vertex.position", vertex, 4);
-    anari::setParameterArray1D(device_, mesh, "vertex.attribute0", uv, 4);
-    anari::setParameterArray1D(device_, mesh, "primitive.index", index, 2);
-    anari::commitParameters(device_, mesh);
-
-    ImageLoader il{};
-    const auto image = il.Load("data/photo.jpg");
-
-    auto sampler = anari::newObject<anari::Sampler>(device_, "image2D");
-    switch (image.components) {
-    case 3U: {
-      anari::setParameterArray2D(device_, sampler, "image", ANARI_UFIXED8_VEC3,
-                                 image.data, image.size_x, image.size_y);
-      break;
+  if (name == "help") {
+    return std::string{"ok "} + kControlCommands;
+  }
+  if (name == "status") {
+    std::snprintf(reply, sizeof(reply),
+                  "ok mode=%s scale=%.2f channel=%s pacing=%s log=%s",
+                  RenderModeName(context.window.Mode()),
+                  context.pipeline.RenderScale(),
+                  context.window.DisplayChannel(),
+                  context.vsync ? "vsync" : "free",
+                  logLevelName(AnariLogThreshold()));
+    return reply;
+  }
+  if (name == "mode" && fields >= 2) {
+    RenderMode mode{};
+    if (!ParseRenderMode(argument, mode)) {
+      return "error unknown render mode";
     }
-    case 4U: {
-      anari::setParameterArray2D(device_, sampler, "image", ANARI_UFIXED8_VEC4,
-                                 image.data, image.size_x, image.size_y);
-      break;
+    context.window.SetRenderMode(mode);
+    return "ok";
+  }
+  if (name == "scale" && fields >= 2) {
+    float scale{};
+    if (!parseFloat(argument, scale)) {
+      return "error scale is not a number";
+    }
+    context.pipeline.SetRenderScale(scale);
+    std::snprintf(reply, sizeof(reply), "ok scale=%.2f",
+                  context.pipeline.RenderScale());
+    return reply;
+  }
+  if (name == "param" && fields >= 3) {
+    // The type goes before the value, float if there is none
+    const std::string_view type = fields >= 4 ? value : "float";
+    const char *number = fields >= 4 ? extra : value;
+    if (type == "int") {
+      int parameter{};
+      if (!parseInt(number, parameter)) {
+        return "error malformed int";
+      }
+      context.rs.SetRendererParameter(argument, parameter);
+    } else if (type == "float") {
+      float parameter{};
+      if (!parseFloat(number, parameter)) {
+        return "error malformed float";
+      }
+      context.rs.SetRendererParameter(argument, parameter);
+    } else {
+      return "error parameter type is int or float";
     }
-    default: {
-      std::printf("Error: Unsupported image format, c=%d\n", image.components);
-      break;
+    return "ok";
+  }
+  if (name == "channel" && fields >= 2) {
+    return context.window.SetDisplayChannel(argument) ? "ok"
+                                                      : "error unknown channel";
+  }
+  if (name == "pacing" && fields >= 2) {
+    const std::string_view pacing{argument};
+    if (pacing != "vsync" && pacing != "free") {
+      return "error pacing is vsync or free";
     }
+    context.vsync = pacing == "vsync";
+    glfwSwapInterval(context.vsync ? 1 : 0);
+    return "ok";
+  }
+  if (name == "log" && fields >= 2) {
+    int severity{};
+    if (!parseLogLevel(argument, severity)) {
+      return "error unknown log level";
     }
-    anari::commitParameters(device_, sampler);
-
-    auto mat = anari::newObject<anari::Material>(device_, "matte");
-    anari::setParameter(device_, mat, "color", sampler);
-    anari::commitParameters(device_, mat);
-
-    // put the mesh into a surface
-    auto surface = anari::newObject<anari::Surface>(device_);
-    anari::setAndReleaseParameter(device_, surface, "geometry", mesh);
-    anari::setAndReleaseParameter(device_, surface, "material", mat);
-    anari::setParameter(device_, surface, "id", 2U);
-    anari::commitParameters(device_, surface);
-
-    // put the surface directly onto the world
-    anari::setParameterArray1D(device_, world_, "surface", &surface, 1);
-    anari::setParameter(device_, world_, "id", 3U);
-    anari::release(device_, surface);
-
-    anari::commitParameters(device_, world_);
+    SetAnariLogThreshold(severity);
+    return "ok";
   }
-
-  void SetupFrame() {
-    std::printf("Setuping frame\n");
-
-    frame_ = anari::newObject<anari::Frame>(device_);
-    anari::setAndReleaseParameter(device_, frame_, "renderer", renderer_);
-    anari::setAndReleaseParameter(device_, frame_, "camera", camera_);
-    anari::setAndReleaseParameter(device_, frame_, "world", world_);
-    anari::setParameter(device_, frame_, "frameCompletionCallback",
-                        (anari::FrameCompletionCallback)onFrameCompletion);
-    anari::setParameter(device_, frame_, "channel.color",
-                        ANARI_UFIXED8_RGBA_SRGB);
-    anari::setParameter(device_, frame_, "channel.primitiveId", ANARI_UINT32);
-    anari::setParameter(device_, frame_, "channel.objectId", ANARI_UINT32);
-    anari::setParameter(device_, frame_, "channel.instanceId", ANARI_UINT32);
-    anari::commitParameters(device_, frame_);
+  if (name == "threads") {
+    std::string threads{"ok"};
+    for (const ThreadReport &report : ThreadPlacementReport()) {
+      std::snprintf(reply, sizeof(reply),
+                    " %s/%u:cpu=%d,node=%d,cpus=%s,%s=%d",
+                    ThreadRoleName(report.role), report.index, report.cpu,
+                    report.numa_node, report.allowed_cpus.c_str(),
+                    report.policy, report.priority);
+      threads += reply;
+    }
+    return threads;
   }
-
-  vec3 GetCameraPosition() { return camera_position_; }
-  vec3 GetCameraUp() { return camera_up_; }
-  vec3 GetCameraDirection() { return camera_direction_; }
-
-  void UpdateCamera(vec3 pos, vec3 up, vec3 dir) {
-    camera_position_ = pos;
-    camera_up_ = up;
-    camera_direction_ = dir;
-    anari::setParameter(device_, camera_, "position", camera_position_);
-    anari::setParameter(device_, camera_, "up", camera_up_);
-    anari::setParameter(device_, camera_, "direction", camera_direction_);
-    anari::commitParameters(device_, camera_);
+  if (name == "objects") {
+    std::string objects{"ok"};
+    for (const AnariObjectCount &count : GetAnariObjectCounts()) {
+      std::snprintf(reply, sizeof(reply), " %s:live=%lld,created=%llu",
+                    count.type, static_cast<long long>(count.live),
+                    static_cast<unsigned long long>(count.created));
+      objects += reply;
+    }
+    return objects;
   }
-
-  uvec2 GetFrameSize() { return frame_size_; }
-
-  void UpdateFrameSize(uvec2 size) {
-    frame_size_ = size;
-    anari::setParameter(device_, frame_, "size", frame_size_);
-    anari::commitParameters(device_, frame_);
+  if (name == "rebuild") {
+    int count{1};
+    if ((fields >= 2 && !parseInt(argument, count)) || count < 1 ||
+        count > kMaxStreams) {
+      return "error rebuild count is 1 to " + std::to_string(kMaxStreams);
+    }
+    for (int i = 0; i < count; ++i) {
+      context.rs.StartStream(context.loader, context.uploads);
+    }
+    const AnariPool::Stats pool = context.rs.Pool().Totals();
+    std::snprintf(reply, sizeof(reply),
+                  "ok streams=%zu pool hits=%llu misses=%llu idle=%zu",
+                  context.rs.Streams(),
+                  static_cast<unsigned long long>(pool.hits),
+                  static_cast<unsigned long long>(pool.misses), pool.idle);
+    return reply;
   }
-
-  void RenderFrame() {
-    anari::render(device_, frame_);
-    anari::wait(device_, frame_);
+  if (name == "uploads") {
+    const UploadScheduler::Stats uploads = context.uploads.GetStats();
+    const UploadScheduler::DrainEstimate drain =
+        context.uploads.EstimateDrain();
+    std::snprintf(reply, sizeof(reply),
+                  "ok queued=%zu bytes=%llu commits=%llu drain_frames=%llu "
+                  "drain_s=%.3f applied=%llu deferred=%llu",
+                  uploads.queued,
+                  static_cast<unsigned long long>(uploads.queued_bytes),
+                  static_cast<unsigned long long>(uploads.queued_commits),
+                  static_cast<unsigned long long>(drain.frames), drain.seconds,
+                  static_cast<unsigned long long>(uploads.applied),
+                  static_cast<unsigned long long>(uploads.deferred));
+    return reply;
   }
-
-  anari::MappedFrameData<uint32_t> MapFrame() {
-    return anari::map<uint32_t>(device_, frame_, "channel.color");
+  if (name == "capture") {
+    context.capture_path = fields >= 2 ? argument : "demo_capture.png";
+    return "ok capturing the next frame to " + context.capture_path;
   }
+  return std::string{"error unknown command or missing argument, "} +
+         kControlCommands;
+}
 
-  void UnmapFrame() { anari::unmap(device_, frame_, "channel.color"); }
-
-private:
-  anari::Library library_{};
-  anari::Device device_{};
-  anari::Renderer renderer_{};
-
-  anari::World world_{};
-
-  vec3 camera_position_{};
-  vec3 camera_direction_{};
-  vec3 camera_up_{};
-  anari::Camera camera_{};
-
-  uvec2 frame_size_{kWidth, kHeight};
-  anari::Frame frame_{};
+struct AppOptions final {
+  // Runs a fixed number of frames without a window and reports latency and
+  // quality instead of opening the viewer
+  bool benchmark{};
+  int frames{120};
+  uvec2 size{kDefaultFrameSize};
+  RenderMode render_mode{RenderMode::kFull};
+  // Fails with a non-zero exit code if a steady-state frame allocates, see
+  // FrameAllocMonitor
+  bool assert_zero_alloc{};
+  // Frames longer than this multiple of the rolling median are reported as
+  // hitches, see HitchDetector
+  float hitch_factor{3.0F};
+  // Where the flight recorder is dumped, see FlightRecorder
+  const char *flight_recorder_path{"demo_flight_recorder.txt"};
+  // Port of the Prometheus endpoint on 127.0.0.1, 0 disables it
+  std::uint16_t metrics_port{};
+  // Path of the UNIX control socket, none if empty
+  const char *control_socket_path{""};
+  // ANARI library, the default of the mode if null
+  const char *library{};
+  EngineOptions engine{};
+  // NUMA node of large ANARI arrays, the first touch decides if unset
+  std::optional<unsigned> array_numa_node{};
+  // Bytes and commits of streamed scene objects applied per frame
+  UploadScheduler::Budget upload_budget{};
 };
 
-class WindowWrapper {
-public:
-  WindowWrapper(GLFWwindow *window) : window_{window} {}
+static void printUsage() {
+  std::printf(
+      "Usage: demo [options]\n"
+      "  --render-mode <full|foveated|interleaved>  initial render mode\n"
+      "  --benchmark           render without a window and report latency\n"
+      "                        and quality against full resolution\n"
+      "  --frames <n>          benchmark frame count (default 120)\n"
+      "  --size <w>x<h>        benchmark frame size (default 640x480)\n"
+      "  --assert-zero-alloc   fail if the steady-state render loop\n"
+      "                        allocates\n"
+      "  --hitch-factor <k>    report frames slower than k times the\n"
+      "                        rolling median (default 3)\n"
+      "  --flight-recorder <file>  where the last frames are dumped on\n"
+      "                        SIGUSR1, fatal errors and crashes\n"
+      "                        (default demo_flight_recorder.txt)\n"
+      "  --metrics-port <port> serve Prometheus metrics on\n"
+      "                        127.0.0.1:<port>/metrics\n"
+      "  --control-socket <path>  accept runtime commands on a UNIX\n"
+      "                        socket, send \"help\" for the list\n"
+      "  --library <name>      ANARI library (default visgl)\n"
+      "  --array-numa-node <n> place large ANARI arrays on NUMA node <n>,\n"
+      "                        the node the device renders on\n"
+      "  --upload-budget <MiB> bytes of streamed scene objects uploaded per\n"
+      "                        frame (default 8)\n"
+      "  --upload-commits <n>  ANARI commits of streamed scene objects per\n"
+      "                        frame (default 16)\n");
+  PrintEngineUsage();
+}
 
-  ~WindowWrapper() {
-    if (window_ != nullptr) {
-      glfwDestroyWindow(window_);
+static bool parseOptions(int argc, const char **argv, AppOptions &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (std::strcmp(arg, "--benchmark") == 0) {
+      options.benchmark = true;
+    } else if (ParseEngineOption(arg, value, options.engine)) {
+      ++i;
+    } else if (std::strcmp(arg, "--array-numa-node") == 0 &&
+               value != nullptr &&
+               ParseNumaNode(value, options.array_numa_node)) {
+      ++i;
+    } else if (std::strcmp(arg, "--upload-budget") == 0 && value != nullptr &&
+               std::atof(value) > 0.0) {
+      options.upload_budget.bytes =
+          static_cast<std::uint64_t>(std::atof(value) * 1024.0 * 1024.0);
+      ++i;
+    } else if (std::strcmp(arg, "--upload-commits") == 0 &&
+               value != nullptr && std::atoi(value) > 0) {
+      options.upload_budget.commits =
+          static_cast<std::uint32_t>(std::atoi(value));
+      ++i;
+    } else if (std::strcmp(arg, "--library") == 0 && value != nullptr) {
+      options.library = value;
+      ++i;
+    } else if (std::strcmp(arg, "--assert-zero-alloc") == 0) {
+      options.assert_zero_alloc = true;
+    } else if (std::strcmp(arg, "--frames") == 0 && value != nullptr) {
+      options.frames = std::max(1, std::atoi(value));
+      ++i;
+    } else if (std::strcmp(arg, "--hitch-factor") == 0 && value != nullptr &&
+               std::atof(value) > 1.0) {
+      options.hitch_factor = static_cast<float>(std::atof(value));
+      ++i;
+    } else if (std::strcmp(arg, "--flight-recorder") == 0 && value != nullptr) {
+      options.flight_recorder_path = value;
+      ++i;
+    } else if (std::strcmp(arg, "--metrics-port") == 0 && value != nullptr &&
+               std::atoi(value) > 0 && std::atoi(value) < 65536) {
+      options.metrics_port = static_cast<std::uint16_t>(std::atoi(value));
+      ++i;
+    } else if (std::strcmp(arg, "--control-socket") == 0 && value != nullptr) {
+      options.control_socket_path = value;
+      ++i;
+    } else if (std::strcmp(arg, "--size") == 0 && value != nullptr &&
+               std::sscanf(value, "%ux%u", &options.size[0],
+                           &options.size[1]) == 2 &&
+               options.size[0] > 0 && options.size[1] > 0) {
+      ++i;
+    } else if (std::strcmp(arg, "--render-mode") == 0 && value != nullptr &&
+               ParseRenderMode(value, options.render_mode)) {
+      ++i;
+    } else {
+      std::printf("Error: Unknown or invalid option %s\n", arg);
+      printUsage();
+      return false;
     }
   }
+  return true;
+}
 
-  WindowWrapper(const WindowWrapper&) = delete;
-  WindowWrapper(WindowWrapper&&) = delete;
-  WindowWrapper& operator=(const WindowWrapper&) = delete;
-  WindowWrapper& operator=(WindowWrapper&&) = delete;
-
-  GLFWwindow *Window() { return window_; }
-
-  void HandleKey(int key, int scancode, int action, int mods) {
-    if (action == GLFW_PRESS) {
-      switch (key) {
-      case GLFW_KEY_ESCAPE: {
-        std::printf("Key: Window should close\n");
-        glfwSetWindowShouldClose(window_, GL_TRUE);
-        break;
-      }
-      case GLFW_KEY_A: {
-        std::printf("Key: Left\n");
-        break;
-      }
-      case GLFW_KEY_D: {
-        std::printf("Key: Right\n");
-        break;
-      }
-      default:
-        std::printf("Key: Unknown input\n");
-        break;
-      }
+static int runBenchmark(const AppOptions &options) {
+  std::printf("Benchmark: mode=%s size=%ux%u frames=%d\n",
+              RenderModeName(options.render_mode), options.size[0],
+              options.size[1], options.frames);
+
+  // Large, keep it off the stack
+  auto flight_recorder =
+      std::make_unique<FlightRecorder>(options.flight_recorder_path);
+  flight_recorder->Install();
+
+  HeadlessEngine engine{
+      options.engine,
+      options.library != nullptr ? options.library : kDefaultLibrary,
+      options.array_numa_node};
+  RenderSystem &rs = engine.rs;
+  FramePipeline &pipeline = engine.pipeline;
+  rs.SetFrameEnabled(FrameSlot::kReference, true);
+  rs.UpdateFrameSize(options.size, FrameSlot::kReference);
+  DisplayStaging reference{&engine.row_workers};
+  const vec2 center{static_cast<float>(options.size[0]) * 0.5F,
+                    static_cast<float>(options.size[1]) * 0.5F};
+  const Kernels &kernels = GetKernels();
+
+  FrameAllocMonitor alloc_monitor{};
+  FrameStageTimer stage_timer{};
+  FrameCounters frame_counters{};
+  HitchDetector hitch_detector{options.hitch_factor};
+  std::vector<double> latencies_ms{};
+  latencies_ms.reserve(static_cast<std::size_t>(options.frames));
+  double abs_diff{};
+  double sq_diff{};
+  double compared_bytes{};
+  for (int i = 0; i < options.frames; ++i) {
+    // Fixed time step keeps the camera path identical between runs
+    const float time = static_cast<float>(i) / 60.0F;
+
+    alloc_monitor.BeginFrame();
+    FrameTelemetry telemetry{.frame = static_cast<std::uint64_t>(i),
+                             .width = options.size[0],
+                             .height = options.size[1]};
+    frame_counters.Begin(rs);
+    stage_timer.Begin();
+    pipeline.Prepare(options.render_mode, options.size, center);
+    stage_timer.Mark(FrameStage::kPrepare, telemetry);
+    rs.AnimateCamera(time);
+    stage_timer.Mark(FrameStage::kCamera, telemetry);
+    rs.RenderFrame();
+    stage_timer.Mark(FrameStage::kRender, telemetry);
+    const auto image = pipeline.Assemble("channel.color", nullptr);
+    stage_timer.Mark(FrameStage::kAssemble, telemetry);
+    latencies_ms.push_back(telemetry.total_ms);
+    alloc_monitor.EndFrame();
+    frame_counters.End(rs, telemetry);
+    hitch_detector.Check(telemetry);
+    flight_recorder->Record(
+        makeFlightRecord(telemetry, rs, options.render_mode));
+    serveFlightRecorderRequest(*flight_recorder);
+
+    // Full resolution reference of the same view, not timed
+    rs.RenderFrame(FrameSlot::kReference);
+    const bool converted = reference.Convert(
+        rs.MapChannel("channel.color", FrameSlot::kReference), false);
+    rs.UnmapChannel("channel.color", FrameSlot::kReference);
+    if (converted && image.Width() == reference.Width() &&
+        image.Height() == reference.Height() && image.Contiguous()) {
+      const auto *a = reinterpret_cast<const std::uint8_t *>(image.Data());
+      const auto *b = reinterpret_cast<const std::uint8_t *>(reference.Pixels());
+      const std::size_t bytes =
+          static_cast<std::size_t>(image.Width()) * image.Height() * 4;
+      abs_diff += static_cast<double>(kernels.sum_abs_diff_u8(a, b, bytes));
+      sq_diff += static_cast<double>(kernels.sum_sq_diff_u8(a, b, bytes));
+      compared_bytes += static_cast<double>(bytes);
     }
   }
 
-private:
-  GLFWwindow *window_;
-};
-
-class DisplaySystem {
-public:
-  DisplaySystem() { glfwInit(); }
-
-  ~DisplaySystem() { glfwTerminate(); }
-
-  void CreateWindow() {
-    std::printf("Info: Creating a window\n");
-    auto window = glfwCreateWindow(kWidth, kHeight, "glfw3-window", NULL, NULL);
-    if (window == nullptr) {
-      const char *error_str{};
-      glfwGetError(&error_str);
-      std::printf("Error: Cannot create a window, err=%s\n", error_str);
-    }
-
-    glfwMakeContextCurrent(window);
-
-    window_wrapper_ = std::make_unique<WindowWrapper>(window);
-    glfwSetWindowUserPointer(window, window_wrapper_.get());
-    auto key_callback = [](GLFWwindow *w, int key, int scancode, int action,
-                           int mods) {
-      static_cast<WindowWrapper *>(glfwGetWindowUserPointer(w))
-          ->HandleKey(key, scancode, action, mods);
-    };
-    glfwSetKeyCallback(window, key_callback);
+  std::sort(latencies_ms.begin(), latencies_ms.end());
+  double mean{};
+  for (const double latency : latencies_ms) {
+    mean += latency;
   }
-
-  GLFWwindow *Window() { return window_wrapper_->Window(); }
-
-private:
-  std::unique_ptr<WindowWrapper> window_wrapper_{nullptr};
-};
+  mean /= static_cast<double>(latencies_ms.size());
+  const double median = latencies_ms[latencies_ms.size() / 2];
+  const double p95 = latencies_ms[latencies_ms.size() * 95 / 100];
+  std::printf("  latency ms: mean=%.3f median=%.3f p95=%.3f max=%.3f\n", mean,
+              median, p95, latencies_ms.back());
+  if (compared_bytes > 0.0) {
+    // Over RGBA bytes against the full resolution reference
+    const double mse = sq_diff / compared_bytes;
+    const double psnr =
+        mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+    std::printf("  quality vs full resolution: mae=%.4f psnr=%.2f dB\n",
+                abs_diff / compared_bytes, psnr);
+  } else {
+    std::printf("  quality vs full resolution: not available\n");
+  }
+  std::printf("  hitches over %.1fx the median: %llu\n",
+              hitch_detector.Factor(),
+              static_cast<unsigned long long>(hitch_detector.Hitches()));
+  PrintMemorySnapshot("benchmark", rs.Arrays(), false);
+  alloc_monitor.Report();
+  if (options.assert_zero_alloc && alloc_monitor.AllocatingFrames() > 0) {
+    std::printf("Error: The steady-state render loop allocates\n");
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
 
 int main(int argc, const char **argv) {
-  (void)argc;
-  (void)argv;
+  // Everything not attributed to another subsystem below is ours
+  AllocScope app_scope{AllocSubsystem::kApp};
+
+  AppOptions options{};
+  if (!parseOptions(argc, argv, options)) {
+    return EXIT_FAILURE;
+  }
 
   std::printf("Starting the app\n");
+  std::printf("Info: Using %s SIMD kernels\n",
+              SimdLevelName(GetKernels().level));
+  SetThreadPlacements(options.engine.thread_placements);
+
+  if (options.benchmark) {
+    return runBenchmark(options);
+  }
 
   DisplaySystem ds{};
   ds.CreateWindow();
-
+  ds.Wrapper().SetRenderMode(options.render_mode);
+
+  RowWorkers row_workers{DefaultRowHelpers()};
+
+  // Host-side overlays for the demo scene, toggled with G, X and M
+  OverlayRenderer overlay{};
+  overlay.SetGrid({.center = {0.0F, -1.5F, 3.0F}});
+  overlay.SetGizmo({0.0F, 0.0F, 3.0F}, 0.75F);
+  ds.Wrapper().SetOverlay(&overlay);
+
+  // Frame statistics, toggled with H
+  StatsHud hud{};
+  ds.Wrapper().SetHud(&hud);
+  HudInfo hud_info{};
+  auto next_hud_memory = std::chrono::steady_clock::time_point{};
+
+  // Before the device is up, so fatal errors and crashes during setup are
+  // dumped too. Large, keep it off the stack.
+  auto flight_recorder =
+      std::make_unique<FlightRecorder>(options.flight_recorder_path);
+  flight_recorder->Install();
+
+  JobSystem jobs{options.engine.JobWorkers()};
+  AsyncLoader loader{jobs};
+  UploadScheduler uploads{options.upload_budget};
   RenderSystem rs{};
-  rs.Init();
-  rs.CreateScene();
-  rs.SetupFrame();
+  SetupRenderSystem(
+      rs, loader,
+      options.library != nullptr ? options.library : kDefaultLibrary,
+      options.array_numa_node);
+  // After the device is up, its threads keep the default placement
+  ThreadPlacementScope main_placement{ThreadRole::kMain, 0};
+  PrintThreadPlacement();
+
+  FramePipeline pipeline{rs, row_workers};
+
+  CameraController camera{rs.GetCameraPosition(), kOrbitTarget};
+  ds.Wrapper().SetCameraController(&camera);
+
+  FrameAllocMonitor alloc_monitor{};
+  FrameStageTimer stage_timer{};
+  FrameCounters frame_counters{};
+  HitchDetector hitch_detector{options.hitch_factor};
+  MetricsRegistry metrics{};
+  metrics.SetAnariArrayBytes(rs.Arrays().TotalBytes());
+  metrics.SetUploadScheduler(&uploads);
+  MetricsServer metrics_server{metrics};
+  if (options.metrics_port != 0) {
+    metrics_server.Start(options.metrics_port);
+  }
+  glfwSwapInterval(1);
+  ControlContext control{rs, loader, uploads, pipeline, ds.Wrapper()};
+  ControlSocket control_socket{};
+  if (options.control_socket_path[0] != '\0') {
+    control_socket.Start(options.control_socket_path);
+  }
+  std::uint64_t frame_index{};
+  uvec2 last_frame_size{};
+  RenderMode last_mode{pipeline.Mode()};
+  float last_render_scale{pipeline.RenderScale()};
 
   // Render loop
   const auto start_time = std::chrono::steady_clock::now();
+  auto next_memory_snapshot = start_time + kMemorySnapshotPeriod;
+  auto last_frame_start = start_time;
   while (!glfwWindowShouldClose(ds.Window())) {
-    const float time{std::chrono::duration_cast<std::chrono::duration<float>>(
-                         std::chrono::steady_clock::now() - start_time)
-                         .count()};
-
-    // Handle window resizing
+    alloc_monitor.BeginFrame();
+    FrameTelemetry telemetry{.frame = frame_index++};
+    frame_counters.Begin(rs);
+    stage_timer.Begin();
+    const auto frame_start = std::chrono::steady_clock::now();
+    const float frame_seconds =
+        std::chrono::duration<float>(frame_start - last_frame_start).count();
+    last_frame_start = frame_start;
+
+    // Handle window resizing and the render mode
     int width, height;
     glfwGetFramebufferSize(ds.Window(), &width, &height);
     uvec2 frame_size{static_cast<uint32_t>(width),
                      static_cast<uint32_t>(height)};
-    rs.UpdateFrameSize(frame_size);
-
-    // Update camera
-    auto camera_pos = rs.GetCameraPosition();
-    auto camera_up = rs.GetCameraUp();
-    auto camera_dir = rs.GetCameraDirection();
-    camera_pos[1] = std::sin(time);
-    rs.UpdateCamera(camera_pos, camera_up, camera_dir);
+    const bool controlled =
+        control_socket.Poll([&](const std::string &line) {
+          return runControlCommand(line, control);
+        });
+    // Objects of streamed scenes, as many as the upload budget allows
+    const bool uploaded = uploads.RunFrame() > 0;
+    rs.PollStreams();
+    if (controlled || uploaded) {
+      metrics.SetAnariArrayBytes(rs.Arrays().TotalBytes());
+      const AnariPool::Stats pool = rs.Pool().Totals();
+      metrics.SetAnariPool(pool.hits, pool.misses, pool.idle);
+    }
+    pipeline.Prepare(ds.Wrapper().Mode(), frame_size,
+                     ds.Wrapper().FocusCenter(frame_size));
+    if (frame_size != last_frame_size || pipeline.Mode() != last_mode ||
+        pipeline.RenderScale() != last_render_scale) {
+      // Not steady state, buffers follow the new frame sizes
+      alloc_monitor.Rewarm();
+      last_frame_size = frame_size;
+      last_mode = pipeline.Mode();
+      last_render_scale = pipeline.RenderScale();
+    }
+    telemetry.width = frame_size[0];
+    telemetry.height = frame_size[1];
+    stage_timer.Mark(FrameStage::kPrepare, telemetry);
+
+    // The input events of the frame, at most one camera update
+    if (camera.Update(frame_seconds)) {
+      const CameraController::Pose &pose = camera.GetPose();
+      rs.UpdateCamera(pose.position, pose.up, pose.direction);
+    }
+    stage_timer.Mark(FrameStage::kCamera, telemetry);
 
     // Render frame
     rs.RenderFrame();
+    stage_timer.Mark(FrameStage::kRender, telemetry);
+
+    // Map rendered frames and assemble the displayed image
+    const auto image =
+        pipeline.Assemble(ds.Wrapper().DisplayChannel(), &overlay);
+    stage_timer.Mark(FrameStage::kAssemble, telemetry);
 
-    // Map rendered frame
-    auto fb = rs.MapFrame();
     glViewport(0, 0, width, height);
     glClearColor(0.3F, 0.3F, 0.3F, 1.0F);
     glClear(GL_COLOR_BUFFER_BIT);
-    glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, fb.data);
+    if (!image.Empty()) {
+      // Frames rendered below display resolution are scaled up
+      glPixelZoom(static_cast<float>(width) / image.Width(),
+                  static_cast<float>(height) / image.Height());
+      glDrawPixels(static_cast<GLsizei>(image.Width()),
+                   static_cast<GLsizei>(image.Height()), GL_RGBA,
+                   GL_UNSIGNED_BYTE, image.Data());
+    }
+    if (hud.Visible()) {
+      hud_info.mode = RenderModeName(pipeline.Mode());
+      hud_info.render_scale = pipeline.RenderScale();
+      hud_info.display_width = frame_size[0];
+      hud_info.display_height = frame_size[1];
+      hud_info.anari_array_bytes = rs.Arrays().TotalBytes();
+      hud_info.frames_in_flight = rs.FrameEnabled(FrameSlot::kFocus) ? 2 : 1;
+      hud_info.row_threads = row_workers.Concurrency();
+      hud_info.pending_commands = control_socket.Pending() ? 1 : 0;
+      hud_info.hitches = hitch_detector.Hitches();
+      // Reading /proc every frame would cost more than the HUD itself
+      const auto now = std::chrono::steady_clock::now();
+      if (now >= next_hud_memory) {
+        hud_info.rss_bytes = ReadProcessMemory().rss_bytes;
+        next_hud_memory = now + kHudMemoryPeriod;
+      }
+      hud.Draw(hud_info);
+
+      // Top-left corner, unscaled, blended by the alpha of the panel. In a
+      // window shorter than the panel it starts at the bottom edge instead:
+      // a raster position outside of the viewport is invalid and nothing
+      // would be drawn.
+      const auto panel = hud.View();
+      glPixelZoom(1.0F, 1.0F);
+      const float panel_bottom =
+          1.0F - 2.0F * static_cast<float>(panel.Height()) /
+                     static_cast<float>(std::max(height, 1));
+      glRasterPos2f(-1.0F, std::max(panel_bottom, -1.0F));
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glDrawPixels(static_cast<GLsizei>(panel.Width()),
+                   static_cast<GLsizei>(panel.Height()), GL_RGBA,
+                   GL_UNSIGNED_BYTE, panel.Data());
+      glDisable(GL_BLEND);
+      glRasterPos2f(-1.0F, -1.0F);
+    }
+    if (!control.capture_path.empty()) {
+      if (WriteCapturePng(control.capture_path.c_str(), image)) {
+        std::printf("Info: Captured the frame to %s\n",
+                    control.capture_path.c_str());
+      } else {
+        std::printf("Error: Cannot capture the frame to %s\n",
+                    control.capture_path.c_str());
+      }
+      control.capture_path.clear();
+    }
     glfwSwapBuffers(ds.Window());
-    rs.UnmapFrame();
-
-    // Check center pixel id buffers
-    // auto fbPrimId = anari::map<uint32_t>(d, frame, "channel.primitiveId");
-    // auto fbObjId = anari::map<uint32_t>(d, frame, "channel.objectId");
-    // auto fbInstId = anari::map<uint32_t>(d, frame, "channel.instanceId");
-    // uvec2 queryPixel = {imgSize[0] / 2, imgSize[1] / 2};
-    // std::printf("checking id buffers @ [%u, %u]:\n", queryPixel[0],
-    //            queryPixel[1]);
-    // if (fbPrimId.pixelType == ANARI_UINT32) {
-    //  std::printf("    primId: %u\n",
-    //              getPixelValue(queryPixel, imgSize[0], fbPrimId.data));
-    //}
-    // if (fbObjId.pixelType == ANARI_UINT32) {
-    //  std::printf("     objId: %u\n",
-    //              getPixelValue(queryPixel, imgSize[0], fbObjId.data));
-    //}
-    // if (fbPrimId.pixelType == ANARI_UINT32) {
-    //  std::printf("    instId: %u\n",
-    //              getPixelValue(queryPixel, imgSize[0], fbInstId.data));
-    //}
+    stage_timer.Mark(FrameStage::kPresent, telemetry);
+
+    // Check center pixel id buffers. Requested by a key press, the time
+    // counts towards the events stage.
+    if (ds.Wrapper().ConsumePickRequest()) {
+      const uvec2 query_pixel{frame_size[0] / 2, frame_size[1] / 2};
+      const auto pick = rs.Pick(query_pixel, frame_size);
+      std::printf("checking id buffers @ [%u, %u]:\n", query_pixel[0],
+                  query_pixel[1]);
+      if (pick.hit) {
+        std::printf("    primId: %u\n", pick.primitive_id);
+        std::printf("     objId: %u\n", pick.object_id);
+        std::printf("    instId: %u\n", pick.instance_id);
+      } else {
+        std::printf("    background\n");
+      }
+    }
 
     glfwPollEvents();
+    stage_timer.Mark(FrameStage::kEvents, telemetry);
+    alloc_monitor.EndFrame();
+    frame_counters.End(rs, telemetry);
+    const bool hitch = hitch_detector.Check(telemetry);
+    metrics.RecordFrame(telemetry, hitch);
+    hud.Record(telemetry);
+    flight_recorder->Record(
+        makeFlightRecord(telemetry, rs, pipeline.Mode()));
+    serveFlightRecorderRequest(*flight_recorder);
+
+    if (std::chrono::steady_clock::now() >= next_memory_snapshot) {
+      PrintMemorySnapshot("render-loop", rs.Arrays(), false);
+      next_memory_snapshot += kMemorySnapshotPeriod;
+    }
   }
 
+  rs.FinishStreams(uploads);
+  const CameraController::Stats camera_stats = camera.GetStats();
+  std::printf("Info: Camera input: %llu events in %llu updates\n",
+              static_cast<unsigned long long>(camera_stats.events),
+              static_cast<unsigned long long>(camera_stats.updates));
+  alloc_monitor.Report();
+  if (options.assert_zero_alloc && alloc_monitor.AllocatingFrames() > 0) {
+    std::printf("Error: The steady-state render loop allocates\n");
+    return EXIT_FAILURE;
+  }
   return 0;
 }
\ No newline at end of file
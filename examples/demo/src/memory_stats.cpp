@@ -0,0 +1,69 @@
+#include "memory_stats.h"
+
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+static double mebibytes(std::uint64_t bytes) {
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+ProcessMemory ReadProcessMemory() {
+  ProcessMemory memory{};
+#ifdef __linux__
+  // VmRSS and VmHWM (peak) in kB
+  if (std::FILE *status = std::fopen("/proc/self/status", "r")) {
+    char line[256];
+    while (std::fgets(line, sizeof(line), status) != nullptr) {
+      unsigned long long kilobytes{};
+      if (std::sscanf(line, "VmRSS: %llu kB", &kilobytes) == 1) {
+        memory.rss_bytes = kilobytes * 1024;
+      } else if (std::sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1) {
+        memory.peak_rss_bytes = kilobytes * 1024;
+      }
+    }
+    std::fclose(status);
+  }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+  if (memory.peak_rss_bytes == 0) {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+      memory.peak_rss_bytes = static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+      memory.peak_rss_bytes = static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+  }
+#endif
+  return memory;
+}
+
+void ArrayAccounting::Add(const char *object, const char *parameter,
+                          std::uint64_t elements, std::uint64_t bytes) {
+  entries_.push_back({object, parameter, elements, bytes});
+  total_bytes_ += bytes;
+}
+
+void PrintMemorySnapshot(const char *phase, const ArrayAccounting &arrays,
+                         bool per_array) {
+  const ProcessMemory memory = ReadProcessMemory();
+  std::printf("Memory: %-12s rss=%.1f MiB peak_rss=%.1f MiB "
+              "anari_arrays=%llu bytes in %zu arrays\n",
+              phase, mebibytes(memory.rss_bytes),
+              mebibytes(memory.peak_rss_bytes),
+              static_cast<unsigned long long>(arrays.TotalBytes()),
+              arrays.Entries().size());
+  if (!per_array) {
+    return;
+  }
+  for (const auto &entry : arrays.Entries()) {
+    std::printf("Memory:   %s.%s: %llu elements, %llu bytes\n",
+                entry.object.c_str(), entry.parameter.c_str(),
+                static_cast<unsigned long long>(entry.elements),
+                static_cast<unsigned long long>(entry.bytes));
+  }
+}
@@ -0,0 +1,343 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define ANARI_PROJECT_HAS_SOCKETS 1
+#endif
+
+#ifndef MSG_NOSIGNAL
+// SIGPIPE is ignored per socket on platforms without the flag
+#define MSG_NOSIGNAL 0
+#endif
+
+#include "alloc_tracker.h"
+#include "memory_stats.h"
+#include "upload_scheduler.h"
+
+static void appendf(std::string &out, const char *format, ...) {
+  char line[512];
+  va_list args;
+  va_start(args, format);
+  const int size = std::vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (size > 0) {
+    out.append(line, std::min(static_cast<std::size_t>(size),
+                              sizeof(line) - 1));
+  }
+}
+
+static void appendHeader(std::string &out, const char *name, const char *type,
+                         const char *help) {
+  appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void LatencyHistogram::Render(std::string &out, const char *name,
+                              const char *labels) const {
+  const char *separator = labels[0] != '\0' ? "," : "";
+  std::uint64_t cumulative{};
+  for (std::size_t i = 0; i < kBucketsMs.size(); ++i) {
+    cumulative += counts_[i];
+    appendf(out, "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, separator,
+            kBucketsMs[i] / 1000.0,
+            static_cast<unsigned long long>(cumulative));
+  }
+  appendf(out, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, separator,
+          static_cast<unsigned long long>(count_));
+  const char *open_brace = labels[0] != '\0' ? "{" : "";
+  const char *close_brace = labels[0] != '\0' ? "}" : "";
+  appendf(out, "%s_sum%s%s%s %.6f\n", name, open_brace, labels, close_brace,
+          sum_ms_ / 1000.0);
+  appendf(out, "%s_count%s%s%s %llu\n", name, open_brace, labels, close_brace,
+          static_cast<unsigned long long>(count_));
+}
+
+void MetricsRegistry::RecordFrame(const FrameTelemetry &telemetry,
+                                  bool hitch) {
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard lock{mutex_};
+  ++frames_;
+  hitches_ += hitch ? 1 : 0;
+  anari_commits_ += telemetry.commits;
+  anari_releases_ += telemetry.releases;
+  frame_histogram_.Observe(telemetry.total_ms);
+  for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+    stage_histograms_[stage].Observe(telemetry.stage_ms[stage]);
+  }
+
+  // Frame rate over the last second or so
+  if (rate_frames_ == 0) {
+    rate_start_ = now;
+  }
+  ++rate_frames_;
+  const double elapsed =
+      std::chrono::duration<double>(now - rate_start_).count();
+  if (elapsed >= 1.0) {
+    frame_rate_ = static_cast<double>(rate_frames_ - 1) / elapsed;
+    rate_frames_ = 1;
+    rate_start_ = now;
+  }
+}
+
+void MetricsRegistry::SetAnariArrayBytes(std::uint64_t bytes) {
+  std::lock_guard lock{mutex_};
+  anari_array_bytes_ = bytes;
+}
+
+void MetricsRegistry::SetAnariPool(std::uint64_t hits, std::uint64_t misses,
+                                   std::uint64_t idle) {
+  std::lock_guard lock{mutex_};
+  anari_pool_hits_ = hits;
+  anari_pool_misses_ = misses;
+  anari_pool_idle_ = idle;
+}
+
+void MetricsRegistry::SetUploadScheduler(const UploadScheduler *uploads) {
+  uploads_ = uploads;
+}
+
+std::string MetricsRegistry::Render() const {
+  std::string out{};
+  out.reserve(16 * 1024);
+  {
+    std::lock_guard lock{mutex_};
+    appendHeader(out, "demo_frames_total", "counter", "Frames rendered.");
+    appendf(out, "demo_frames_total %llu\n",
+            static_cast<unsigned long long>(frames_));
+    appendHeader(out, "demo_frame_rate", "gauge",
+                 "Frames per second over the last second.");
+    appendf(out, "demo_frame_rate %.3f\n", frame_rate_);
+    appendHeader(out, "demo_frame_hitches_total", "counter",
+                 "Frames flagged by the hitch detector.");
+    appendf(out, "demo_frame_hitches_total %llu\n",
+            static_cast<unsigned long long>(hitches_));
+
+    appendHeader(out, "demo_frame_seconds", "histogram",
+                 "Wall time of render loop iterations.");
+    frame_histogram_.Render(out, "demo_frame_seconds", "");
+    appendHeader(out, "demo_frame_stage_seconds", "histogram",
+                 "Wall time of render loop stages.");
+    for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+      char labels[64];
+      std::snprintf(labels, sizeof(labels), "stage=\"%s\"",
+                    FrameStageName(static_cast<FrameStage>(stage)));
+      stage_histograms_[stage].Render(out, "demo_frame_stage_seconds", labels);
+    }
+
+    appendHeader(out, "demo_anari_commits_total", "counter",
+                 "ANARI object commits issued by the render loop.");
+    appendf(out, "demo_anari_commits_total %llu\n",
+            static_cast<unsigned long long>(anari_commits_));
+    appendHeader(out, "demo_anari_releases_total", "counter",
+                 "ANARI object releases issued by the render loop.");
+    appendf(out, "demo_anari_releases_total %llu\n",
+            static_cast<unsigned long long>(anari_releases_));
+    appendHeader(out, "demo_anari_array_bytes", "gauge",
+                 "Bytes handed to ANARI arrays by the app.");
+    appendf(out, "demo_anari_array_bytes %llu\n",
+            static_cast<unsigned long long>(anari_array_bytes_));
+    appendHeader(out, "demo_anari_pool_acquires_total", "counter",
+                 "ANARI objects and arrays acquired from the object pool.");
+    appendf(out, "demo_anari_pool_acquires_total{result=\"hit\"} %llu\n",
+            static_cast<unsigned long long>(anari_pool_hits_));
+    appendf(out, "demo_anari_pool_acquires_total{result=\"miss\"} %llu\n",
+            static_cast<unsigned long long>(anari_pool_misses_));
+    appendHeader(out, "demo_anari_pool_idle_objects", "gauge",
+                 "Released ANARI objects kept for reuse.");
+    appendf(out, "demo_anari_pool_idle_objects %llu\n",
+            static_cast<unsigned long long>(anari_pool_idle_));
+  }
+
+  if (uploads_ != nullptr) {
+    const UploadScheduler::Stats uploads = uploads_->GetStats();
+    const UploadScheduler::DrainEstimate drain = uploads_->EstimateDrain();
+    appendHeader(out, "demo_upload_queue_depth", "gauge",
+                 "Streamed uploads waiting for frame budget.");
+    appendf(out, "demo_upload_queue_depth %llu\n",
+            static_cast<unsigned long long>(uploads.queued));
+    appendHeader(out, "demo_upload_queue_bytes", "gauge",
+                 "Bytes of the streamed uploads waiting for frame budget.");
+    appendf(out, "demo_upload_queue_bytes %llu\n",
+            static_cast<unsigned long long>(uploads.queued_bytes));
+    appendHeader(out, "demo_upload_drain_seconds", "gauge",
+                 "Estimated time until the upload queue is empty.");
+    appendf(out, "demo_upload_drain_seconds %.3f\n", drain.seconds);
+  }
+
+  const StatusCounts status = TakeStatusCounts();
+  appendHeader(out, "demo_anari_status_messages_total", "counter",
+               "Warnings and errors reported by the ANARI device.");
+  appendf(out,
+          "demo_anari_status_messages_total{severity=\"warning\"} %llu\n",
+          static_cast<unsigned long long>(status.warnings));
+  appendf(out,
+          "demo_anari_status_messages_total{severity=\"performance\"} %llu\n",
+          static_cast<unsigned long long>(status.performance_warnings));
+  appendf(out, "demo_anari_status_messages_total{severity=\"error\"} %llu\n",
+          static_cast<unsigned long long>(status.errors));
+
+  const ProcessMemory memory = ReadProcessMemory();
+  appendHeader(out, "demo_resident_memory_bytes", "gauge",
+               "Resident set size of the process.");
+  appendf(out, "demo_resident_memory_bytes %llu\n",
+          static_cast<unsigned long long>(memory.rss_bytes));
+  appendHeader(out, "demo_peak_resident_memory_bytes", "gauge",
+               "Peak resident set size of the process.");
+  appendf(out, "demo_peak_resident_memory_bytes %llu\n",
+          static_cast<unsigned long long>(memory.peak_rss_bytes));
+
+  const AllocSnapshot allocs = TakeAllocSnapshot();
+  appendHeader(out, "demo_heap_allocations_total", "counter",
+               "Heap allocations by subsystem.");
+  for (std::size_t i = 0; i < kAllocSubsystemCount; ++i) {
+    appendf(out, "demo_heap_allocations_total{subsystem=\"%s\"} %llu\n",
+            AllocSubsystemName(static_cast<AllocSubsystem>(i)),
+            static_cast<unsigned long long>(allocs.subsystems[i].allocations));
+  }
+  appendHeader(out, "demo_heap_allocated_bytes_total", "counter",
+               "Heap bytes allocated by subsystem.");
+  for (std::size_t i = 0; i < kAllocSubsystemCount; ++i) {
+    appendf(out, "demo_heap_allocated_bytes_total{subsystem=\"%s\"} %llu\n",
+            AllocSubsystemName(static_cast<AllocSubsystem>(i)),
+            static_cast<unsigned long long>(allocs.subsystems[i].bytes));
+  }
+  return out;
+}
+
+MetricsServer::~MetricsServer() {
+  stop_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+#ifdef ANARI_PROJECT_HAS_SOCKETS
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+  }
+#endif
+}
+
+bool MetricsServer::Start(std::uint16_t port) {
+#ifdef ANARI_PROJECT_HAS_SOCKETS
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    std::printf("Error: Cannot create the metrics socket: %s\n",
+                std::strerror(errno));
+    return false;
+  }
+  const int reuse{1};
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#ifdef SO_NOSIGPIPE
+  setsockopt(listen_fd_, SOL_SOCKET, SO_NOSIGPIPE, &reuse, sizeof(reuse));
+#endif
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listen_fd_, reinterpret_cast<const sockaddr *>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd_, 4) != 0) {
+    std::printf("Error: Cannot listen on 127.0.0.1:%u for metrics: %s\n",
+                port, std::strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+  thread_ = std::thread{[this] { Serve(); }};
+  std::printf("Info: Serving metrics on http://127.0.0.1:%u/metrics\n", port);
+  return true;
+#else
+  (void)port;
+  std::printf("WARNING: The metrics endpoint is not supported on this "
+              "platform\n");
+  return false;
+#endif
+}
+
+void MetricsServer::Serve() {
+#ifdef ANARI_PROJECT_HAS_SOCKETS
+  while (!stop_) {
+    // Wake up regularly to notice stop_
+    pollfd listen_poll{listen_fd_, POLLIN, 0};
+    if (poll(&listen_poll, 1, 200) <= 0) {
+      continue;
+    }
+    const int connection = accept(listen_fd_, nullptr, nullptr);
+    if (connection < 0) {
+      continue;
+    }
+    HandleConnection(connection);
+    close(connection);
+  }
+#endif
+}
+
+void MetricsServer::HandleConnection(int connection) {
+#ifdef ANARI_PROJECT_HAS_SOCKETS
+  // A stalled client must not block the next scrape for long
+  timeval timeout{1, 0};
+  setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  // Only the request line matters, read until the end of the headers
+  char request[4096];
+  std::size_t size{};
+  while (size < sizeof(request) - 1) {
+    const ssize_t received =
+        recv(connection, request + size, sizeof(request) - 1 - size, 0);
+    if (received <= 0) {
+      break;
+    }
+    size += static_cast<std::size_t>(received);
+    request[size] = '\0';
+    if (std::strstr(request, "\r\n\r\n") != nullptr) {
+      break;
+    }
+  }
+  request[size] = '\0';
+
+  std::string body{};
+  const char *status{};
+  const char *content_type{"text/plain; charset=utf-8"};
+  if (std::strncmp(request, "GET /metrics ", 13) == 0 ||
+      std::strncmp(request, "GET /metrics?", 13) == 0) {
+    body = registry_.Render();
+    status = "200 OK";
+    content_type = "text/plain; version=0.0.4; charset=utf-8";
+  } else if (std::strncmp(request, "GET ", 4) == 0) {
+    body = "Not found, metrics are served at /metrics\n";
+    status = "404 Not Found";
+  } else {
+    body = "Only GET is supported\n";
+    status = "405 Method Not Allowed";
+  }
+
+  std::string response{};
+  appendf(response,
+          "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+          "Connection: close\r\n\r\n",
+          status, content_type, body.size());
+  response += body;
+  std::size_t sent{};
+  while (sent < response.size()) {
+    const ssize_t result = send(connection, response.data() + sent,
+                                response.size() - sent, MSG_NOSIGNAL);
+    if (result <= 0) {
+      break;
+    }
+    sent += static_cast<std::size_t>(result);
+  }
+#else
+  (void)connection;
+#endif
+}
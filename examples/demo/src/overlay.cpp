@@ -0,0 +1,216 @@
+#include "overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "kernels.h"
+
+constexpr float kNearPlane = 1e-3F;
+constexpr int kMarkerRadius = 4;
+// Pulls overlay depth slightly towards the camera so lines lying on scene
+// surfaces pass the depth test
+constexpr float kDepthBias = 0.999F;
+
+void OverlayRenderer::SetGrid(const Grid &grid) {
+  grid_ = grid;
+  dirty_ = true;
+}
+
+void OverlayRenderer::SetGridVisible(bool visible) {
+  dirty_ = dirty_ || visible != grid_visible_;
+  grid_visible_ = visible;
+}
+
+void OverlayRenderer::SetGizmo(vec3 origin, float length) {
+  gizmo_origin_ = origin;
+  gizmo_length_ = length;
+  dirty_ = true;
+}
+
+void OverlayRenderer::SetGizmoVisible(bool visible) {
+  dirty_ = dirty_ || visible != gizmo_visible_;
+  gizmo_visible_ = visible;
+}
+
+void OverlayRenderer::AddMarker(const Marker &marker) {
+  markers_.push_back(marker);
+  dirty_ = true;
+}
+
+void OverlayRenderer::ClearMarkers() {
+  dirty_ = dirty_ || !markers_.empty();
+  markers_.clear();
+}
+
+void OverlayRenderer::Update(std::uint32_t width, std::uint32_t height,
+                             const CameraState &camera) {
+  if (width != width_ || height != height_) {
+    width_ = width;
+    height_ = height;
+    const std::size_t size = static_cast<std::size_t>(width) * height;
+    color_.resize(size);
+    depth_.resize(size);
+    no_scene_depth_.assign(width, std::numeric_limits<float>::infinity());
+    dirty_ = true;
+  }
+  if (!(camera == camera_)) {
+    camera_ = camera;
+    forward_ = normalize(camera.direction);
+    right_ = normalize(cross(forward_, camera.up));
+    true_up_ = cross(right_, forward_);
+    tan_half_fovy_ = std::tan(camera.fovy * 0.5F);
+    dirty_ = true;
+  }
+  if (dirty_) {
+    Rasterize();
+    dirty_ = false;
+  }
+}
+
+void OverlayRenderer::Composite(FrameView<std::uint32_t> color,
+                                FrameView<const float> scene_depth) {
+  if (Empty() || color.Width() != width_ || color.Height() != height_) {
+    return;
+  }
+  const bool has_depth =
+      scene_depth.Width() == width_ && scene_depth.Height() == height_;
+  const Kernels &kernels = GetKernels();
+  for (std::uint32_t y = 0; y < height_; ++y) {
+    const std::size_t offset = static_cast<std::size_t>(y) * width_;
+    const float *depth_row =
+        has_depth ? scene_depth.Row(y).data() : no_scene_depth_.data();
+    kernels.composite_overlay_rgba8(color_.data() + offset,
+                                    depth_.data() + offset, depth_row,
+                                    color.Row(y).data(), width_);
+  }
+}
+
+void OverlayRenderer::Rasterize() {
+  std::fill(color_.begin(), color_.end(), 0U);
+  std::fill(depth_.begin(), depth_.end(),
+            std::numeric_limits<float>::infinity());
+  if (width_ == 0 || height_ == 0) {
+    return;
+  }
+
+  if (grid_visible_) {
+    const vec3 c = grid_.center;
+    const float e = grid_.extent;
+    const int lines = static_cast<int>(2.0F * e / grid_.step);
+    for (int i = 0; i <= lines; ++i) {
+      const float offset = -e + static_cast<float>(i) * grid_.step;
+      DrawLine({c[0] + offset, c[1], c[2] - e}, {c[0] + offset, c[1], c[2] + e},
+               grid_.color);
+      DrawLine({c[0] - e, c[1], c[2] + offset}, {c[0] + e, c[1], c[2] + offset},
+               grid_.color);
+    }
+  }
+
+  if (gizmo_visible_) {
+    const vec3 o = gizmo_origin_;
+    const float l = gizmo_length_;
+    DrawLine(o, {o[0] + l, o[1], o[2]}, 0xFF0000FFU);
+    DrawLine(o, {o[0], o[1] + l, o[2]}, 0xFF00FF00U);
+    DrawLine(o, {o[0], o[1], o[2] + l}, 0xFFFF0000U);
+  }
+
+  for (const auto &marker : markers_) {
+    DrawMarker(marker.position, marker.color);
+  }
+}
+
+vec3 OverlayRenderer::ToCamera(vec3 world) const {
+  const vec3 d = world - camera_.position;
+  return {dot(d, right_), dot(d, true_up_), dot(d, forward_)};
+}
+
+vec2 OverlayRenderer::ToPixel(vec3 p) const {
+  const float ndc_x = p[0] / (p[2] * tan_half_fovy_ * camera_.aspect);
+  const float ndc_y = p[1] / (p[2] * tan_half_fovy_);
+  return {(ndc_x * 0.5F + 0.5F) * static_cast<float>(width_),
+          (ndc_y * 0.5F + 0.5F) * static_cast<float>(height_)};
+}
+
+void OverlayRenderer::DrawLine(vec3 a, vec3 b, std::uint32_t color) {
+  vec3 ca = ToCamera(a);
+  vec3 cb = ToCamera(b);
+  if (ca[2] < kNearPlane && cb[2] < kNearPlane) {
+    return;
+  }
+  if (ca[2] < kNearPlane) {
+    ca = ca + (cb - ca) * ((kNearPlane - ca[2]) / (cb[2] - ca[2]));
+  } else if (cb[2] < kNearPlane) {
+    cb = cb + (ca - cb) * ((kNearPlane - cb[2]) / (ca[2] - cb[2]));
+  }
+
+  const vec2 pa = ToPixel(ca);
+  const vec2 pb = ToPixel(cb);
+  const float dx = pb[0] - pa[0];
+  const float dy = pb[1] - pa[1];
+
+  // Clip the screen-space segment to the frame (Liang-Barsky)
+  float s0{0.0F};
+  float s1{1.0F};
+  const float p[4] = {-dx, dx, -dy, dy};
+  const float q[4] = {pa[0], static_cast<float>(width_) - pa[0], pa[1],
+                      static_cast<float>(height_) - pa[1]};
+  for (int i = 0; i < 4; ++i) {
+    if (p[i] == 0.0F) {
+      if (q[i] < 0.0F) {
+        return;
+      }
+      continue;
+    }
+    const float r = q[i] / p[i];
+    if (p[i] < 0.0F) {
+      s0 = std::max(s0, r);
+    } else {
+      s1 = std::min(s1, r);
+    }
+  }
+  if (s0 > s1) {
+    return;
+  }
+
+  const float span = std::max(std::abs(dx), std::abs(dy)) * (s1 - s0);
+  const int steps = std::max(1, static_cast<int>(std::ceil(span)));
+  for (int i = 0; i <= steps; ++i) {
+    const float s = s0 + (s1 - s0) * static_cast<float>(i) /
+                             static_cast<float>(steps);
+    // Perspective-correct position along the segment for the depth test
+    const float inv_z = (1.0F - s) / ca[2] + s / cb[2];
+    const float t = (s / cb[2]) / inv_z;
+    const float depth = length(ca + (cb - ca) * t);
+    Plot(static_cast<int>(std::floor(pa[0] + dx * s)),
+         static_cast<int>(std::floor(pa[1] + dy * s)), depth, color);
+  }
+}
+
+void OverlayRenderer::DrawMarker(vec3 position, std::uint32_t color) {
+  const vec3 p = ToCamera(position);
+  if (p[2] < kNearPlane) {
+    return;
+  }
+  const vec2 pixel = ToPixel(p);
+  const int x = static_cast<int>(std::floor(pixel[0]));
+  const int y = static_cast<int>(std::floor(pixel[1]));
+  const float depth = length(p);
+  for (int i = -kMarkerRadius; i <= kMarkerRadius; ++i) {
+    Plot(x + i, y + i, depth, color);
+    Plot(x + i, y - i, depth, color);
+  }
+}
+
+void OverlayRenderer::Plot(int x, int y, float depth, std::uint32_t color) {
+  if (x < 0 || y < 0 || x >= static_cast<int>(width_) ||
+      y >= static_cast<int>(height_)) {
+    return;
+  }
+  const std::size_t index = static_cast<std::size_t>(y) * width_ + x;
+  depth *= kDepthBias;
+  if (depth < depth_[index]) {
+    depth_[index] = depth;
+    color_[index] = color;
+  }
+}
@@ -0,0 +1,549 @@
+// The extension utility is implemented once, before anything includes the
+// ANARI headers
+#define ANARI_EXTENSION_UTILITY_IMPL
+#include "render_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numbers>
+#include <thread>
+#include <utility>
+
+#include "alloc_tracker.h"
+#include "flight_recorder.h"
+#include "frame_view.h"
+#include "metrics.h"
+
+static std::atomic<int> log_threshold{ANARI_SEVERITY_DEBUG};
+
+void SetAnariLogThreshold(int severity) {
+  log_threshold.store(severity, std::memory_order_relaxed);
+}
+
+int AnariLogThreshold() {
+  return log_threshold.load(std::memory_order_relaxed);
+}
+
+static void statusFunc(const void *userData, ANARIDevice device,
+                       ANARIObject source, ANARIDataType sourceType,
+                       ANARIStatusSeverity severity, ANARIStatusCode code,
+                       const char *message) {
+  (void)userData;
+  (void)device;
+  (void)source;
+  (void)sourceType;
+  (void)code;
+  CountStatusMessage(severity, message);
+  if (severity == ANARI_SEVERITY_FATAL_ERROR) {
+    DumpFlightRecorder("ANARI fatal error");
+  }
+  if (severity > log_threshold.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (severity == ANARI_SEVERITY_FATAL_ERROR) {
+    std::fprintf(stderr, "[FATAL] %s\n", message);
+  } else if (severity == ANARI_SEVERITY_ERROR) {
+    std::fprintf(stderr, "[ERROR] %s\n", message);
+  } else if (severity == ANARI_SEVERITY_WARNING) {
+    std::fprintf(stderr, "[WARN ] %s\n", message);
+  } else if (severity == ANARI_SEVERITY_PERFORMANCE_WARNING) {
+    std::fprintf(stderr, "[PERF ] %s\n", message);
+  } else if (severity == ANARI_SEVERITY_INFO) {
+    std::fprintf(stderr, "[INFO ] %s\n", message);
+  } else if (severity == ANARI_SEVERITY_DEBUG) {
+    std::fprintf(stderr, "[DEBUG] %s\n", message);
+  }
+}
+
+static void onFrameCompletion(const void *, anari::Device d, anari::Frame f) {
+  //std::printf("anari::Device(%p) finished rendering anari::Frame(%p)!\n", d, f);
+}
+
+RenderSystem::~RenderSystem() {
+  for (auto &target : targets_) {
+    target.frame.Reset();
+    target.camera.Reset();
+  }
+  scene_ = {};
+  world_.Reset();
+  renderer_.Reset();
+  pool_.PrintStats("shutdown");
+  pool_.Clear();
+  AllocScope scope{AllocSubsystem::kAnari};
+  if (device_) {
+    anari::release(device_, device_);
+  }
+  if (library_) {
+    anari::unloadLibrary(library_);
+  }
+  PrintAnariObjectCounts("shutdown", true);
+}
+
+void RenderSystem::Init(const char *library_name) {
+  AllocScope scope{AllocSubsystem::kAnari};
+  std::printf("Initializing ANARI\n");
+  std::printf("Loading the %s library\n", library_name);
+  library_ = anari::loadLibrary(library_name, statusFunc);
+
+  std::printf("Creating a device\n");
+  anari::Extensions extensions =
+      anari::extension::getDeviceExtensionStruct(library_, "default");
+  if (!extensions.ANARI_KHR_GEOMETRY_TRIANGLE)
+    std::printf(
+        "WARNING: device doesn't support ANARI_KHR_GEOMETRY_TRIANGLE\n");
+  if (!extensions.ANARI_KHR_CAMERA_PERSPECTIVE)
+    std::printf(
+        "WARNING: device doesn't support ANARI_KHR_CAMERA_PERSPECTIVE\n");
+  if (!extensions.ANARI_KHR_MATERIAL_MATTE)
+    std::printf("WARNING: device doesn't support ANARI_KHR_MATERIAL_MATTE\n");
+  if (!extensions.ANARI_KHR_FRAME_COMPLETION_CALLBACK) {
+    std::printf(
+        "INFO: device doesn't support ANARI_KHR_FRAME_COMPLETION_CALLBACK\n");
+  }
+  device_ = anari::newDevice(library_, "default");
+  pool_.SetDevice(device_);
+
+  std::printf("Creating a renderer\n");
+  renderer_ = New<anari::Renderer>("default");
+  anari::setParameter(device_, renderer_.Get(), "name", "MainRenderer");
+  anari::setParameter(device_, renderer_.Get(), "ambientRadiance", 1.0F);
+  Commit(renderer_.Get());
+}
+
+void RenderSystem::CreateScene(AsyncLoader &loader) {
+  std::printf("Creating a scene\n");
+
+  // image size
+  uvec2 imgSize = {kWidth, kHeight};
+
+  // camera
+  camera_position_ = {0.0F, 0.0F, 0.0F};
+  camera_up_ = {0.0F, 1.0F, 0.0F};
+  camera_direction_ = {0.0F, 0.0F, 1.0F};
+  camera_fovy_ = kCameraFovy;
+  camera_aspect_ = (float)imgSize[0] / (float)imgSize[1];
+
+  // create and setup cameras, one per frame slot
+  for (auto &target : targets_) {
+    target.camera = NewCamera();
+  }
+
+  // The world to be populated with renderable objects, the frames render
+  // it from SetupFrame() on
+  world_ = New<anari::World>();
+  {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::setParameter(device_, world_.Get(), "id", 3U);
+  }
+
+  auto scene = LoadScene(loader);
+  ShowScene(loader.Wait(scene));
+  array_memory_.PrintStats();
+}
+
+void RenderSystem::StartStream(AsyncLoader &loader, UploadScheduler &uploads) {
+  streams_.push_back(StreamScene(loader, uploads, QuadImportance()));
+  loader.Start(streams_.back());
+}
+
+void RenderSystem::PollStreams() {
+  std::erase_if(streams_, [](const Task<> &stream) {
+    return stream.Done();
+  });
+}
+
+void RenderSystem::FinishStreams(UploadScheduler &uploads) {
+  stream_cancel_.Cancel();
+  while (!streams_.empty()) {
+    uploads.Flush();
+    PollStreams();
+    if (!streams_.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  }
+}
+
+void RenderSystem::SetupFrame(ANARIDataType color_format) {
+  std::printf("Setuping frame\n");
+
+  for (auto &target : targets_) {
+    target.frame = NewFrame(target.camera.Get(), color_format);
+  }
+  auto &main = Target(FrameSlot::kMain);
+  main.enabled = true;
+  {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::setParameter(device_, main.frame.Get(), "frameCompletionCallback",
+                        (anari::FrameCompletionCallback)onFrameCompletion);
+  }
+  Commit(main.frame.Get());
+}
+
+void RenderSystem::SetRendererParameter(const char *name, float value) {
+  AllocScope scope{AllocSubsystem::kAnari};
+  anari::setParameter(device_, renderer_.Get(), name, value);
+  Commit(renderer_.Get());
+}
+
+void RenderSystem::SetRendererParameter(const char *name, int value) {
+  AllocScope scope{AllocSubsystem::kAnari};
+  anari::setParameter(device_, renderer_.Get(), name, value);
+  Commit(renderer_.Get());
+}
+
+void RenderSystem::UpdateCamera(vec3 pos, vec3 up, vec3 dir) {
+  camera_position_ = pos;
+  camera_up_ = up;
+  camera_direction_ = dir;
+  for (auto &target : targets_) {
+    if (target.enabled) {
+      CommitCameraPose(target.camera.Get());
+    }
+  }
+}
+
+void RenderSystem::AnimateCamera(float time) {
+  vec3 position = camera_position_;
+  position[1] = std::sin(time);
+  UpdateCamera(position, camera_up_, camera_direction_);
+}
+
+void RenderSystem::SetFrameEnabled(FrameSlot slot, bool enabled) {
+  auto &target = Target(slot);
+  if (slot == FrameSlot::kMain || target.enabled == enabled) {
+    return;
+  }
+  target.enabled = enabled;
+  if (enabled) {
+    CommitCameraPose(target.camera.Get());
+  }
+}
+
+void RenderSystem::UpdateFrameSize(uvec2 size, FrameSlot slot) {
+  auto &target = Target(slot);
+  if (size == target.size) {
+    return;
+  }
+  target.size = size;
+  {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::setParameter(device_, target.frame.Get(), "size", target.size);
+  }
+  Commit(target.frame.Get());
+}
+
+void RenderSystem::UpdateCameraAspect(float aspect) {
+  // A minimized window has no size, keep the last aspect
+  if (!(aspect > 0.0F) || aspect == camera_aspect_) {
+    return;
+  }
+  camera_aspect_ = aspect;
+  // Disabled frames too, enabling one only commits the pose
+  for (auto &target : targets_) {
+    {
+      AllocScope scope{AllocSubsystem::kAnari};
+      anari::setParameter(device_, target.camera.Get(), "aspect",
+                          camera_aspect_);
+    }
+    Commit(target.camera.Get());
+  }
+}
+
+void RenderSystem::UpdateImageRegion(const box2 &region, FrameSlot slot) {
+  auto &target = Target(slot);
+  if (region == target.image_region) {
+    return;
+  }
+  target.image_region = region;
+  {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::setParameter(device_, target.camera.Get(), "imageRegion",
+                        ANARI_FLOAT32_BOX2, target.image_region.data());
+  }
+  Commit(target.camera.Get());
+}
+
+void RenderSystem::RenderFrame() {
+  AllocScope scope{AllocSubsystem::kAnari};
+  auto &main = Target(FrameSlot::kMain);
+  auto &focus = Target(FrameSlot::kFocus);
+  anari::render(device_, main.frame.Get());
+  if (focus.enabled) {
+    anari::render(device_, focus.frame.Get());
+    anari::wait(device_, focus.frame.Get());
+  }
+  anari::wait(device_, main.frame.Get());
+}
+
+void RenderSystem::RenderFrame(FrameSlot slot) {
+  AllocScope scope{AllocSubsystem::kAnari};
+  auto &target = Target(slot);
+  anari::render(device_, target.frame.Get());
+  anari::wait(device_, target.frame.Get());
+}
+
+anari::MappedFrameData<void> RenderSystem::MapChannel(const char *channel,
+                                                      FrameSlot slot) {
+  AllocScope scope{AllocSubsystem::kAnari};
+  return anari::map<void>(device_, Target(slot).frame.Get(), channel);
+}
+
+void RenderSystem::UnmapChannel(const char *channel, FrameSlot slot) {
+  AllocScope scope{AllocSubsystem::kAnari};
+  anari::unmap(device_, Target(slot).frame.Get(), channel);
+}
+
+RenderSystem::PickResult RenderSystem::Pick(uvec2 display_pixel,
+                                            uvec2 display_size) {
+  const auto frame = Target(FrameSlot::kMain).frame.Get();
+  const uvec2 frame_size = GetFrameSize();
+  const uvec2 pixel{static_cast<unsigned int>(
+                        static_cast<std::uint64_t>(display_pixel[0]) *
+                        frame_size[0] / std::max(display_size[0], 1U)),
+                    static_cast<unsigned int>(
+                        static_cast<std::uint64_t>(display_pixel[1]) *
+                        frame_size[1] / std::max(display_size[1], 1U))};
+  PickResult result{};
+  AllocScope scope{AllocSubsystem::kAnari};
+  auto fb_prim_id = anari::map<PixelId>(device_, frame, "channel.primitiveId");
+  auto fb_obj_id = anari::map<PixelId>(device_, frame, "channel.objectId");
+  auto fb_inst_id = anari::map<PixelId>(device_, frame, "channel.instanceId");
+  const auto prim_ids = MakeFrameView(fb_prim_id);
+  const auto obj_ids = MakeFrameView(fb_obj_id);
+  const auto inst_ids = MakeFrameView(fb_inst_id);
+  if (!prim_ids.Empty() && pixel[0] < prim_ids.Width() &&
+      pixel[1] < prim_ids.Height()) {
+    result.primitive_id = prim_ids.At(pixel).value;
+    // ANARI reports background pixels as ~0u in id channels
+    result.hit = result.primitive_id != ~0U;
+  }
+  if (!obj_ids.Empty() && pixel[0] < obj_ids.Width() &&
+      pixel[1] < obj_ids.Height()) {
+    result.object_id = obj_ids.At(pixel).value;
+  }
+  if (!inst_ids.Empty() && pixel[0] < inst_ids.Width() &&
+      pixel[1] < inst_ids.Height()) {
+    result.instance_id = inst_ids.At(pixel).value;
+  }
+  anari::unmap(device_, frame, "channel.instanceId");
+  anari::unmap(device_, frame, "channel.objectId");
+  anari::unmap(device_, frame, "channel.primitiveId");
+  return result;
+}
+
+Task<> RenderSystem::StreamScene(AsyncLoader &loader,
+                                 UploadScheduler &uploads,
+                                 UploadRequest importance) {
+  SceneObjects scene{};
+  auto sampler = StreamSampler(loader, uploads, importance, scene);
+  auto mesh = StreamMesh(uploads, importance, scene);
+  co_await WhenAll(sampler, mesh);
+
+  // Material, surface and world
+  UploadRequest upload = importance;
+  upload.commits = 3;
+  co_await uploads.Upload(upload);
+  if (stream_cancel_.Cancelled()) {
+    co_return;
+  }
+  BuildSurface(scene);
+  ShowScene(std::move(scene));
+}
+
+Task<> RenderSystem::StreamSampler(AsyncLoader &loader,
+                                   UploadScheduler &uploads,
+                                   UploadRequest importance,
+                                   SceneObjects &scene) {
+  const auto image =
+      co_await LoadImage(loader, kTexturePath, &stream_cancel_);
+  UploadRequest upload = importance;
+  upload.bytes = image ? static_cast<std::uint64_t>(image->size_x) *
+                             image->size_y * image->components
+                       : 0;
+  upload.commits = 1;
+  co_await uploads.Upload(upload);
+  if (stream_cancel_.Cancelled()) {
+    co_return;
+  }
+  scene.sampler = NewSampler(image, scene);
+}
+
+Task<> RenderSystem::StreamMesh(UploadScheduler &uploads,
+                                UploadRequest importance,
+                                SceneObjects &scene) {
+  UploadRequest upload = importance;
+  upload.bytes = kQuadBytes;
+  upload.commits = 1;
+  co_await uploads.Upload(upload);
+  if (stream_cancel_.Cancelled()) {
+    co_return;
+  }
+  BuildMesh(scene);
+}
+
+AnariHandle<anari::Sampler> RenderSystem::NewSampler(
+    const std::optional<DecodedImage> &image, SceneObjects &scene) {
+  auto sampler = pool_.Acquire<anari::Sampler>(kSamplerSubtype);
+  if (image) {
+    switch (image->components) {
+    case 3U: {
+      SetParameterArray2D(scene, sampler.Get(), "sampler", "image",
+                          ANARI_UFIXED8_VEC3, 3, image->data.get(),
+                          image->size_x, image->size_y);
+      break;
+    }
+    case 4U: {
+      SetParameterArray2D(scene, sampler.Get(), "sampler", "image",
+                          ANARI_UFIXED8_VEC4, 4, image->data.get(),
+                          image->size_x, image->size_y);
+      break;
+    }
+    default: {
+      std::printf("Error: Unsupported image format, c=%d\n",
+                  image->components);
+      break;
+    }
+    }
+  }
+  Commit(sampler.Get());
+  return sampler;
+}
+
+Task<AnariHandle<anari::Sampler>>
+RenderSystem::LoadSampler(AsyncLoader &loader, std::string path,
+                          const CancelToken *cancel, SceneObjects &scene) {
+  const auto image = co_await LoadImage(loader, std::move(path), cancel);
+  co_await loader.LoadingThread();
+  co_return NewSampler(image, scene);
+}
+
+Task<RenderSystem::SceneObjects>
+RenderSystem::LoadScene(AsyncLoader &loader) {
+  SceneObjects scene{};
+  auto sampler = LoadSampler(loader, kTexturePath, nullptr, scene);
+  auto mesh = LoadMesh(loader, scene);
+  co_await WhenAll(sampler, mesh);
+  // Both finish on the loading thread, so does the last one resuming here
+  scene.sampler = sampler.TakeResult();
+  BuildSurface(scene);
+  co_return scene;
+}
+
+Task<> RenderSystem::LoadMesh(AsyncLoader &loader, SceneObjects &scene) {
+  co_await loader.LoadingThread();
+  BuildMesh(scene);
+}
+
+void RenderSystem::BuildMesh(SceneObjects &scene) {
+  scene.mesh = pool_.Acquire<anari::Geometry>(kMeshSubtype);
+  const anari::Geometry mesh = scene.mesh.Get();
+  SetParameterArray1D(scene, mesh, "mesh", "vertex.position",
+                      kQuadVertices.data(), kQuadVertices.size());
+  SetParameterArray1D(scene, mesh, "mesh", "vertex.attribute0",
+                      kQuadUvs.data(), kQuadUvs.size());
+  SetParameterArray1D(scene, mesh, "mesh", "primitive.index",
+                      kQuadIndices.data(), kQuadIndices.size());
+  Commit(mesh);
+}
+
+void RenderSystem::BuildSurface(SceneObjects &scene) {
+  scene.material = pool_.Acquire<anari::Material>(kMaterialSubtype);
+  const anari::Material mat = scene.material.Get();
+  {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::setParameter(device_, mat, "color", scene.sampler.Get());
+  }
+  Commit(mat);
+
+  // put the mesh into a surface
+  scene.surface = pool_.Acquire<anari::Surface>();
+  const anari::Surface surface = scene.surface.Get();
+  {
+    AllocScope scope{AllocSubsystem::kAnari};
+    anari::setParameter(device_, surface, "geometry", scene.mesh.Get());
+    anari::setParameter(device_, surface, "material", mat);
+    anari::setParameter(device_, surface, "id", 2U);
+  }
+  Commit(surface);
+}
+
+void RenderSystem::ShowScene(SceneObjects &&scene) {
+  const anari::Surface surface = scene.surface.Get();
+  SetParameterArray1D(scene, world_.Get(), "world", "surface", &surface,
+                      1);
+  Commit(world_.Get());
+  RecycleScene(scene_);
+  scene_ = std::move(scene);
+}
+
+void RenderSystem::RecycleScene(SceneObjects &scene) {
+  pool_.Recycle(std::move(scene.surface));
+  pool_.Recycle(std::move(scene.material), kMaterialSubtype);
+  pool_.Recycle(std::move(scene.sampler), kSamplerSubtype);
+  pool_.Recycle(std::move(scene.mesh), kMeshSubtype);
+  for (auto &[array, type, size_x, size_y] : scene.arrays_1d) {
+    pool_.RecycleArray(std::move(array), type, size_x);
+  }
+  for (auto &[array, type, size_x, size_y] : scene.arrays_2d) {
+    pool_.RecycleArray(std::move(array), type, size_x, size_y);
+  }
+  scene = {};
+}
+
+UploadRequest RenderSystem::QuadImportance() const {
+  const float depth = dot(kQuadCenter - camera_position_,
+                          normalize(camera_direction_));
+  if (depth <= -kQuadRadius) {
+    return {.visible = false};
+  }
+  // Radius in units of half the view height, which is 2 * aspect units
+  // squared in area
+  const float radius =
+      kQuadRadius /
+      (std::max(depth, kQuadRadius) * std::tan(camera_fovy_ * 0.5F));
+  const float coverage =
+      std::numbers::pi_v<float> * radius * radius /
+      (4.0F * std::max(camera_aspect_, 0.01F));
+  return {.visible = true, .screen_coverage = std::min(coverage, 1.0F)};
+}
+
+void RenderSystem::CommitCameraPose(anari::Camera camera) {
+  AllocScope scope{AllocSubsystem::kAnari};
+  anari::setParameter(device_, camera, "position", camera_position_);
+  anari::setParameter(device_, camera, "up", camera_up_);
+  anari::setParameter(device_, camera, "direction", camera_direction_);
+  Commit(camera);
+}
+
+AnariHandle<anari::Camera> RenderSystem::NewCamera() {
+  auto handle = New<anari::Camera>("perspective");
+  const anari::Camera camera = handle.Get();
+  AllocScope scope{AllocSubsystem::kAnari};
+  anari::setParameter(device_, camera, "aspect", camera_aspect_);
+  anari::setParameter(device_, camera, "fovy", camera_fovy_);
+  anari::setParameter(device_, camera, "position", camera_position_);
+  anari::setParameter(device_, camera, "up", camera_up_);
+  anari::setParameter(device_, camera, "direction", camera_direction_);
+  Commit(camera);
+  return handle;
+}
+
+AnariHandle<anari::Frame> RenderSystem::NewFrame(anari::Camera camera,
+                                                 ANARIDataType color_format) {
+  auto handle = New<anari::Frame>();
+  const anari::Frame frame = handle.Get();
+  AllocScope scope{AllocSubsystem::kAnari};
+  anari::setParameter(device_, frame, "renderer", renderer_.Get());
+  anari::setParameter(device_, frame, "camera", camera);
+  anari::setParameter(device_, frame, "world", world_.Get());
+  anari::setParameter(device_, frame, "size", kDefaultFrameSize);
+  anari::setParameter(device_, frame, "channel.color", color_format);
+  anari::setParameter(device_, frame, "channel.depth", ANARI_FLOAT32);
+  anari::setParameter(device_, frame, "channel.primitiveId", ANARI_UINT32);
+  anari::setParameter(device_, frame, "channel.objectId", ANARI_UINT32);
+  anari::setParameter(device_, frame, "channel.instanceId", ANARI_UINT32);
+  Commit(frame);
+  return handle;
+}
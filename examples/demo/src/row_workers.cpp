@@ -0,0 +1,76 @@
+#include "row_workers.h"
+
+#include "thread_placement.h"
+
+RowWorkers::RowWorkers(unsigned helper_threads) {
+  threads_.reserve(helper_threads);
+  for (unsigned i = 0; i < helper_threads; ++i) {
+    threads_.emplace_back([this, i] { WorkerLoop(i + 1); });
+  }
+}
+
+RowWorkers::~RowWorkers() {
+  {
+    std::lock_guard lock{mutex_};
+    stop_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void RowWorkers::Run(std::uint32_t rows, RangeFn fn, void *context) {
+  const unsigned concurrency = Concurrency();
+  if (concurrency == 1 || rows < concurrency) {
+    fn(context, 0, rows);
+    return;
+  }
+
+  {
+    std::lock_guard lock{mutex_};
+    fn_ = fn;
+    context_ = context;
+    rows_ = rows;
+    subsystem_ = CurrentAllocSubsystem();
+    pending_ = concurrency - 1;
+    ++generation_;
+  }
+  start_cv_.notify_all();
+
+  fn(context, 0, rows / concurrency);
+
+  std::unique_lock lock{mutex_};
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void RowWorkers::WorkerLoop(unsigned index) {
+  ThreadPlacementScope placement{ThreadRole::kRows, index - 1};
+  std::uint64_t seen_generation{0};
+  while (true) {
+    std::unique_lock lock{mutex_};
+    start_cv_.wait(lock,
+                   [&] { return stop_ || generation_ != seen_generation; });
+    if (stop_) {
+      return;
+    }
+    seen_generation = generation_;
+    const RangeFn fn = fn_;
+    void *context = context_;
+    const std::uint64_t rows = rows_;
+    const unsigned concurrency = Concurrency();
+    const AllocSubsystem subsystem = subsystem_;
+    lock.unlock();
+
+    {
+      AllocScope scope{subsystem};
+      fn(context, static_cast<std::uint32_t>(rows * index / concurrency),
+         static_cast<std::uint32_t>(rows * (index + 1) / concurrency));
+    }
+
+    lock.lock();
+    if (--pending_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+}
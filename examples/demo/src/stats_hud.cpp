@@ -0,0 +1,229 @@
+#include "stats_hud.h"
+
+#include <algorithm>
+#include <cstdio>
+
+// Packed RGBA8, R in the low byte
+constexpr std::uint32_t kBackground = 0xB0000000U;
+constexpr std::uint32_t kTextColor = 0xFFFFFFFFU;
+constexpr std::uint32_t kDimColor = 0xFF909090U;
+constexpr std::uint32_t kBudgetLineColor = 0xFF4040C0U;
+constexpr std::array<std::uint32_t, kFrameStageCount> kStageColors{
+    0xFFFFC040U, // prepare
+    0xFF40FFFFU, // camera
+    0xFF40C040U, // render
+    0xFF4080FFU, // assemble
+    0xFFFF40FFU, // present
+    0xFFC0C0C0U, // events
+};
+constexpr std::array<const char *, kFrameStageCount> kStageLabels{
+    "PREP", "CAM", "RNDR", "ASM", "PRES", "EVT"};
+
+constexpr int kGlyphWidth = 5;
+constexpr int kGlyphHeight = 7;
+constexpr int kCellWidth = kGlyphWidth + 1;
+constexpr int kLineHeight = kGlyphHeight + 3;
+constexpr int kMargin = 4;
+// Frame time at the top of the graph
+constexpr float kGraphRangeMs = 40.0F;
+constexpr int kGraphHeight = 56;
+
+struct Glyph final {
+  char c;
+  // Top row first, bit 4 is the leftmost column
+  std::uint8_t rows[kGlyphHeight];
+};
+
+constexpr Glyph kGlyphs[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+    {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+    {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+    {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+    {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+    {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {'=', {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}},
+    {'#', {0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F}},
+};
+
+// Glyphs indexed by ASCII code, unknown characters are blank
+static std::array<const std::uint8_t *, 128> buildGlyphTable() {
+  static constexpr std::uint8_t kBlank[kGlyphHeight]{};
+  std::array<const std::uint8_t *, 128> table{};
+  table.fill(kBlank);
+  for (const Glyph &glyph : kGlyphs) {
+    table[static_cast<unsigned char>(glyph.c)] = glyph.rows;
+  }
+  return table;
+}
+
+static const auto glyph_table = buildGlyphTable();
+
+StatsHud::StatsHud() : pixels_(kWidth * kHeight, kBackground) {}
+
+void StatsHud::Record(const FrameTelemetry &telemetry) {
+  history_[next_] = telemetry;
+  next_ = (next_ + 1) % kHistory;
+  count_ = std::min(count_ + 1, kHistory);
+}
+
+bool StatsHud::Draw(const HudInfo &info) {
+  const auto start = std::chrono::steady_clock::now();
+  if (start - last_draw_ < kRedrawPeriod) {
+    return false;
+  }
+  last_draw_ = start;
+  std::fill(pixels_.begin(), pixels_.end(), kBackground);
+
+  // Averages over the graph window
+  std::array<float, kFrameStageCount> stage_ms{};
+  float total_ms{};
+  for (std::size_t i = 0; i < count_; ++i) {
+    for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+      stage_ms[stage] += history_[i].stage_ms[stage];
+    }
+    total_ms += history_[i].total_ms;
+  }
+  const float frames = static_cast<float>(std::max<std::size_t>(count_, 1));
+  for (float &ms : stage_ms) {
+    ms /= frames;
+  }
+  total_ms /= frames;
+  const FrameTelemetry &last = history_[(next_ + kHistory - 1) % kHistory];
+
+  char line[64];
+  int y = kMargin;
+  std::snprintf(line, sizeof(line), "FPS %.1f  FRAME %.2f MS  HUD %.3f MS",
+                total_ms > 0.0F ? 1000.0F / total_ms : 0.0F, total_ms,
+                draw_ms_);
+  Text(kMargin, y, line, kTextColor);
+  y += kLineHeight;
+  std::snprintf(line, sizeof(line), "%s  SCALE %.2f  %uX%u  FRAME %ux%u",
+                info.mode, info.render_scale, info.display_width,
+                info.display_height, last.width, last.height);
+  Text(kMargin, y, line, kTextColor);
+  y += kLineHeight;
+  std::snprintf(line, sizeof(line), "RSS %.1f MB  ANARI ARRAYS %.2f MB",
+                static_cast<double>(info.rss_bytes) / (1024.0 * 1024.0),
+                static_cast<double>(info.anari_array_bytes) /
+                    (1024.0 * 1024.0));
+  Text(kMargin, y, line, kTextColor);
+  y += kLineHeight;
+  std::snprintf(line, sizeof(line),
+                "IN FLIGHT %u  WORKERS %u  CMDS %u  HITCH %llu  ALLOC %u",
+                info.frames_in_flight, info.row_threads, info.pending_commands,
+                static_cast<unsigned long long>(info.hitches),
+                last.allocations);
+  Text(kMargin, y, line, kTextColor);
+  y += kLineHeight;
+
+  // Stage legend, two rows of three
+  for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+    const int column = static_cast<int>(stage % 3);
+    const int row = static_cast<int>(stage / 3);
+    const int x = kMargin + column * 104;
+    Text(x, y + row * kLineHeight, "#", kStageColors[stage]);
+    std::snprintf(line, sizeof(line), "%s %.2f", kStageLabels[stage],
+                  stage_ms[stage]);
+    Text(x + kCellWidth, y + row * kLineHeight, line, kDimColor);
+  }
+  y += 2 * kLineHeight;
+
+  // Stacked stage times, newest frame on the right, 2 pixels per frame
+  const int graph_bottom = y + kGraphHeight;
+  const float pixels_per_ms = kGraphHeight / kGraphRangeMs;
+  for (std::size_t i = 0; i < count_; ++i) {
+    const FrameTelemetry &frame =
+        history_[(next_ + kHistory - count_ + i) % kHistory];
+    const int x = kMargin + static_cast<int>(kHistory - count_ + i) * 2;
+    float base_ms{};
+    for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+      const int bottom =
+          graph_bottom - static_cast<int>(base_ms * pixels_per_ms);
+      base_ms += frame.stage_ms[stage];
+      const int top = graph_bottom - static_cast<int>(base_ms * pixels_per_ms);
+      Fill(x, top, 2, bottom - top, kStageColors[stage]);
+    }
+  }
+  // 60 and 30 Hz budgets
+  for (const float budget_ms : {1000.0F / 60.0F, 1000.0F / 30.0F}) {
+    Fill(kMargin, graph_bottom - static_cast<int>(budget_ms * pixels_per_ms),
+         static_cast<int>(kHistory) * 2, 1, kBudgetLineColor);
+  }
+
+  draw_ms_ = std::chrono::duration<float, std::milli>(
+                 std::chrono::steady_clock::now() - start)
+                 .count();
+  return true;
+}
+
+// Coordinates from the top-left corner, clipped to the panel.
+void StatsHud::Fill(int x, int y, int width, int height, std::uint32_t color) {
+  const int x0 = std::max(x, 0);
+  const int x1 = std::min(x + width, static_cast<int>(kWidth));
+  const int y0 = std::max(y, 0);
+  const int y1 = std::min(y + height, static_cast<int>(kHeight));
+  for (int row = y0; row < y1; ++row) {
+    std::uint32_t *pixels =
+        pixels_.data() + static_cast<std::size_t>(kHeight - 1 - row) * kWidth;
+    std::fill(pixels + x0, pixels + std::max(x0, x1), color);
+  }
+}
+
+void StatsHud::Text(int x, int y, const char *text, std::uint32_t color) {
+  for (; *text != '\0' && x >= 0 && x + kGlyphWidth <= static_cast<int>(kWidth);
+       ++text, x += kCellWidth) {
+    char c = *text;
+    if (c >= 'a' && c <= 'z') {
+      c = static_cast<char>(c - 'a' + 'A');
+    }
+    const std::uint8_t *rows = glyph_table[static_cast<unsigned char>(c) & 0x7F];
+    for (int row = 0; row < kGlyphHeight; ++row) {
+      if (rows[row] == 0 || y + row < 0 || y + row >= static_cast<int>(kHeight)) {
+        continue;
+      }
+      std::uint32_t *pixels =
+          pixels_.data() +
+          static_cast<std::size_t>(kHeight - 1 - (y + row)) * kWidth + x;
+      for (int column = 0; column < kGlyphWidth; ++column) {
+        if ((rows[row] >> (kGlyphWidth - 1 - column)) & 1U) {
+          pixels[column] = color;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,462 @@
+#include "thread_placement.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define ANARI_PROJECT_HAS_THREAD_PLACEMENT 1
+#endif
+
+struct RegisteredThread final {
+  std::uint64_t id{};
+  ThreadRole role{};
+  unsigned index{};
+  std::int64_t tid{};
+  std::string errors{};
+};
+
+// Guards the placements and the registry
+static std::mutex registry_mutex{};
+static ThreadPlacements thread_placements{};
+static std::vector<RegisteredThread> registered_threads{};
+static std::uint64_t next_thread_id{1};
+
+const char *ThreadRoleName(ThreadRole role) {
+  switch (role) {
+  case ThreadRole::kMain:
+    return "main";
+  case ThreadRole::kRows:
+    return "rows";
+  case ThreadRole::kJobs:
+    return "jobs";
+  case ThreadRole::kIo:
+    return "io";
+  case ThreadRole::kCount:
+    break;
+  }
+  return "unknown";
+}
+
+// Splits "<role>=<setting>" and returns the setting, or null.
+static const char *parseRole(const char *value, ThreadRole &role) {
+  const char *equals = std::strchr(value, '=');
+  if (equals == nullptr) {
+    return nullptr;
+  }
+  for (std::size_t r = 0; r < kThreadRoleCount; ++r) {
+    const char *name = ThreadRoleName(static_cast<ThreadRole>(r));
+    if (std::strlen(name) == static_cast<std::size_t>(equals - value) &&
+        std::strncmp(value, name, std::strlen(name)) == 0) {
+      role = static_cast<ThreadRole>(r);
+      return equals + 1;
+    }
+  }
+  return nullptr;
+}
+
+// "0-3,8,10-11" as in --cpus and sysfs
+static bool parseCpuList(const char *text, std::vector<unsigned> &cpus) {
+  cpus.clear();
+  const char *p = text;
+  while (*p != '\0' && *p != '\n') {
+    char *end{};
+    const unsigned long first = std::strtoul(p, &end, 10);
+    if (end == p) {
+      return false;
+    }
+    unsigned long last = first;
+    p = end;
+    if (*p == '-') {
+      ++p;
+      last = std::strtoul(p, &end, 10);
+      if (end == p || last < first) {
+        return false;
+      }
+      p = end;
+    }
+    for (unsigned long cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(static_cast<unsigned>(cpu));
+    }
+    if (*p == ',') {
+      ++p;
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return !cpus.empty();
+}
+
+static std::string formatCpuList(const std::vector<unsigned> &cpus) {
+  std::string text{};
+  for (std::size_t i = 0; i < cpus.size();) {
+    std::size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      ++j;
+    }
+    if (!text.empty()) {
+      text += ',';
+    }
+    text += std::to_string(cpus[i]);
+    if (j > i) {
+      text += '-' + std::to_string(cpus[j]);
+    }
+    i = j + 1;
+  }
+  return text;
+}
+
+bool ParseThreadCpus(const char *value, ThreadPlacements &placements) {
+  ThreadRole role{};
+  const char *setting = parseRole(value, role);
+  std::vector<unsigned> cpus{};
+  if (setting == nullptr || !parseCpuList(setting, cpus)) {
+    return false;
+  }
+  placements[static_cast<std::size_t>(role)].cpus = std::move(cpus);
+  return true;
+}
+
+bool ParseThreadNumaNode(const char *value, ThreadPlacements &placements) {
+  ThreadRole role{};
+  const char *setting = parseRole(value, role);
+  if (setting == nullptr) {
+    return false;
+  }
+  return ParseNumaNode(setting,
+                       placements[static_cast<std::size_t>(role)].numa_node);
+}
+
+bool ParseThreadPriority(const char *value, ThreadPlacements &placements) {
+  ThreadRole role{};
+  const char *setting = parseRole(value, role);
+  if (setting == nullptr) {
+    return false;
+  }
+  const bool realtime = std::strncmp(setting, "rt", 2) == 0;
+  const char *number = realtime ? setting + 2 : setting;
+  char *end{};
+  const long priority = std::strtol(number, &end, 10);
+  if (end == number || *end != '\0') {
+    return false;
+  }
+  ThreadPlacement &placement = placements[static_cast<std::size_t>(role)];
+  if (realtime) {
+    if (priority < 1 || priority > 99) {
+      return false;
+    }
+    placement.realtime_priority = static_cast<int>(priority);
+    placement.nice.reset();
+  } else {
+    if (priority < -20 || priority > 19) {
+      return false;
+    }
+    placement.nice = static_cast<int>(priority);
+    placement.realtime_priority.reset();
+  }
+  return true;
+}
+
+bool ParseNumaNode(const char *value, std::optional<unsigned> &node) {
+  char *end{};
+  const unsigned long number = std::strtoul(value, &end, 10);
+  // Node masks of set_mempolicy() and mbind() are one word
+  if (end == value || *end != '\0' || number >= 64) {
+    return false;
+  }
+  node = static_cast<unsigned>(number);
+  return true;
+}
+
+bool ParseThreadOption(const char *arg, const char *value,
+                       ThreadPlacements &placements) {
+  if (value == nullptr) {
+    return false;
+  }
+  if (std::strcmp(arg, "--cpus") == 0) {
+    return ParseThreadCpus(value, placements);
+  }
+  if (std::strcmp(arg, "--numa-node") == 0) {
+    return ParseThreadNumaNode(value, placements);
+  }
+  if (std::strcmp(arg, "--priority") == 0) {
+    return ParseThreadPriority(value, placements);
+  }
+  return false;
+}
+
+void PrintThreadUsage() {
+  std::printf(
+      "  --cpus <role>=<list>  CPUs of the main, rows, jobs or io threads,\n"
+      "                        e.g. jobs=4-7,12\n"
+      "  --numa-node <role>=<n>  run the threads of a role on NUMA node <n>\n"
+      "                        and allocate their memory there\n"
+      "  --priority <role>=<nice|rt<n>>  nice value of the threads of a\n"
+      "                        role, or SCHED_FIFO priority, e.g. main=rt10\n");
+}
+
+void SetThreadPlacements(const ThreadPlacements &placements) {
+  std::lock_guard lock{registry_mutex};
+  thread_placements = placements;
+}
+
+ThreadPlacement GetThreadPlacement(ThreadRole role) {
+  std::lock_guard lock{registry_mutex};
+  return thread_placements[static_cast<std::size_t>(role)];
+}
+
+#ifdef ANARI_PROJECT_HAS_THREAD_PLACEMENT
+
+static std::int64_t currentTid() { return syscall(SYS_gettid); }
+
+static std::vector<unsigned> nodeCpus(unsigned node) {
+  char path[64];
+  std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist",
+                node);
+  std::vector<unsigned> cpus{};
+  std::FILE *file = std::fopen(path, "r");
+  if (file == nullptr) {
+    return cpus;
+  }
+  char line[1024]{};
+  if (std::fgets(line, sizeof(line), file) != nullptr) {
+    parseCpuList(line, cpus);
+  }
+  std::fclose(file);
+  return cpus;
+}
+
+static void addError(std::string &errors, const char *what, int error) {
+  if (!errors.empty()) {
+    errors += "; ";
+  }
+  errors += what;
+  errors += ": ";
+  errors += std::strerror(error);
+}
+
+// Affinity first, so the memory policy matches the CPUs the thread ends up
+// on. Returns the settings that failed.
+static std::string applyPlacement(const ThreadPlacement &placement) {
+  std::string errors{};
+  std::vector<unsigned> cpus = placement.cpus;
+  if (placement.numa_node) {
+    std::vector<unsigned> node = nodeCpus(*placement.numa_node);
+    if (node.empty()) {
+      addError(errors, "numa node", ENOENT);
+    } else if (cpus.empty()) {
+      cpus = std::move(node);
+    } else {
+      std::vector<unsigned> both{};
+      std::set_intersection(cpus.begin(), cpus.end(), node.begin(),
+                            node.end(), std::back_inserter(both));
+      if (both.empty()) {
+        addError(errors, "cpus on numa node", EINVAL);
+      }
+      cpus = std::move(both);
+    }
+  }
+  if (!cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const unsigned cpu : cpus) {
+      if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &set);
+      }
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+      addError(errors, "affinity", errno);
+    }
+  }
+  if (placement.numa_node) {
+    // Preferred rather than bound, allocations still succeed when the node
+    // is full. The kernel wants one more than the bits of the mask.
+    const unsigned long mask = 1UL << *placement.numa_node;
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask,
+                sizeof(mask) * 8 + 1) != 0) {
+      addError(errors, "memory policy", errno);
+    }
+  }
+  if (placement.realtime_priority) {
+    sched_param param{};
+    param.sched_priority = *placement.realtime_priority;
+    const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0) {
+      addError(errors, "realtime priority", error);
+    }
+  } else if (placement.nice) {
+    // Per thread on Linux
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(currentTid()),
+                    *placement.nice) != 0) {
+      addError(errors, "nice", errno);
+    }
+  }
+  return errors;
+}
+
+// CPU the thread last ran on, field 39 of its stat file
+static int lastCpu(std::int64_t tid) {
+  char path[64];
+  std::snprintf(path, sizeof(path), "/proc/self/task/%lld/stat",
+                static_cast<long long>(tid));
+  std::FILE *file = std::fopen(path, "r");
+  if (file == nullptr) {
+    return -1;
+  }
+  char line[1024]{};
+  const bool read = std::fgets(line, sizeof(line), file) != nullptr;
+  std::fclose(file);
+  // The command name in field 2 may contain spaces, count from after it
+  const char *p = read ? std::strrchr(line, ')') : nullptr;
+  if (p == nullptr) {
+    return -1;
+  }
+  ++p;
+  for (int field = 3; field < 39; ++field) {
+    p = std::strchr(p + 1, ' ');
+    if (p == nullptr) {
+      return -1;
+    }
+  }
+  return std::atoi(p + 1);
+}
+
+// Node of every CPU, by index
+static std::vector<int> cpuNodes() {
+  std::vector<int> nodes{};
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (dir == nullptr) {
+    return nodes;
+  }
+  while (const dirent *entry = readdir(dir)) {
+    unsigned node{};
+    if (std::sscanf(entry->d_name, "node%u", &node) != 1) {
+      continue;
+    }
+    for (const unsigned cpu : nodeCpus(node)) {
+      if (cpu >= nodes.size()) {
+        nodes.resize(cpu + 1, -1);
+      }
+      nodes[cpu] = static_cast<int>(node);
+    }
+  }
+  closedir(dir);
+  return nodes;
+}
+
+static void describeThread(ThreadReport &report) {
+  const auto tid = static_cast<pid_t>(report.tid);
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(tid, sizeof(set), &set) == 0) {
+    std::vector<unsigned> cpus{};
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+    report.allowed_cpus = formatCpuList(cpus);
+  }
+  report.cpu = lastCpu(report.tid);
+  if (sched_getscheduler(tid) == SCHED_FIFO) {
+    sched_param param{};
+    sched_getparam(tid, &param);
+    report.policy = "fifo";
+    report.priority = param.sched_priority;
+  } else {
+    report.priority = getpriority(PRIO_PROCESS, static_cast<id_t>(tid));
+  }
+}
+
+#else
+
+static std::int64_t currentTid() { return 0; }
+
+static std::string applyPlacement(const ThreadPlacement &placement) {
+  const bool requested = !placement.cpus.empty() || placement.numa_node ||
+                         placement.nice || placement.realtime_priority;
+  return requested ? "not supported on this platform" : "";
+}
+
+static std::vector<int> cpuNodes() { return {}; }
+
+static void describeThread(ThreadReport &) {}
+
+#endif
+
+ThreadPlacementScope::ThreadPlacementScope(ThreadRole role, unsigned index) {
+  ThreadPlacement placement{};
+  {
+    std::lock_guard lock{registry_mutex};
+    placement = thread_placements[static_cast<std::size_t>(role)];
+  }
+  std::string errors = applyPlacement(placement);
+  if (!errors.empty()) {
+    std::printf("WARNING: Cannot place %s thread %u: %s\n",
+                ThreadRoleName(role), index, errors.c_str());
+  }
+  std::lock_guard lock{registry_mutex};
+  id_ = next_thread_id++;
+  registered_threads.push_back(
+      {id_, role, index, currentTid(), std::move(errors)});
+}
+
+ThreadPlacementScope::~ThreadPlacementScope() {
+  std::lock_guard lock{registry_mutex};
+  std::erase_if(registered_threads, [this](const RegisteredThread &thread) {
+    return thread.id == id_;
+  });
+}
+
+std::vector<ThreadReport> ThreadPlacementReport() {
+  std::vector<ThreadReport> reports{};
+  {
+    std::lock_guard lock{registry_mutex};
+    for (const RegisteredThread &thread : registered_threads) {
+      reports.push_back({.role = thread.role,
+                         .index = thread.index,
+                         .tid = thread.tid,
+                         .errors = thread.errors});
+    }
+  }
+  const std::vector<int> nodes = cpuNodes();
+  for (ThreadReport &report : reports) {
+    if (report.tid != 0) {
+      describeThread(report);
+    }
+    const auto cpu = static_cast<std::size_t>(report.cpu);
+    if (report.cpu >= 0 && cpu < nodes.size()) {
+      report.numa_node = nodes[cpu];
+    }
+  }
+  std::sort(reports.begin(), reports.end(),
+            [](const ThreadReport &a, const ThreadReport &b) {
+              return a.role != b.role ? a.role < b.role : a.index < b.index;
+            });
+  return reports;
+}
+
+void PrintThreadPlacement() {
+  for (const ThreadReport &report : ThreadPlacementReport()) {
+    std::printf("Info: Thread %s/%u tid=%lld cpus=%s on cpu=%d node=%d "
+                "policy=%s priority=%d%s%s\n",
+                ThreadRoleName(report.role), report.index,
+                static_cast<long long>(report.tid),
+                report.allowed_cpus.empty() ? "?"
+                                            : report.allowed_cpus.c_str(),
+                report.cpu, report.numa_node, report.policy, report.priority,
+                report.errors.empty() ? "" : " refused: ",
+                report.errors.c_str());
+  }
+}
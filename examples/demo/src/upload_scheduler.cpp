@@ -0,0 +1,145 @@
+#include "upload_scheduler.h"
+
+#include <algorithm>
+
+// Weight of the newest frame in the average frame time
+constexpr double kFrameTimeSmoothing = 0.1;
+
+static bool moreImportant(const UploadRequest &a, std::uint64_t a_sequence,
+                          const UploadRequest &b, std::uint64_t b_sequence) {
+  if (a.visible != b.visible) {
+    return a.visible;
+  }
+  if (a.screen_coverage != b.screen_coverage) {
+    return a.screen_coverage > b.screen_coverage;
+  }
+  return a_sequence < b_sequence;
+}
+
+void UploadScheduler::Push(const UploadRequest &request,
+                           std::coroutine_handle<> handle) {
+  std::lock_guard lock{mutex_};
+  pending_.push_back({request, sequence_++, handle});
+  queued_bytes_ += request.bytes;
+  queued_commits_ += request.commits;
+}
+
+void UploadScheduler::TakeFrame(std::vector<Pending> &pending,
+                                std::vector<Pending> &frame,
+                                const Budget &budget) {
+  std::uint64_t bytes{};
+  std::uint32_t commits{};
+  bool first{true};
+  // Later, smaller uploads may fill what a large one left of the budget
+  auto kept = pending.begin();
+  for (Pending &upload : pending) {
+    const bool fits = bytes + upload.request.bytes <= budget.bytes &&
+                      commits + upload.request.commits <= budget.commits;
+    if (first || fits) {
+      bytes += upload.request.bytes;
+      commits += upload.request.commits;
+      frame.push_back(upload);
+      first = false;
+    } else {
+      *kept++ = upload;
+    }
+  }
+  pending.erase(kept, pending.end());
+}
+
+std::size_t UploadScheduler::RunFrame() {
+  const auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard lock{mutex_};
+    if (last_frame_ != std::chrono::steady_clock::time_point{}) {
+      const double seconds =
+          std::chrono::duration<double>(now - last_frame_).count();
+      frame_seconds_ = frame_seconds_ == 0.0
+                           ? seconds
+                           : frame_seconds_ +
+                                 kFrameTimeSmoothing *
+                                     (seconds - frame_seconds_);
+    }
+    last_frame_ = now;
+    frame_bytes_ = 0;
+    frame_commits_ = 0;
+    if (pending_.empty()) {
+      return 0;
+    }
+    std::sort(pending_.begin(), pending_.end(),
+              [](const Pending &a, const Pending &b) {
+                return moreImportant(a.request, a.sequence, b.request,
+                                     b.sequence);
+              });
+    TakeFrame(pending_, resuming_, budget_);
+    for (const Pending &upload : resuming_) {
+      frame_bytes_ += upload.request.bytes;
+      frame_commits_ += upload.request.commits;
+    }
+    queued_bytes_ -= frame_bytes_;
+    queued_commits_ -= frame_commits_;
+    applied_ += resuming_.size();
+    deferred_ += pending_.size();
+  }
+  // Unlocked, the uploads may queue their next step
+  const std::size_t resumed = resuming_.size();
+  for (const Pending &upload : resuming_) {
+    upload.handle.resume();
+  }
+  resuming_.clear();
+  return resumed;
+}
+
+void UploadScheduler::Flush() {
+  while (true) {
+    {
+      std::lock_guard lock{mutex_};
+      if (pending_.empty()) {
+        return;
+      }
+      resuming_.swap(pending_);
+      queued_bytes_ = 0;
+      queued_commits_ = 0;
+      applied_ += resuming_.size();
+    }
+    for (const Pending &upload : resuming_) {
+      upload.handle.resume();
+    }
+    resuming_.clear();
+  }
+}
+
+UploadScheduler::Stats UploadScheduler::GetStats() const {
+  std::lock_guard lock{mutex_};
+  return {.queued = pending_.size(),
+          .queued_bytes = queued_bytes_,
+          .queued_commits = queued_commits_,
+          .frame_bytes = frame_bytes_,
+          .frame_commits = frame_commits_,
+          .applied = applied_,
+          .deferred = deferred_};
+}
+
+UploadScheduler::DrainEstimate UploadScheduler::EstimateDrain() const {
+  std::vector<Pending> pending{};
+  double frame_seconds{};
+  {
+    std::lock_guard lock{mutex_};
+    pending = pending_;
+    frame_seconds = frame_seconds_;
+  }
+  std::sort(pending.begin(), pending.end(),
+            [](const Pending &a, const Pending &b) {
+              return moreImportant(a.request, a.sequence, b.request,
+                                   b.sequence);
+            });
+  DrainEstimate estimate{};
+  std::vector<Pending> frame{};
+  while (!pending.empty()) {
+    TakeFrame(pending, frame, budget_);
+    frame.clear();
+    ++estimate.frames;
+  }
+  estimate.seconds = frame_seconds * static_cast<double>(estimate.frames);
+  return estimate;
+}
@@ -0,0 +1,215 @@
+#include "window_wrapper.h"
+
+#include <cstdio>
+#include <cstring>
+
+WindowWrapper::~WindowWrapper() {
+  if (window_ != nullptr) {
+    glfwDestroyWindow(window_);
+  }
+}
+
+bool WindowWrapper::SetDisplayChannel(const char *channel) {
+  for (std::size_t i = 0; i < kDisplayChannels.size(); ++i) {
+    if (std::strcmp(channel, kDisplayChannels[i]) == 0 ||
+        std::strcmp(channel,
+                    kDisplayChannels[i] + std::strlen("channel.")) == 0) {
+      display_channel_ = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+vec2 WindowWrapper::FocusCenter(uvec2 framebuffer_size) const {
+  const vec2 center{static_cast<float>(framebuffer_size[0]) * 0.5F,
+                    static_cast<float>(framebuffer_size[1]) * 0.5F};
+  if (!focus_follows_cursor_) {
+    return center;
+  }
+  int window_width{};
+  int window_height{};
+  glfwGetWindowSize(window_, &window_width, &window_height);
+  if (window_width <= 0 || window_height <= 0) {
+    return center;
+  }
+  double cursor_x{};
+  double cursor_y{};
+  glfwGetCursorPos(window_, &cursor_x, &cursor_y);
+  const double scale_x =
+      static_cast<double>(framebuffer_size[0]) / window_width;
+  const double scale_y =
+      static_cast<double>(framebuffer_size[1]) / window_height;
+  return {static_cast<float>(cursor_x * scale_x),
+          static_cast<float>((window_height - cursor_y) * scale_y)};
+}
+
+void WindowWrapper::HandleKey(int key, int scancode, int action, int mods) {
+  if (HandleCameraKey(key, action)) {
+    return;
+  }
+  if (action == GLFW_PRESS) {
+    switch (key) {
+    case GLFW_KEY_ESCAPE: {
+      std::printf("Key: Window should close\n");
+      glfwSetWindowShouldClose(window_, GL_TRUE);
+      break;
+    }
+    case GLFW_KEY_O: {
+      if (camera_ != nullptr) {
+        const bool orbit = camera_->Mode() == CameraMode::kOrbit;
+        camera_->SetMode(orbit ? CameraMode::kFly : CameraMode::kOrbit);
+        std::printf("Key: Camera %s\n", orbit ? "fly" : "orbit");
+      }
+      break;
+    }
+    case GLFW_KEY_R: {
+      if (camera_ != nullptr) {
+        camera_->Reset();
+        std::printf("Key: Camera reset\n");
+      }
+      break;
+    }
+    case GLFW_KEY_C: {
+      display_channel_ = (display_channel_ + 1) % kDisplayChannels.size();
+      std::printf("Key: Display %s\n", kDisplayChannels[display_channel_]);
+      break;
+    }
+    case GLFW_KEY_F: {
+      render_mode_ = static_cast<RenderMode>(
+          (static_cast<int>(render_mode_) + 1) %
+          (static_cast<int>(RenderMode::kInterleaved) + 1));
+      std::printf("Key: Render mode %s\n", RenderModeName(render_mode_));
+      break;
+    }
+    case GLFW_KEY_V: {
+      focus_follows_cursor_ = !focus_follows_cursor_;
+      std::printf("Key: Focus follows %s\n",
+                  focus_follows_cursor_ ? "cursor" : "screen center");
+      break;
+    }
+    case GLFW_KEY_G: {
+      if (overlay_ != nullptr) {
+        overlay_->SetGridVisible(!overlay_->GridVisible());
+        std::printf("Key: Grid %s\n", overlay_->GridVisible() ? "on" : "off");
+      }
+      break;
+    }
+    case GLFW_KEY_X: {
+      if (overlay_ != nullptr) {
+        overlay_->SetGizmoVisible(!overlay_->GizmoVisible());
+        std::printf("Key: Gizmo %s\n",
+                    overlay_->GizmoVisible() ? "on" : "off");
+      }
+      break;
+    }
+    case GLFW_KEY_M: {
+      if (overlay_ != nullptr) {
+        ToggleCornerMarkers();
+      }
+      break;
+    }
+    case GLFW_KEY_H: {
+      if (hud_ != nullptr) {
+        hud_->SetVisible(!hud_->Visible());
+        std::printf("Key: HUD %s\n", hud_->Visible() ? "on" : "off");
+      }
+      break;
+    }
+    case GLFW_KEY_P: {
+      std::printf("Key: Pick center pixel\n");
+      pick_requested_ = true;
+      break;
+    }
+    default:
+      std::printf("Key: Unknown input\n");
+      break;
+    }
+  }
+}
+
+void WindowWrapper::HandleMouseButton(int button, int action,
+                                      [[maybe_unused]] int mods) {
+  if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST) {
+    return;
+  }
+  const std::uint32_t bit = 1U << button;
+  mouse_buttons_ =
+      action == GLFW_RELEASE ? mouse_buttons_ & ~bit : mouse_buttons_ | bit;
+  if (camera_ == nullptr) {
+    return;
+  }
+  // From the buttons still held, so releasing one of two keeps dragging
+  // with the other. Rotating wins while the left one is held.
+  const auto held = [this](int held_button) {
+    return (mouse_buttons_ & (1U << held_button)) != 0;
+  };
+  if (held(GLFW_MOUSE_BUTTON_LEFT)) {
+    camera_->SetDrag(CameraController::Drag::kRotate);
+  } else if (held(GLFW_MOUSE_BUTTON_RIGHT) ||
+             held(GLFW_MOUSE_BUTTON_MIDDLE)) {
+    camera_->SetDrag(CameraController::Drag::kPan);
+  } else {
+    camera_->SetDrag(CameraController::Drag::kNone);
+  }
+}
+
+void WindowWrapper::HandleCursor(double x, double y) {
+  if (camera_ != nullptr) {
+    camera_->MoveCursor(x, y);
+  }
+}
+
+void WindowWrapper::HandleScroll([[maybe_unused]] double x_offset,
+                                 double y_offset) {
+  if (camera_ != nullptr) {
+    camera_->Scroll(y_offset);
+  }
+}
+
+bool WindowWrapper::HandleCameraKey(int key, int action) {
+  if (camera_ == nullptr) {
+    return false;
+  }
+  CameraController::Key camera_key{};
+  switch (key) {
+  case GLFW_KEY_W:
+    camera_key = CameraController::Key::kForward;
+    break;
+  case GLFW_KEY_S:
+    camera_key = CameraController::Key::kBack;
+    break;
+  case GLFW_KEY_A:
+    camera_key = CameraController::Key::kLeft;
+    break;
+  case GLFW_KEY_D:
+    camera_key = CameraController::Key::kRight;
+    break;
+  case GLFW_KEY_Q:
+    camera_key = CameraController::Key::kDown;
+    break;
+  case GLFW_KEY_E:
+    camera_key = CameraController::Key::kUp;
+    break;
+  default:
+    return false;
+  }
+  // Held keys are integrated per frame, repeats add nothing
+  if (action != GLFW_REPEAT) {
+    camera_->SetKey(camera_key, action == GLFW_PRESS);
+  }
+  return true;
+}
+
+void WindowWrapper::ToggleCornerMarkers() {
+  if (overlay_->MarkerCount() > 0) {
+    overlay_->ClearMarkers();
+    std::printf("Key: Markers off\n");
+    return;
+  }
+  for (const vec3 corner : {vec3{-1.0F, -1.0F, 3.0F}, vec3{-1.0F, 1.0F, 3.0F},
+                            vec3{1.0F, -1.0F, 3.0F}, vec3{1.0F, 1.0F, 3.0F}}) {
+    overlay_->AddMarker({corner});
+  }
+  std::printf("Key: Markers on\n");
+}
@@ -0,0 +1,82 @@
+#include <thread>
+
+#include "async_task.h"
+#include "unit_test.h"
+#include "upload_scheduler.h"
+
+static Task<int> immediate(int value) { co_return value; }
+
+// Suspends until a RunFrame() of scheduler resumes it
+static Task<int> afterUpload(UploadScheduler &scheduler, int value) {
+  co_await scheduler.Upload({.commits = 1});
+  co_return value;
+}
+
+static Task<> markAfterUpload(UploadScheduler &scheduler, bool &done) {
+  co_await scheduler.Upload({.commits = 1});
+  done = true;
+}
+
+static Task<int> sum(Task<int> &a, Task<int> &b) {
+  co_await WhenAll(a, b);
+  co_return a.TakeResult() + b.TakeResult();
+}
+
+static Task<int> sumWithVoid(Task<int> &a, Task<> &b) {
+  co_await WhenAll(a, b);
+  co_return a.TakeResult();
+}
+
+// Runs one frame of scheduler on another thread, like the render loop
+// resuming a load started by the loading thread.
+static void runFrameElsewhere(UploadScheduler &scheduler) {
+  std::thread thread{[&scheduler] { scheduler.RunFrame(); }};
+  thread.join();
+}
+
+static void testSynchronous() {
+  Task<int> a = immediate(1);
+  Task<int> b = immediate(2);
+  Task<int> total = sum(a, b);
+  total.Start();
+  Check(total.Done(), "done without suspending");
+  Check(a.Done() && b.Done(), "children done");
+  Check(total.TakeResult() == 3, "results of both children");
+}
+
+// The awaiting task is resumed by the last child to finish, on the thread
+// that finished it, and not before.
+static void testAsynchronous() {
+  UploadScheduler scheduler{{.bytes = 1024, .commits = 1}};
+  Task<int> a = afterUpload(scheduler, 3);
+  Task<int> b = afterUpload(scheduler, 4);
+  Task<int> total = sum(a, b);
+  total.Start();
+  Check(!total.Done() && !a.Done() && !b.Done(), "suspended children");
+  runFrameElsewhere(scheduler);
+  Check(a.Done() && !b.Done(), "first child done");
+  Check(!total.Done(), "waits for the last child");
+  runFrameElsewhere(scheduler);
+  Check(b.Done() && total.Done(), "done after the last child");
+  Check(total.TakeResult() == 7, "results of both children");
+}
+
+static void testMixed() {
+  UploadScheduler scheduler{};
+  bool marked{};
+  Task<int> a = immediate(5);
+  Task<> b = markAfterUpload(scheduler, marked);
+  Task<int> total = sumWithVoid(a, b);
+  total.Start();
+  Check(a.Done() && !total.Done(), "synchronous child done first");
+  runFrameElsewhere(scheduler);
+  Check(marked && total.Done(), "done after the asynchronous child");
+  Check(total.TakeResult() == 5, "result of the synchronous child");
+}
+
+int main() {
+  testSynchronous();
+  testAsynchronous();
+  testMixed();
+  return UnitTestResult();
+}
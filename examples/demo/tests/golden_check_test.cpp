@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "frame_view.h"
+#include "golden_check.h"
+#include "unit_test.h"
+
+static void testSummarizeSmall() {
+  Check(Summarize({}).count == 0, "empty samples");
+  const SampleSummary one = Summarize({5.0});
+  Check(one.count == 1 && one.median == 5.0 && one.low == 5.0 &&
+            one.high == 5.0,
+        "single sample");
+}
+
+// The interval comes from the order statistics at ranks
+// n/2 -+ 1.96 sqrt(n)/2, independent of the input order.
+static void testSummarizeRanks() {
+  std::vector<double> samples{};
+  for (int i = 1; i <= 101; ++i) {
+    samples.push_back(static_cast<double>(i));
+  }
+  std::shuffle(samples.begin(), samples.end(), std::mt19937{42});
+  const SampleSummary summary = Summarize(samples);
+  Check(summary.count == 101, "count");
+  Check(summary.median == 51.0, "median");
+  Check(summary.low == 41.0 && summary.high == 62.0, "confidence interval");
+}
+
+static void testSummarizeOutliers() {
+  const SampleSummary summary =
+      Summarize({1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 1000.0});
+  Check(summary.median == 6.0, "median unaffected by an outlier");
+  Check(summary.low <= summary.median && summary.median <= summary.high,
+        "interval contains the median");
+}
+
+static void testCompareIdentical() {
+  std::vector<std::uint32_t> pixels(16);
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = 0xFF000000U | static_cast<std::uint32_t>(i * 0x0F0F0F);
+  }
+  const FrameView<const std::uint32_t> image{pixels.data(), 4, 4};
+  const ImageComparison comparison = CompareImages(image, image, 16);
+  Check(comparison.size_matches, "sizes match");
+  Check(comparison.mae == 0.0 && comparison.bad_pixel_fraction == 0.0,
+        "no differences");
+  Check(std::isinf(comparison.psnr_db), "infinite PSNR");
+  Check(WithinTolerance(comparison, ImageTolerance{}), "within tolerance");
+}
+
+static void testCompareDifferences() {
+  std::vector<std::uint32_t> golden(16, 0xFF404040U);
+  std::vector<std::uint32_t> image = golden;
+  // Alpha is ignored
+  image[3] = 0x00404040U;
+  // One channel of one pixel off by 30
+  image[5] = 0xFF40405EU;
+  const ImageComparison comparison =
+      CompareImages({image.data(), 4, 4}, {golden.data(), 4, 4}, 16);
+  Check(comparison.size_matches, "sizes match");
+  Check(std::abs(comparison.mae - 30.0 / 48.0) < 1.0e-12, "MAE over RGB");
+  const double mse = 30.0 * 30.0 / 48.0;
+  Check(std::abs(comparison.psnr_db -
+                 10.0 * std::log10(255.0 * 255.0 / mse)) < 1.0e-9,
+        "PSNR");
+  Check(comparison.bad_pixel_fraction == 1.0 / 16.0, "bad pixels");
+  Check(!WithinTolerance(comparison, ImageTolerance{}), "out of tolerance");
+
+  const ImageComparison lenient =
+      CompareImages({image.data(), 4, 4}, {golden.data(), 4, 4}, 30);
+  Check(lenient.bad_pixel_fraction == 0.0, "threshold is exclusive");
+}
+
+static void testCompareSizeMismatch() {
+  std::vector<std::uint32_t> pixels(16);
+  const ImageComparison comparison =
+      CompareImages({pixels.data(), 4, 4}, {pixels.data(), 8, 2}, 16);
+  Check(!comparison.size_matches, "size mismatch detected");
+  Check(!WithinTolerance(comparison, ImageTolerance{}),
+        "size mismatch is out of tolerance");
+  Check(!CompareImages({}, {}, 16).size_matches, "empty image never matches");
+}
+
+int main() {
+  testSummarizeSmall();
+  testSummarizeRanks();
+  testSummarizeOutliers();
+  testCompareIdentical();
+  testCompareDifferences();
+  testCompareSizeMismatch();
+  return UnitTestResult();
+}
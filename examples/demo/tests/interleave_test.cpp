@@ -0,0 +1,47 @@
+#include <cmath>
+#include <cstdint>
+
+#include "interleave.h"
+#include "unit_test.h"
+
+static void testInterleavedWidth() {
+  Check(InterleavedWidth(4, 0) == 2 && InterleavedWidth(4, 1) == 2,
+        "even width splits evenly");
+  Check(InterleavedWidth(5, 0) == 3 && InterleavedWidth(5, 1) == 2,
+        "odd width has one more even column");
+  Check(InterleavedWidth(1, 0) == 1 && InterleavedWidth(1, 1) == 0,
+        "single column");
+}
+
+// Half frame pixel j must be centered on full frame column 2j + parity, for
+// even and odd widths.
+static void testImageRegionCenters() {
+  for (std::uint32_t width = 1; width <= 17; ++width) {
+    for (std::uint32_t parity = 0; parity < 2; ++parity) {
+      const std::uint32_t half_width = InterleavedWidth(width, parity);
+      if (half_width == 0) {
+        continue;
+      }
+      const box2 region = InterleavedImageRegion(width, parity);
+      Check(region[0][1] == 0.0F && region[1][1] == 1.0F,
+            "rows are not interleaved");
+      const float extent = region[1][0] - region[0][0];
+      for (std::uint32_t j = 0; j < half_width; ++j) {
+        const float center =
+            region[0][0] + (static_cast<float>(j) + 0.5F) * extent /
+                               static_cast<float>(half_width);
+        const float column =
+            (static_cast<float>(2 * j + parity) + 0.5F) /
+            static_cast<float>(width);
+        Check(std::abs(center - column) < 1.0e-5F,
+              "half frame pixel centered on its column");
+      }
+    }
+  }
+}
+
+int main() {
+  testInterleavedWidth();
+  testImageRegionCenters();
+  return UnitTestResult();
+}
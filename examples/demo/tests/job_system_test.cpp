@@ -0,0 +1,91 @@
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include "job_system.h"
+#include "unit_test.h"
+
+static void testInlineWithoutWorkers() {
+  JobSystem jobs{0};
+  JobCounter counter{};
+  int runs{};
+  int *runs_ptr = &runs;
+  for (int i = 0; i < 10; ++i) {
+    jobs.Submit(JobPriority::kBackground, [runs_ptr] { ++*runs_ptr; },
+                &counter);
+  }
+  Check(runs == 10 && counter.Done(), "jobs run inside Submit()");
+  jobs.Wait(counter);
+  const JobSystem::Stats stats = jobs.GetStats();
+  Check(stats.inline_runs == 10, "inline runs counted");
+  Check(stats.executed[static_cast<std::size_t>(JobPriority::kBackground)] ==
+            10,
+        "executed counted");
+}
+
+// Wait() returns once every job of the counter has run, whether a worker or
+// the waiting thread ran it.
+static void testWait() {
+  JobSystem jobs{2};
+  JobCounter counter{};
+  std::atomic<int> runs{};
+  std::atomic<int> *runs_ptr = &runs;
+  constexpr int kJobs = 200;
+  for (int i = 0; i < kJobs; ++i) {
+    const JobPriority priority =
+        i % 2 == 0 ? JobPriority::kInteractive : JobPriority::kBackground;
+    jobs.Submit(
+        priority,
+        [runs_ptr] { runs_ptr->fetch_add(1, std::memory_order_relaxed); },
+        &counter);
+  }
+  jobs.Wait(counter);
+  Check(counter.Done(), "counter done after Wait()");
+  Check(runs.load() == kJobs, "every job ran once");
+  const JobSystem::Stats stats = jobs.GetStats();
+  Check(stats.executed[0] + stats.executed[1] == kJobs, "executed counted");
+  Check(stats.inline_runs == 0, "nothing ran inline");
+}
+
+struct StealState final {
+  JobSystem *jobs;
+  JobCounter children;
+  std::atomic<int> child_runs;
+};
+
+// The parent queues its children on the deque of its own thread and keeps
+// that thread busy until they have run, so the other thread has to steal
+// both, whichever of them runs the parent.
+static void testSteal() {
+  JobSystem jobs{1};
+  StealState state{&jobs, {}, {}};
+  StealState *state_ptr = &state;
+  JobCounter parent{};
+  jobs.Submit(
+      JobPriority::kInteractive,
+      [state_ptr] {
+        for (int i = 0; i < 2; ++i) {
+          state_ptr->jobs->Submit(
+              JobPriority::kInteractive,
+              [state_ptr] {
+                state_ptr->child_runs.fetch_add(1, std::memory_order_relaxed);
+              },
+              &state_ptr->children);
+        }
+        while (!state_ptr->children.Done()) {
+          std::this_thread::yield();
+        }
+      },
+      &parent);
+  jobs.Wait(parent);
+  Check(state.children.Done() && state.child_runs.load() == 2,
+        "children ran");
+  Check(jobs.GetStats().stolen >= 2, "children were stolen");
+}
+
+int main() {
+  testInlineWithoutWorkers();
+  testWait();
+  testSteal();
+  return UnitTestResult();
+}
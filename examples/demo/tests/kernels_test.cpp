@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "cpu_features.h"
+#include "kernels.h"
+#include "unit_test.h"
+
+// CTest skips the test with this exit code
+constexpr int kSkipped = 77;
+
+// Row widths covering empty rows, the scalar tails after every vector width
+// and rows long enough for the main loops
+constexpr std::size_t kWidths[] = {0,  1,  2,  3,  4,  5,  7,  8,   9,   15,
+                                   16, 17, 31, 32, 33, 63, 64, 65, 127, 1021};
+
+// Inputs start one element into their buffers so vector loads are not
+// aligned, and outputs get a guard element past the end.
+constexpr std::size_t kOffset = 1;
+constexpr std::uint32_t kGuard = 0xDEADBEEFU;
+
+static std::mt19937 rng{20240611};
+
+static std::vector<std::uint8_t> randomBytes(std::size_t n) {
+  std::uniform_int_distribution<int> byte{0, 255};
+  std::vector<std::uint8_t> bytes(n + kOffset);
+  for (auto &b : bytes) {
+    b = static_cast<std::uint8_t>(byte(rng));
+  }
+  return bytes;
+}
+
+static std::vector<std::uint32_t> randomWords(std::size_t n,
+                                              std::uint32_t max = ~0U) {
+  std::uniform_int_distribution<std::uint32_t> word{0, max};
+  std::vector<std::uint32_t> words(n + kOffset);
+  for (auto &w : words) {
+    w = word(rng);
+  }
+  return words;
+}
+
+// Mostly in [lo, hi], with the values the kernels treat specially mixed in
+static std::vector<float> randomFloats(std::size_t n, float lo, float hi) {
+  constexpr float kSpecial[] = {
+      std::numeric_limits<float>::quiet_NaN(),
+      std::numeric_limits<float>::infinity(),
+      -std::numeric_limits<float>::infinity(),
+      std::numeric_limits<float>::denorm_min(),
+      -0.0F,
+      0.0F,
+      0.0031308F,
+      1.0F,
+  };
+  std::uniform_real_distribution<float> value{lo, hi};
+  std::uniform_int_distribution<int> pick{0, 15};
+  std::vector<float> floats(n + kOffset);
+  for (auto &f : floats) {
+    const int special = pick(rng);
+    f = special < 8 ? kSpecial[special] : value(rng);
+  }
+  return floats;
+}
+
+static void checkSame(const std::vector<std::uint32_t> &actual,
+                      const std::vector<std::uint32_t> &expected,
+                      const char *kernel, std::size_t n) {
+  for (std::size_t i = 0; i < actual.size(); ++i) {
+    if (actual[i] != expected[i]) {
+      std::printf("Error: %s differs from scalar at pixel %zu of %zu: "
+                  "%08x, expected %08x\n",
+                  kernel, i, n, actual[i], expected[i]);
+      Check(false, kernel);
+      return;
+    }
+  }
+}
+
+static std::vector<std::uint32_t> output(std::size_t n) {
+  return std::vector<std::uint32_t>(n + 1, kGuard);
+}
+
+static void testDifferences(const Kernels &k, const Kernels &scalar,
+                            std::size_t n) {
+  const auto a = randomBytes(n);
+  const auto b = randomBytes(n);
+  Check(k.sum_abs_diff_u8(a.data() + kOffset, b.data() + kOffset, n) ==
+            scalar.sum_abs_diff_u8(a.data() + kOffset, b.data() + kOffset,
+                                   n),
+        "sum_abs_diff_u8");
+  Check(k.sum_sq_diff_u8(a.data() + kOffset, b.data() + kOffset, n) ==
+            scalar.sum_sq_diff_u8(a.data() + kOffset, b.data() + kOffset, n),
+        "sum_sq_diff_u8");
+}
+
+// Largest differences over more bytes than narrow accumulators hold
+static void testDifferenceOverflow(const Kernels &k) {
+  constexpr std::size_t kBytes = (1U << 17) + 3;
+  const std::vector<std::uint8_t> zeros(kBytes, 0);
+  const std::vector<std::uint8_t> ones(kBytes, 255);
+  Check(k.sum_abs_diff_u8(zeros.data(), ones.data(), kBytes) ==
+            std::uint64_t{255} * kBytes,
+        "sum_abs_diff_u8 without overflow");
+  Check(k.sum_sq_diff_u8(ones.data(), zeros.data(), kBytes) ==
+            std::uint64_t{255 * 255} * kBytes,
+        "sum_sq_diff_u8 without overflow");
+}
+
+static void testConversions(const Kernels &k, const Kernels &scalar,
+                            std::size_t n) {
+  auto actual = output(n);
+  auto expected = output(n);
+
+  const auto words = randomWords(n);
+  k.rgba8_to_rgba8(words.data() + kOffset, actual.data(), n);
+  scalar.rgba8_to_rgba8(words.data() + kOffset, expected.data(), n);
+  checkSame(actual, expected, "rgba8_to_rgba8", n);
+
+  const auto colors = randomFloats(4 * n, -0.25F, 1.25F);
+  k.rgba32f_to_rgba8(colors.data() + kOffset, actual.data(), n);
+  scalar.rgba32f_to_rgba8(colors.data() + kOffset, expected.data(), n);
+  checkSame(actual, expected, "rgba32f_to_rgba8", n);
+
+  const auto depths = randomFloats(n, 0.5F, 20.0F);
+  k.depth_to_rgba8(depths.data() + kOffset, actual.data(), n, 1.0F, 10.0F);
+  scalar.depth_to_rgba8(depths.data() + kOffset, expected.data(), n, 1.0F,
+                        10.0F);
+  checkSame(actual, expected, "depth_to_rgba8", n);
+
+  auto ids = randomWords(n, 64);
+  for (auto &id : ids) {
+    id = id == 64 ? ~0U : id;
+  }
+  k.id_to_rgba8(ids.data() + kOffset, actual.data(), n);
+  scalar.id_to_rgba8(ids.data() + kOffset, expected.data(), n);
+  checkSame(actual, expected, "id_to_rgba8", n);
+}
+
+static void testBlending(const Kernels &k, const Kernels &scalar,
+                         std::size_t n) {
+  const auto overlay = randomWords(n);
+  const auto overlay_depth = randomFloats(n, 0.0F, 10.0F);
+  const auto scene_depth = randomFloats(n, 0.0F, 10.0F);
+  const auto base = randomWords(n);
+  auto actual = output(n);
+  std::copy(base.begin() + kOffset, base.end(), actual.begin());
+  auto expected = actual;
+  k.composite_overlay_rgba8(overlay.data() + kOffset,
+                            overlay_depth.data() + kOffset,
+                            scene_depth.data() + kOffset, actual.data(), n);
+  scalar.composite_overlay_rgba8(
+      overlay.data() + kOffset, overlay_depth.data() + kOffset,
+      scene_depth.data() + kOffset, expected.data(), n);
+  checkSame(actual, expected, "composite_overlay_rgba8", n);
+
+  const auto src = randomWords(n);
+  const auto weight = randomWords(n, 256);
+  k.blend_rgba8(src.data() + kOffset, weight.data() + kOffset, 200,
+                actual.data(), n);
+  scalar.blend_rgba8(src.data() + kOffset, weight.data() + kOffset, 200,
+                     expected.data(), n);
+  checkSame(actual, expected, "blend_rgba8", n);
+
+  // Upscaling a row of half the width
+  const std::size_t src_n = n / 2 + 1;
+  const auto row0 = randomWords(src_n);
+  const auto row1 = randomWords(src_n);
+  std::vector<std::uint32_t> x0(n);
+  std::vector<std::uint32_t> x1(n);
+  const auto wx = randomWords(n, 256);
+  for (std::size_t i = 0; i < n; ++i) {
+    x0[i] = static_cast<std::uint32_t>(i / 2);
+    x1[i] = static_cast<std::uint32_t>(std::min(i / 2 + 1, src_n - 1));
+  }
+  k.bilinear_row_rgba8(row0.data() + kOffset, row1.data() + kOffset, 77,
+                       x0.data(), x1.data(), wx.data() + kOffset,
+                       actual.data(), n);
+  scalar.bilinear_row_rgba8(row0.data() + kOffset, row1.data() + kOffset, 77,
+                            x0.data(), x1.data(), wx.data() + kOffset,
+                            expected.data(), n);
+  checkSame(actual, expected, "bilinear_row_rgba8", n);
+
+  const auto history = randomWords(n);
+  for (std::uint32_t parity = 0; parity < 2; ++parity) {
+    const auto half = randomWords((n + 1 - parity) / 2);
+    k.reconstruct_interleaved_rgba8(half.data() + kOffset,
+                                    history.data() + kOffset, actual.data(),
+                                    n, parity);
+    scalar.reconstruct_interleaved_rgba8(half.data() + kOffset,
+                                         history.data() + kOffset,
+                                         expected.data(), n, parity);
+    checkSame(actual, expected, "reconstruct_interleaved_rgba8", n);
+  }
+}
+
+static void testMinMax(const Kernels &k, const Kernels &scalar,
+                       std::size_t n) {
+  const auto values = randomFloats(n, -100.0F, 100.0F);
+  float min = std::numeric_limits<float>::infinity();
+  float max = -std::numeric_limits<float>::infinity();
+  float expected_min = min;
+  float expected_max = max;
+  k.finite_min_max_f32(values.data() + kOffset, n, &min, &max);
+  scalar.finite_min_max_f32(values.data() + kOffset, n, &expected_min,
+                            &expected_max);
+  Check(min == expected_min && max == expected_max, "finite_min_max_f32");
+}
+
+// Compares the kernels of the level forced with ANARI_PROJECT_SIMD, or of
+// the best level of the machine, with the scalar ones. Skipped if the
+// forced level is not available here.
+int main() {
+  const Kernels &k = GetKernels();
+  const Kernels &scalar = *GetKernelsFor(SimdLevel::kScalar);
+  SimdLevel requested = k.level;
+  if (const char *env = std::getenv("ANARI_PROJECT_SIMD")) {
+    if (!ParseSimdLevel(env, requested)) {
+      std::printf("Error: Unknown ANARI_PROJECT_SIMD=%s\n", env);
+      return EXIT_FAILURE;
+    }
+  }
+  if (k.level != requested) {
+    std::printf("Info: No %s kernels on this machine, skipping\n",
+                SimdLevelName(requested));
+    return kSkipped;
+  }
+  std::printf("Info: Testing %s kernels\n", SimdLevelName(k.level));
+
+  for (const std::size_t n : kWidths) {
+    testDifferences(k, scalar, n);
+    testConversions(k, scalar, n);
+    testBlending(k, scalar, n);
+    testMinMax(k, scalar, n);
+  }
+  testDifferenceOverflow(k);
+  return UnitTestResult();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <source_location>
+
+// Checks of the unit tests in tests/, plain executables run by CTest. A
+// failed check is reported and the test keeps going, UnitTestResult() at
+// the end of main() fails it.
+
+inline int &UnitTestFailures() {
+  static int failures{};
+  return failures;
+}
+
+inline void Check(bool condition, const char *what,
+                  std::source_location location =
+                      std::source_location::current()) {
+  if (!condition) {
+    std::printf("Error: Check failed at %s:%u: %s\n", location.file_name(),
+                static_cast<unsigned>(location.line()), what);
+    ++UnitTestFailures();
+  }
+}
+
+inline int UnitTestResult() {
+  if (UnitTestFailures() != 0) {
+    std::printf("%d checks failed\n", UnitTestFailures());
+    return EXIT_FAILURE;
+  }
+  std::printf("All checks passed\n");
+  return EXIT_SUCCESS;
+}
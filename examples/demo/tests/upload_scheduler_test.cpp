@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <vector>
+
+#include "async_task.h"
+#include "unit_test.h"
+#include "upload_scheduler.h"
+
+static Task<> recordUpload(UploadScheduler &scheduler, UploadRequest request,
+                           int id, std::vector<int> &order) {
+  co_await scheduler.Upload(request);
+  order.push_back(id);
+}
+
+// Queues the uploads in order, ids are their indices.
+static std::vector<Task<>>
+queueUploads(UploadScheduler &scheduler,
+             const std::vector<UploadRequest> &requests,
+             std::vector<int> &order) {
+  std::vector<Task<>> tasks{};
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    tasks.push_back(recordUpload(scheduler, requests[i], static_cast<int>(i),
+                                 order));
+    tasks.back().Start();
+  }
+  return tasks;
+}
+
+// Visible before hidden, then by screen coverage, then oldest first.
+static void testImportanceOrder() {
+  UploadScheduler scheduler{};
+  std::vector<int> order{};
+  auto tasks = queueUploads(scheduler,
+                            {
+                                {.visible = false, .screen_coverage = 0.9F},
+                                {.visible = true, .screen_coverage = 0.1F},
+                                {.visible = true, .screen_coverage = 0.5F},
+                                {.visible = true, .screen_coverage = 0.5F},
+                                {.visible = false, .screen_coverage = 0.0F},
+                            },
+                            order);
+  Check(order.empty(), "uploads wait for RunFrame()");
+  Check(scheduler.GetStats().queued == 5, "all uploads queued");
+  Check(scheduler.RunFrame() == 5, "all uploads fit the default budget");
+  Check(order == std::vector<int>{2, 3, 1, 0, 4}, "importance order");
+  Check(scheduler.GetStats().queued == 0, "queue drained");
+}
+
+// Later, smaller uploads fill what a large one left of the byte budget, and
+// an upload larger than the whole budget runs alone.
+static void testBytePacking() {
+  UploadScheduler scheduler{{.bytes = 100, .commits = 16}};
+  std::vector<int> order{};
+  auto tasks = queueUploads(scheduler,
+                            {
+                                {.bytes = 60, .commits = 1},
+                                {.bytes = 50, .commits = 1},
+                                {.bytes = 40, .commits = 1},
+                                {.bytes = 200, .commits = 1},
+                            },
+                            order);
+  Check(scheduler.EstimateDrain().frames == 3, "drain estimate in frames");
+
+  Check(scheduler.RunFrame() == 2, "first frame packs two uploads");
+  Check(order == std::vector<int>{0, 2}, "smaller upload fills the budget");
+  const UploadScheduler::Stats stats = scheduler.GetStats();
+  Check(stats.frame_bytes == 100 && stats.frame_commits == 2,
+        "frame totals");
+  Check(stats.queued == 2 && stats.queued_bytes == 250, "queue totals");
+  Check(stats.deferred == 2, "deferred uploads counted");
+
+  Check(scheduler.RunFrame() == 1, "second frame");
+  Check(scheduler.RunFrame() == 1, "oversized upload runs alone");
+  Check(order == std::vector<int>{0, 2, 1, 3}, "packing order");
+  Check(scheduler.RunFrame() == 0, "nothing left");
+  Check(scheduler.GetStats().applied == 4, "applied count");
+}
+
+static void testCommitBudget() {
+  UploadScheduler scheduler{{.bytes = 1024, .commits = 2}};
+  std::vector<int> order{};
+  auto tasks = queueUploads(scheduler,
+                            {
+                                {.commits = 1},
+                                {.commits = 2},
+                                {.commits = 1},
+                                {.commits = 5},
+                            },
+                            order);
+  Check(scheduler.RunFrame() == 2, "commit budget of the first frame");
+  Check(order == std::vector<int>{0, 2}, "commits packed like bytes");
+  Check(scheduler.RunFrame() == 1, "second frame");
+  Check(scheduler.RunFrame() == 1, "oversized commits run alone");
+  Check(order == std::vector<int>{0, 2, 1, 3}, "commit packing order");
+}
+
+static void testFlush() {
+  UploadScheduler scheduler{{.bytes = 1, .commits = 1}};
+  std::vector<int> order{};
+  auto tasks = queueUploads(
+      scheduler, std::vector<UploadRequest>(4, {.bytes = 8, .commits = 4}),
+      order);
+  scheduler.Flush();
+  Check(order.size() == 4, "Flush() ignores the budget");
+  for (const Task<> &task : tasks) {
+    Check(task.Done(), "flushed upload done");
+  }
+  const UploadScheduler::Stats stats = scheduler.GetStats();
+  Check(stats.queued == 0 && stats.queued_bytes == 0 &&
+            stats.queued_commits == 0,
+        "queue totals after Flush()");
+}
+
+int main() {
+  testImportanceOrder();
+  testBytePacking();
+  testCommitBudget();
+  testFlush();
+  return UnitTestResult();
+}
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "capture.h"
+#include "frame_pipeline.h"
+#include "frame_view.h"
+#include "golden_check.h"
+#include "headless_engine.h"
+#include "kernels.h"
+#include "math_types.h"
+#include "memory_stats.h"
+#include "render_system.h"
+#include "thread_placement.h"
+
+struct Options final {
+  // Directory of golden images and the performance budget
+  const char *dir{};
+  // Writes golden images and the budget instead of comparing them
+  bool record{};
+  // Fails instead of skipping when nothing is recorded in dir, for CI
+  bool require_golden{};
+  // Needs a device that renders the same image on every machine
+  const char *library{"helide"};
+  uvec2 size{kDefaultFrameSize};
+  // Timed frames per scene
+  int frames{120};
+  EngineOptions engine{};
+};
+
+static void printUsage() {
+  std::printf(
+      "Usage: demo_check [options] <dir>\n"
+      "Renders reference scenes without a window and fails on differences to\n"
+      "the golden images or frame time and memory over the budget in <dir>.\n"
+      "  --record              write the golden images and the budget\n"
+      "                        instead\n"
+      "  --require-golden      fail rather than skip if nothing is\n"
+      "                        recorded in <dir> yet\n"
+      "  --library <name>      ANARI library (default helide)\n"
+      "  --size <w>x<h>        frame size (default 640x480)\n"
+      "  --frames <n>          timed frames per scene (default 120)\n");
+  PrintEngineUsage();
+}
+
+static bool parseOptions(int argc, const char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (std::strcmp(arg, "--record") == 0) {
+      options.record = true;
+    } else if (std::strcmp(arg, "--require-golden") == 0) {
+      options.require_golden = true;
+    } else if (std::strcmp(arg, "--library") == 0 && value != nullptr) {
+      options.library = value;
+      ++i;
+    } else if (std::strcmp(arg, "--size") == 0 && value != nullptr &&
+               std::sscanf(value, "%ux%u", &options.size[0],
+                           &options.size[1]) == 2 &&
+               options.size[0] > 0 && options.size[1] > 0) {
+      ++i;
+    } else if (std::strcmp(arg, "--frames") == 0 && value != nullptr) {
+      options.frames = std::max(1, std::atoi(value));
+      ++i;
+    } else if (ParseEngineOption(arg, value, options.engine)) {
+      ++i;
+    } else if (arg[0] != '-' && options.dir == nullptr) {
+      options.dir = arg;
+    } else {
+      std::printf("Error: Unknown or invalid option %s\n", arg);
+      printUsage();
+      return false;
+    }
+  }
+  if (options.dir == nullptr) {
+    std::printf("Error: No golden image directory\n");
+    printUsage();
+    return false;
+  }
+  return true;
+}
+
+// Views of the demo scene rendered by the check. The camera does not move
+// within a scene, so the image is the same every frame.
+struct CheckScene final {
+  const char *name;
+  RenderMode mode;
+  // Animation time of the camera pose
+  float time;
+};
+
+constexpr std::array<CheckScene, 4> kCheckScenes{{
+    {"full", RenderMode::kFull, 0.0F},
+    {"full-raised", RenderMode::kFull, 0.5F},
+    {"foveated", RenderMode::kFoveated, 0.0F},
+    {"interleaved", RenderMode::kInterleaved, 0.0F},
+}};
+// Frames rendered before a scene is timed, buffers and caches settle first
+constexpr int kCheckWarmupFrames = 8;
+// Margins of recorded budgets over the measurement. Frame times vary more
+// between runs and machines than memory does.
+constexpr double kFrameBudgetHeadroom = 1.5;
+constexpr double kMemoryBudgetHeadroom = 1.2;
+
+// A metric fails only if its whole confidence interval is over budget. One
+// that is over budget within the noise is reported but passes, rerun with
+// more --frames to settle it.
+static bool checkBudget(const PerfBudget &budget, const std::string &key,
+                        const SampleSummary &summary) {
+  const double limit = budget.Get(key);
+  if (limit < 0.0) {
+    std::printf("  %s: median=%.3f, no budget\n", key.c_str(),
+                summary.median);
+    return true;
+  }
+  const bool over = summary.low > limit;
+  const char *verdict = over                     ? "FAIL"
+                        : summary.median > limit ? "ok within noise"
+                                                 : "ok";
+  std::printf("  %s %s: median=%.3f [%.3f, %.3f] budget=%.3f\n", key.c_str(),
+              verdict, summary.median, summary.low, summary.high, limit);
+  return !over;
+}
+
+// Exit code when there are neither golden images nor a budget to compare
+// against, CTest reports the check as skipped rather than failed
+constexpr int kSkipExitCode = 77;
+
+// Renders kCheckScenes headlessly and compares them to golden images and a
+// performance budget, or records both. Returns a non-zero exit code on any
+// failure, for CI, and kSkipExitCode if nothing was recorded in the
+// directory yet, unless golden images are required.
+static int runCheck(const Options &options) {
+  std::printf("Check: %s library=%s size=%ux%u frames=%d\n",
+              options.record ? "recording" : "comparing", options.library,
+              options.size[0], options.size[1], options.frames);
+
+  const std::filesystem::path dir{options.dir};
+  const std::filesystem::path budget_path = dir / "budget.txt";
+  PerfBudget budget{};
+  if (options.record) {
+    std::error_code error{};
+    std::filesystem::create_directories(dir, error);
+  } else if (!budget.Load(budget_path.c_str())) {
+    std::error_code error{};
+    const bool has_golden =
+        std::any_of(kCheckScenes.begin(), kCheckScenes.end(),
+                    [&](const CheckScene &scene) {
+                      return std::filesystem::exists(
+                          dir / (std::string{scene.name} + ".png"), error);
+                    });
+    if (!has_golden && options.require_golden) {
+      std::printf("Error: Nothing recorded in %s, record it with --record\n",
+                  dir.c_str());
+      return EXIT_FAILURE;
+    }
+    if (!has_golden) {
+      std::printf("WARNING: Nothing recorded in %s yet, record it with "
+                  "--record\n",
+                  dir.c_str());
+      return kSkipExitCode;
+    }
+    std::printf("WARNING: No budget at %s, only images are checked\n",
+                budget_path.c_str());
+  }
+
+  HeadlessEngine engine{options.engine, options.library};
+  RenderSystem &rs = engine.rs;
+  FramePipeline &pipeline = engine.pipeline;
+  const vec2 center{static_cast<float>(options.size[0]) * 0.5F,
+                    static_cast<float>(options.size[1]) * 0.5F};
+  const ImageTolerance tolerance{};
+
+  int failures{};
+  std::vector<double> frame_ms{};
+  frame_ms.reserve(static_cast<std::size_t>(options.frames));
+  for (const CheckScene &scene : kCheckScenes) {
+    frame_ms.clear();
+    FrameView<std::uint32_t> image{};
+    for (int i = 0; i < kCheckWarmupFrames + options.frames; ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      pipeline.Prepare(scene.mode, options.size, center);
+      rs.AnimateCamera(scene.time);
+      rs.RenderFrame();
+      image = pipeline.Assemble("channel.color", nullptr);
+      if (i >= kCheckWarmupFrames) {
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+      }
+    }
+
+    const std::filesystem::path golden_path =
+        dir / (std::string{scene.name} + ".png");
+    const std::string frame_key = std::string{scene.name} + ".frame_ms";
+    const SampleSummary timing = Summarize(frame_ms);
+    if (options.record) {
+      if (!WriteCapturePng(golden_path.c_str(), image)) {
+        std::printf("Error: Cannot write %s\n", golden_path.c_str());
+        ++failures;
+      }
+      budget.Set(frame_key, timing.high * kFrameBudgetHeadroom);
+      std::printf("  %s: recorded, frame ms median=%.3f [%.3f, %.3f]\n",
+                  scene.name, timing.median, timing.low, timing.high);
+      continue;
+    }
+
+    GoldenImage golden{};
+    if (!golden.Load(golden_path.c_str())) {
+      std::printf("  %s image FAIL: no golden image at %s\n", scene.name,
+                  golden_path.c_str());
+      ++failures;
+    } else {
+      const ImageComparison comparison = CompareImages(
+          image, golden.View(), tolerance.bad_pixel_threshold);
+      const bool passed = WithinTolerance(comparison, tolerance);
+      if (!comparison.size_matches) {
+        std::printf("  %s image FAIL: %ux%u, golden image is %ux%u\n",
+                    scene.name, image.Width(), image.Height(),
+                    golden.View().Width(), golden.View().Height());
+      } else {
+        std::printf("  %s image %s: mae=%.4f psnr=%.2f dB bad pixels=%.3f%%\n",
+                    scene.name, passed ? "ok" : "FAIL", comparison.mae,
+                    comparison.psnr_db, comparison.bad_pixel_fraction * 100.0);
+      }
+      if (!passed) {
+        // Next to the golden image for a side by side look
+        const std::filesystem::path actual_path =
+            dir / (std::string{scene.name} + ".actual.png");
+        WriteCapturePng(actual_path.c_str(), image);
+        ++failures;
+      }
+    }
+    failures += checkBudget(budget, frame_key, timing) ? 0 : 1;
+  }
+
+  // Memory is deterministic enough for single values
+  const double peak_rss_mb =
+      static_cast<double>(ReadProcessMemory().peak_rss_bytes) /
+      (1024.0 * 1024.0);
+  const double array_mb =
+      static_cast<double>(rs.Arrays().TotalBytes()) / (1024.0 * 1024.0);
+  if (options.record) {
+    budget.Set("peak_rss_mb", peak_rss_mb * kMemoryBudgetHeadroom);
+    budget.Set("anari_array_mb", array_mb * kMemoryBudgetHeadroom);
+    std::printf("  memory: recorded, peak rss=%.1f MB anari arrays=%.2f MB\n",
+                peak_rss_mb, array_mb);
+    if (!budget.Save(budget_path.c_str())) {
+      std::printf("Error: Cannot write %s\n", budget_path.c_str());
+      ++failures;
+    }
+  } else {
+    for (const auto &[key, value] :
+         {std::pair{"peak_rss_mb", peak_rss_mb},
+          std::pair{"anari_array_mb", array_mb}}) {
+      failures +=
+          checkBudget(budget, key, {.count = 1,
+                                    .median = value,
+                                    .low = value,
+                                    .high = value})
+              ? 0
+              : 1;
+    }
+  }
+
+  std::printf("Check: %d failure%s\n", failures, failures == 1 ? "" : "s");
+  return failures > 0 ? EXIT_FAILURE : 0;
+}
+
+int main(int argc, const char **argv) {
+  AllocScope app_scope{AllocSubsystem::kApp};
+
+  Options options{};
+  if (!parseOptions(argc, argv, options)) {
+    return EXIT_FAILURE;
+  }
+  std::printf("Info: Using %s SIMD kernels\n",
+              SimdLevelName(GetKernels().level));
+  SetThreadPlacements(options.engine.thread_placements);
+  return runCheck(options);
+}
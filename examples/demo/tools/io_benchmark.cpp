@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "async_loader.h"
+#include "async_task.h"
+#include "headless_engine.h"
+#include "io_ring.h"
+#include "job_system.h"
+#include "thread_placement.h"
+
+struct Options final {
+  // Directory whose files are read
+  const char *dir{};
+  EngineOptions engine{};
+};
+
+static void printUsage() {
+  std::printf(
+      "Usage: demo_io_benchmark [options] <dir>\n"
+      "Reads every file under <dir> with each I/O backend of the loader and\n"
+      "reports files/s and MB/s. Of the thread roles, jobs and io apply.\n");
+  PrintEngineUsage();
+}
+
+static bool parseOptions(int argc, const char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (ParseEngineOption(arg, value, options.engine)) {
+      ++i;
+    } else if (arg[0] != '-' && options.dir == nullptr) {
+      options.dir = arg;
+    } else {
+      std::printf("Error: Unknown or invalid option %s\n", arg);
+      printUsage();
+      return false;
+    }
+  }
+  if (options.dir == nullptr) {
+    std::printf("Error: No directory to read\n");
+    printUsage();
+    return false;
+  }
+  return true;
+}
+
+// Passes per backend and page cache state of the I/O benchmark
+constexpr int kIoBenchmarkRuns = 3;
+
+static Task<std::size_t> readFileSize(AsyncLoader &loader, std::string path) {
+  std::optional<FileData> data =
+      co_await loader.ReadFile(std::move(path), nullptr);
+  co_return data ? data->size() : 0;
+}
+
+// Reads every file under the directory given at once through AsyncLoader, with
+// the io_uring and the thread backends, cold (evicted from the page cache
+// first) and warm. Reports the median of kIoBenchmarkRuns passes. Nothing is
+// decoded, this is the I/O alone.
+static int runIoBenchmark(const Options &options) {
+  std::vector<std::string> paths{};
+  std::error_code error{};
+  for (const auto &entry : std::filesystem::recursive_directory_iterator{
+           options.dir, error}) {
+    if (entry.is_regular_file(error)) {
+      paths.push_back(entry.path().string());
+    }
+  }
+  if (paths.empty()) {
+    std::printf("Error: No files to read under %s\n",
+                options.dir);
+    return EXIT_FAILURE;
+  }
+  std::printf("I/O benchmark: %zu files under %s, median of %d runs\n",
+              paths.size(), options.dir, kIoBenchmarkRuns);
+  std::printf("  %-9s %-5s %12s %10s\n", "backend", "cache", "files/s",
+              "MB/s");
+
+  JobSystem jobs{options.engine.JobWorkers()};
+  std::vector<Task<std::size_t>> tasks{};
+  tasks.reserve(paths.size());
+  for (const IoBackend backend : {IoBackend::kRing, IoBackend::kThreads}) {
+    AsyncLoader loader{jobs, backend};
+    if (loader.Backend() != backend) {
+      std::printf("  %-9s not available\n", IoBackendName(backend));
+      continue;
+    }
+    for (const bool cold : {true, false}) {
+      std::vector<double> seconds{};
+      std::size_t bytes{};
+      for (int run = 0; run < kIoBenchmarkRuns; ++run) {
+        if (cold) {
+          for (const std::string &path : paths) {
+            EvictFromPageCache(path.c_str());
+          }
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::string &path : paths) {
+          tasks.push_back(readFileSize(loader, path));
+          loader.Start(tasks.back());
+        }
+        bytes = 0;
+        for (Task<std::size_t> &task : tasks) {
+          bytes += loader.Wait(task);
+        }
+        seconds.push_back(std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+        tasks.clear();
+      }
+      std::sort(seconds.begin(), seconds.end());
+      const double median = seconds[seconds.size() / 2];
+      std::printf("  %-9s %-5s %12.0f %10.1f\n", IoBackendName(backend),
+                  cold ? "cold" : "warm",
+                  static_cast<double>(paths.size()) / median,
+                  static_cast<double>(bytes) / 1.0e6 / median);
+    }
+  }
+  std::printf("  cold evicts the files with posix_fadvise() before each "
+              "pass, dirty pages and other platforms stay cached\n");
+  return 0;
+}
+
+int main(int argc, const char **argv) {
+  AllocScope app_scope{AllocSubsystem::kApp};
+
+  Options options{};
+  if (!parseOptions(argc, argv, options)) {
+    return EXIT_FAILURE;
+  }
+  SetThreadPlacements(options.engine.thread_placements);
+  return runIoBenchmark(options);
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "job_system.h"
+#include "thread_placement.h"
+
+struct Options final {
+  // Most worker threads measured, JobSystem::DefaultWorkers() if 0
+  unsigned job_workers{};
+  // CPUs, NUMA node and priority of the threads of each role
+  ThreadPlacements thread_placements{};
+};
+
+static void printUsage() {
+  std::printf(
+      "Usage: demo_job_benchmark [options]\n"
+      "Measures job system throughput and interactive job latency with 1,\n"
+      "2, 4, ... workers. Of the thread roles, main and jobs apply.\n"
+      "  --workers <n>         most worker threads (default half of the\n"
+      "                        hardware threads)\n");
+  PrintThreadUsage();
+}
+
+static bool parseOptions(int argc, const char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (std::strcmp(arg, "--workers") == 0 && value != nullptr &&
+        std::atoi(value) > 0) {
+      options.job_workers = static_cast<unsigned>(std::atoi(value));
+      ++i;
+    } else if (ParseThreadOption(arg, value, options.thread_placements)) {
+      ++i;
+    } else {
+      std::printf("Error: Unknown or invalid option %s\n", arg);
+      printUsage();
+      return false;
+    }
+  }
+  return true;
+}
+
+// Stand-in for a small piece of CPU work, a few hundred nanoseconds
+static std::uint64_t jobWork(std::uint64_t seed, int iterations) {
+  for (int i = 0; i < iterations; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+  }
+  return seed;
+}
+
+// Jobs per throughput run of the job benchmark
+constexpr std::uint32_t kBenchmarkJobs = 200000;
+// Jobs submitted from the main thread before waiting, below the capacity of
+// the queues so nothing runs inline
+constexpr std::uint32_t kBenchmarkBatch = 128;
+
+// Runs out[i] = jobWork(...) for [first, last) by halving the range and
+// submitting the upper halves, the usual fork-join shape that work stealing
+// is made for. Queues stay log2(n) deep.
+static void splitJobs(JobSystem &jobs, JobCounter &counter, std::uint64_t *out,
+                      std::uint32_t first, std::uint32_t last) {
+  while (last - first > 1) {
+    const std::uint32_t middle = first + (last - first) / 2;
+    JobSystem *system = &jobs;
+    JobCounter *group = &counter;
+    jobs.Submit(
+        JobPriority::kInteractive,
+        [system, group, out, middle, last] {
+          splitJobs(*system, *group, out, middle, last);
+        },
+        &counter);
+    last = middle;
+  }
+  out[first] = jobWork(first + 1, 64);
+}
+
+// Background backlog of the latency phase. Each job submits its successor
+// before it finishes, so every worker stays busy while the deques hold a
+// few entries only. Queued up front, the backlog would overflow
+// JobSystem::kQueueCapacity and run inline on the submitting thread.
+struct BackgroundChain final {
+  JobSystem *jobs{};
+  JobCounter *counter{};
+  std::uint64_t *out{};
+  // Jobs still to submit, below zero once all are
+  std::atomic<std::int64_t> remaining{};
+};
+
+static void submitChained(BackgroundChain &chain) {
+  const std::int64_t left =
+      chain.remaining.fetch_sub(1, std::memory_order_relaxed);
+  if (left <= 0) {
+    return;
+  }
+  BackgroundChain *link = &chain;
+  const auto index = static_cast<std::uint32_t>(left - 1);
+  chain.jobs->Submit(
+      JobPriority::kBackground,
+      [link, index] {
+        // About 20 us
+        link->out[index] = jobWork(index + 1, 8000);
+        submitChained(*link);
+      },
+      chain.counter);
+}
+
+struct JobLatencySample final {
+  std::chrono::steady_clock::time_point submitted{};
+  std::chrono::steady_clock::time_point started{};
+};
+
+// Measures the job system with tiny jobs, where its own overhead dominates,
+// for 1, 2, 4, ... up to --workers workers:
+// - flat: the main thread submits batches and waits for them
+// - nested: jobs split the work recursively and submit from the workers,
+//   which exercises stealing
+// - latency: interactive jobs submitted while the workers are busy with a
+//   long background backlog, from submission to start, see BackgroundChain
+static int runJobBenchmark(const Options &options) {
+  const unsigned max_workers = options.job_workers != 0
+                                    ? options.job_workers
+                                    : JobSystem::DefaultWorkers();
+  std::printf("Job benchmark: %u jobs per run, up to %u workers\n",
+              kBenchmarkJobs, max_workers);
+  std::printf("  %7s %14s %14s %8s %8s %14s %14s %10s\n", "workers",
+              "flat jobs/s", "nested jobs/s", "stolen", "inline",
+              "interact p50us", "interact p99us", "lat inline");
+
+  std::vector<std::uint64_t> results(kBenchmarkJobs);
+  std::vector<JobLatencySample> latencies(200);
+  for (unsigned workers = 1;; workers = std::min(workers * 2, max_workers)) {
+    JobSystem jobs{workers};
+    std::uint64_t *out = results.data();
+    const auto seconds_since = [](std::chrono::steady_clock::time_point t) {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                           t)
+          .count();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint32_t first = 0; first < kBenchmarkJobs;
+         first += kBenchmarkBatch) {
+      JobCounter batch{};
+      const std::uint32_t last =
+          std::min(first + kBenchmarkBatch, kBenchmarkJobs);
+      for (std::uint32_t i = first; i < last; ++i) {
+        jobs.Submit(
+            JobPriority::kInteractive,
+            [out, i] { out[i] = jobWork(i + 1, 64); }, &batch);
+      }
+      jobs.Wait(batch);
+    }
+    const double flat_rate = kBenchmarkJobs / seconds_since(start);
+
+    const JobSystem::Stats before = jobs.GetStats();
+    start = std::chrono::steady_clock::now();
+    {
+      JobCounter all{};
+      splitJobs(jobs, all, out, 0, kBenchmarkJobs);
+      jobs.Wait(all);
+    }
+    const double nested_rate = kBenchmarkJobs / seconds_since(start);
+    const JobSystem::Stats after = jobs.GetStats();
+
+    // Background backlog of 200 jobs per worker, then interactive jobs
+    // trickling in
+    {
+      JobCounter background{};
+      BackgroundChain chain{.jobs = &jobs, .counter = &background, .out = out};
+      chain.remaining.store(std::int64_t{workers} * 200,
+                            std::memory_order_relaxed);
+      const unsigned chains =
+          std::min<unsigned>(workers, JobSystem::kQueueCapacity);
+      for (unsigned i = 0; i < chains; ++i) {
+        submitChained(chain);
+      }
+      JobCounter interactive{};
+      for (JobLatencySample &sample : latencies) {
+        JobLatencySample *slot = &sample;
+        sample.submitted = std::chrono::steady_clock::now();
+        jobs.Submit(
+            JobPriority::kInteractive,
+            [slot] { slot->started = std::chrono::steady_clock::now(); },
+            &interactive);
+        std::this_thread::sleep_for(std::chrono::microseconds{50});
+      }
+      jobs.Wait(interactive);
+      jobs.Wait(background);
+    }
+    const JobSystem::Stats latency_end = jobs.GetStats();
+    std::vector<double> latency_us{};
+    latency_us.reserve(latencies.size());
+    for (const JobLatencySample &sample : latencies) {
+      latency_us.push_back(std::chrono::duration<double, std::micro>(
+                               sample.started - sample.submitted)
+                               .count());
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+
+    std::printf("  %7u %14.0f %14.0f %8llu %8llu %14.1f %14.1f %10llu\n",
+                workers, flat_rate, nested_rate,
+                static_cast<unsigned long long>(after.stolen - before.stolen),
+                static_cast<unsigned long long>(after.inline_runs -
+                                                before.inline_runs),
+                latency_us[latency_us.size() / 2],
+                latency_us[latency_us.size() * 99 / 100],
+                static_cast<unsigned long long>(latency_end.inline_runs -
+                                                after.inline_runs));
+    if (workers == max_workers) {
+      break;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, const char **argv) {
+  AllocScope app_scope{AllocSubsystem::kApp};
+
+  Options options{};
+  if (!parseOptions(argc, argv, options)) {
+    return EXIT_FAILURE;
+  }
+  SetThreadPlacements(options.thread_placements);
+  return runJobBenchmark(options);
+}
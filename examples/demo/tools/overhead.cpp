@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "alloc_tracker.h"
+#include "frame_counters.h"
+#include "frame_pipeline.h"
+#include "frame_telemetry.h"
+#include "headless_engine.h"
+#include "kernels.h"
+#include "math_types.h"
+#include "render_system.h"
+#include "thread_placement.h"
+
+struct Options final {
+  // The sink device does no rendering at all
+  const char *library{"sink"};
+  RenderMode render_mode{RenderMode::kFull};
+  // Timed frames per size
+  int frames{120};
+  EngineOptions engine{};
+};
+
+static void printUsage() {
+  std::printf(
+      "Usage: demo_overhead [options]\n"
+      "Runs the frame loop on a device that does not render and reports the\n"
+      "CPU cost of the app per frame size.\n"
+      "  --library <name>      ANARI library (default sink)\n"
+      "  --render-mode <full|foveated|interleaved>  render mode\n"
+      "  --frames <n>          timed frames per size (default 120)\n");
+  PrintEngineUsage();
+}
+
+static bool parseOptions(int argc, const char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (std::strcmp(arg, "--library") == 0 && value != nullptr) {
+      options.library = value;
+      ++i;
+    } else if (std::strcmp(arg, "--render-mode") == 0 && value != nullptr &&
+               ParseRenderMode(value, options.render_mode)) {
+      ++i;
+    } else if (std::strcmp(arg, "--frames") == 0 && value != nullptr) {
+      options.frames = std::max(1, std::atoi(value));
+      ++i;
+    } else if (ParseEngineOption(arg, value, options.engine)) {
+      ++i;
+    } else {
+      std::printf("Error: Unknown or invalid option %s\n", arg);
+      printUsage();
+      return false;
+    }
+  }
+  return true;
+}
+
+// Frame sizes measured
+constexpr std::array<uvec2, 5> kOverheadSizes{{
+    {320, 240},
+    {640, 480},
+    {1280, 720},
+    {1920, 1080},
+    {3840, 2160},
+}};
+constexpr int kOverheadWarmupFrames = 10;
+
+// Runs the headless frame loop of demo --benchmark on the sink device. It
+// accepts all calls and renders nothing, so what is left is our own CPU
+// cost: parameter setting, commits, map/unmap handling and host-side
+// post-processing. Compare with demo --benchmark on a real device to see
+// whether the app itself limits the frame rate.
+static int runOverhead(const Options &options) {
+  std::printf("Overhead: library=%s mode=%s frames=%d per size\n",
+              options.library, RenderModeName(options.render_mode),
+              options.frames);
+
+  HeadlessEngine engine{options.engine, options.library};
+  RenderSystem &rs = engine.rs;
+  FramePipeline &pipeline = engine.pipeline;
+
+  FrameStageTimer stage_timer{};
+  FrameCounters frame_counters{};
+  std::vector<double> total_ms{};
+  std::array<std::vector<double>, kFrameStageCount> stage_ms{};
+  total_ms.reserve(static_cast<std::size_t>(options.frames));
+  for (auto &samples : stage_ms) {
+    samples.reserve(static_cast<std::size_t>(options.frames));
+  }
+
+  std::printf("  %-10s %9s %9s %9s %9s %9s %9s %8s %8s %10s\n", "size",
+              "median ms", "p95 ms", "prepare", "camera", "render", "assemble",
+              "commits", "allocs", "host px");
+  for (const uvec2 size : kOverheadSizes) {
+    const vec2 center{static_cast<float>(size[0]) * 0.5F,
+                      static_cast<float>(size[1]) * 0.5F};
+    total_ms.clear();
+    for (auto &samples : stage_ms) {
+      samples.clear();
+    }
+    std::uint64_t commits{};
+    std::uint64_t allocations{};
+    std::uint64_t host_pixels{};
+    for (int i = 0; i < kOverheadWarmupFrames + options.frames; ++i) {
+      const float time = static_cast<float>(i) / 60.0F;
+      FrameTelemetry telemetry{};
+      frame_counters.Begin(rs);
+      stage_timer.Begin();
+      pipeline.Prepare(options.render_mode, size, center);
+      stage_timer.Mark(FrameStage::kPrepare, telemetry);
+      rs.AnimateCamera(time);
+      stage_timer.Mark(FrameStage::kCamera, telemetry);
+      rs.RenderFrame();
+      stage_timer.Mark(FrameStage::kRender, telemetry);
+      const auto image = pipeline.Assemble("channel.color", nullptr);
+      stage_timer.Mark(FrameStage::kAssemble, telemetry);
+      frame_counters.End(rs, telemetry);
+      if (i < kOverheadWarmupFrames) {
+        continue;
+      }
+      total_ms.push_back(telemetry.total_ms);
+      for (std::size_t stage = 0; stage < kFrameStageCount; ++stage) {
+        stage_ms[stage].push_back(telemetry.stage_ms[stage]);
+      }
+      commits += telemetry.commits;
+      allocations += telemetry.allocations;
+      host_pixels = static_cast<std::uint64_t>(image.Width()) * image.Height();
+    }
+
+    std::sort(total_ms.begin(), total_ms.end());
+    const auto median = [&](FrameStage stage) {
+      auto &samples = stage_ms[static_cast<std::size_t>(stage)];
+      std::sort(samples.begin(), samples.end());
+      return samples[samples.size() / 2];
+    };
+    const double frames = static_cast<double>(options.frames);
+    char size_label[32];
+    std::snprintf(size_label, sizeof(size_label), "%ux%u", size[0], size[1]);
+    std::printf("  %-10s %9.4f %9.4f %9.4f %9.4f %9.4f %9.4f %8.2f %8.2f "
+                "%10llu\n",
+                size_label, total_ms[total_ms.size() / 2],
+                total_ms[total_ms.size() * 95 / 100],
+                median(FrameStage::kPrepare), median(FrameStage::kCamera),
+                median(FrameStage::kRender), median(FrameStage::kAssemble),
+                static_cast<double>(commits) / frames,
+                static_cast<double>(allocations) / frames,
+                static_cast<unsigned long long>(host_pixels));
+  }
+  std::printf("  stage columns are medians in ms, commits and allocs per "
+              "frame, host px is the size of the assembled image (0 if the "
+              "device maps no color channel)\n");
+  return 0;
+}
+
+int main(int argc, const char **argv) {
+  AllocScope app_scope{AllocSubsystem::kApp};
+
+  Options options{};
+  if (!parseOptions(argc, argv, options)) {
+    return EXIT_FAILURE;
+  }
+  std::printf("Info: Using %s SIMD kernels\n",
+              SimdLevelName(GetKernels().level));
+  SetThreadPlacements(options.engine.thread_placements);
+  return runOverhead(options);
+}